@@ -0,0 +1,1226 @@
+/* * * * * * * * *
+ * Benchmark program that runs the hash tables directly, without going through
+ * the text interpreter: keys are generated in memory, and each table type is
+ * timed inserting them, looking them all up again (positive lookups), and
+ * looking up as many keys that were never inserted (negative lookups)
+ *
+ * each run starts from a new table. a few untimed warm-up runs come first,
+ * then several timed runs, and the mean of each phase's throughput is reported
+ * with a 95% confidence interval (from Student's t distribution) along with the
+ * memory the table ended up using. each table type and key count is run in a
+ * process of its own, so that it starts with a fresh heap, and so that a table
+ * that gives up (as the 1-key tables' directories can, with enough keys) is
+ * reported as failed without stopping the others
+ *
+ * the results can be saved as a baseline file, and later runs compared with it
+ * (after a change to the tables, say): each phase's time per operation is
+ * compared with Welch's t-test, and the memory used directly. a change is only
+ * a regression if it is worse than the baseline by more than a threshold and,
+ * for times, significantly so (at the 5% level), and the benchmark exits with
+ * status 2 if there are any regressions
+ *
+ * there's also a scaling sweep (-G), which grows one table of each type from
+ * 10^3 keys up to MAX_TABLE_SIZE keys (or until it gives up), stopping at
+ * logarithmic steps on the way to measure it. at each step it prints a line of
+ * CSV with the process's resident set size, the table's own count of the bytes
+ * it has allocated, the throughput of the inserts since the last step and of
+ * random lookups of the keys inserted so far, and how long the most recent
+ * resize took (if resizes are traced). plotted against the number of keys,
+ * these show where each table falls out of the caches and the TLB's reach, and
+ * how its memory grows
+ *
+ * and a key trace (recorded by a2 -r, see keytrace.h) can be replayed (-R)
+ * against each table type, either as fast as possible or (-O) with the trace's
+ * own timing, waiting until each operation's time comes. the replay reports
+ * the throughput (over the time spent on the operations themselves, or with
+ * the trace's timing, over the whole replay) and the percentiles of each type
+ * of operation's latency (if operations are timed, see latency.h), and with
+ * the trace's timing, how many operations started late because the table was
+ * still busy with earlier ones
+ *
+ * any of these can be run with sharded tables (-P, see hashtbl.h), and the
+ * benchmark's phases can be split between several threads (-j), each
+ * inserting or looking up its own share of the keys at the same time, to see
+ * how a sharded table scales. the threads are only pinned if -c is given (and
+ * then all to that one CPU), and hardware events can't be counted with them
+ *
+ * usage:
+ *   make bench
+ *   ./bench [-t type]... [-n nkeys]... [-s size] [-r runs] [-w warmups]
+ *           [-c cpu] [-S seed] [-p] [-C] [-B file] [-b file] [-T percent]
+ *           [-P shards] [-j threads]
+ *   ./bench -G [-t type]... [-d steps] [-N maxkeys] [-s size] [-c cpu]
+ *           [-S seed] [-P shards]
+ *   ./bench -R trace [-O] [-t type]... [-s size] [-c cpu] [-p] [-C]
+ *           [-P shards]
+ *       -t type:    a table type to run, as for a2 (default: every type)
+ *       -n nkeys:   how many keys to insert (default: 10000, 100000, 1000000)
+ *       -s size:    the initial size of each table, as for a2 (default: 4)
+ *       -r runs:    how many timed runs to average (default: 5)
+ *       -w warmups: how many untimed runs to do first (default: 1)
+ *       -c cpu:     the CPU to pin the benchmark to (default: the one it starts
+ *                   on; -1 not to pin it at all)
+ *       -S seed:    the seed the keys are generated from (default: 1)
+ *       -p:         also count hardware events (see perfcount.h)
+ *       -C:         print the results as CSV (with a header line)
+ *       -B file:    save the results as a baseline, in 'file'
+ *       -b file:    compare the results with the baseline in 'file'
+ *       -T percent: how much worse than the baseline a result can be before
+ *                   it counts as a regression (default: 5)
+ *       -G:         run the scaling sweep instead
+ *       -d steps:   how many steps the sweep takes for each power of 10
+ *                   (default: 4)
+ *       -N maxkeys: how many keys the sweep stops at (default: MAX_TABLE_SIZE)
+ *       -R trace:   replay the key trace in file 'trace' instead
+ *       -O:         replay it with its original timing
+ *       -P shards:  split each table into this many shards (a power of two,
+ *                   default: don't shard them)
+ *       -j threads: how many threads to split each phase between (default:
+ *                   1; more than 1 needs -P)
+ *
+ * the tables are timed as they were compiled, including any instrumentation
+ * they were compiled with: for the tables on their own, rebuild with
+ *   make clean bench OPTIONS="-DLATENCY_TIMING=0 -DTRACE_NEVENTS=0"
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+// for sched_setaffinity() and sched_getcpu()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "inthash.h"
+#include "hashtbl.h"
+#include "latency.h"
+#include "perfcount.h"
+#include "prng.h"
+#include "keytrace.h"
+
+// the most key counts that can be asked for, the most timed runs that can be
+// averaged, and the most threads a phase can be split between
+#define MAX_SIZES 16
+#define MAX_RUNS 100
+#define MAX_THREADS 64
+
+// the most results a baseline file can hold
+#define MAX_RECORDS 1024
+
+// the exit status when there are regressions from the baseline
+#define EXIT_REGRESSION 2
+
+// the number of keys the scaling sweep starts at, and how many random lookups
+// it times at each step
+#define SWEEP_START 1000
+#define SWEEP_LOOKUPS 65536
+
+// how many records of a key trace are read at once (between timed stretches
+// of replaying them), and how late an operation must start, replaying with the
+// trace's timing, to count as late (in nanoseconds)
+#define REPLAY_CHUNK 65536
+#define REPLAY_LATE_NS 10000
+
+// the phases of a run, timed separately
+typedef enum phase {
+	PHASE_INSERT, PHASE_HIT, PHASE_MISS, NPHASES
+} Phase;
+static const char *phasenames[NPHASES] = {"insert", "lookup+", "lookup-"};
+
+// command line options
+typedef struct options {
+	bool types[NTABLETYPES];	// which table types to run
+	long sizes[MAX_SIZES];		// how many keys to insert, for each size
+	int nsizes;
+	int initial_size;
+	int runs;
+	int warmups;
+	int cpu;
+	uint64_t seed;
+	bool perf;
+	bool csv;
+	const char *save;		// the file to save a baseline in (or NULL)
+	const char *baseline;	// the file to compare with a baseline from (or NULL)
+	double threshold;		// the percentage worse that is a regression
+	bool sweep;				// whether to run the scaling sweep instead
+	int steps;				// how many steps it takes for each power of 10
+	long maxkeys;			// how many keys it stops at
+	const char *replay;		// the key trace to replay instead (or NULL)
+	bool timed;				// whether to replay it with its own timing
+	int shards;				// how many shards each table has (0 for none)
+	int threads;			// how many threads each phase is split between
+} Options;
+
+// the keys for a run: those to insert, the same keys in another order (to look
+// up), and keys that were never inserted (to look up too)
+typedef struct keys {
+	int64 *inserts;
+	int64 *hits;
+	int64 *misses;
+	long nkeys;
+} Keys;
+
+// one thread's share of a phase of a run: the keys it inserts or looks up
+typedef struct worker {
+	pthread_t thread;
+	HashTable *table;
+	Phase phase;
+	const int64 *keys;
+	bool *found;	// where to put whether each key was found (for lookups)
+	long n;
+} Worker;
+
+// the results of every timed run with one table type and key count
+typedef struct result {
+	double ns[NPHASES][MAX_RUNS];	// how long each phase took, per operation
+	int runs;						// how many runs there were
+	long bytes;						// how many bytes the table ended up using
+	double bytes_per_key;			// ... for each key it stored
+} Result;
+
+// the mean, standard deviation and the half-width of the 95% confidence
+// interval of some samples
+typedef struct summary {
+	double mean;
+	double sd;
+	double ci;
+} Summary;
+
+// the summary of one phase of the runs with one table type, initial size,
+// number of shards and threads, and key count, as saved in (and loaded from) a
+// baseline file
+typedef struct record {
+	char type[16];
+	int size;
+	int shards;		// how many shards the table had (0 for none)
+	int threads;	// how many threads each phase was split between
+	long nkeys;
+	Phase phase;
+	int runs;		// how many runs there were (0 if the table failed)
+	double mean;	// the mean time per operation, in nanoseconds
+	double sd;		// ... and its standard deviation
+	long bytes;		// how many bytes the table ended up using
+} Record;
+
+Options get_options(int argc, char **argv);
+void pin_to_cpu(int cpu);
+const char *run_child(TableType type, const Keys *keys, const Options *options,
+	Result *result);
+void generate_keys(Keys *keys, long nkeys, uint64_t seed);
+void free_keys(Keys *keys);
+void bench_table(TableType type, const Keys *keys, const Options *options,
+	Result *result);
+void run_table(TableType type, const Keys *keys, const Options *options,
+	Result *result, bool timed);
+uint64_t run_phase(HashTable *table, Phase phase, const int64 *keys, long n,
+	bool *found, int nthreads);
+void *run_worker(void *arg);
+HashTable *create_table(TableType type, const Options *options);
+void sweep_table(TableType type, const Options *options);
+void replay_table(TableType type, const Options *options);
+uint64_t wait_until(uint64_t deadline);
+long resident_bytes(void);
+static int64 mix(uint64_t x);
+Summary summarise(const double *samples, int n);
+void print_result(TableType type, const Result *result, long nkeys, bool csv);
+void print_failure(TableType type, long nkeys, const char *why, bool csv);
+int add_records(Record *records, TableType type, const Options *options,
+	long nkeys, const Result *result);
+void save_records(const char *filename, const Record *records, int n);
+int load_records(const char *filename, Record *records);
+int compare_records(const Record *baseline, int nbaseline,
+	const Record *records, int nrecords, const Options *options);
+
+/*************************************************************************/
+
+int main(int argc, char **argv) {
+	Options options = get_options(argc, argv);
+	pin_to_cpu(options.cpu);
+	if (options.perf && !perf_open()) {
+		options.perf = false;
+	}
+
+	// the baseline to compare with, if there is one, and this run's results
+	static Record baseline[MAX_RECORDS], records[MAX_RECORDS];
+	int nbaseline = 0, nrecords = 0;
+	if (options.baseline) {
+		nbaseline = load_records(options.baseline, baseline);
+	}
+
+	// each child process leaves its results here, where this one can see them
+	Result *result = mmap(NULL, sizeof *result, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+
+	// a replay prints a line for each type of operation
+	TableType type;
+	if (options.replay) {
+		// (making sure it's a trace first, rather than in every child)
+		KeyTrace *trace = keytrace_open(options.replay);
+		if (!trace) {
+			exit(EXIT_FAILURE);
+		}
+		keytrace_close(trace);
+
+		if (options.csv) {
+			printf("type,ops,seconds,mops,op,count,p50_ns,p99_ns,p999_ns,"
+				"max_ns,late_ops,max_lag_us\n");
+		} else {
+			printf("%-8s %10s %9s %9s %-7s %10s %10s %10s %10s\n", "type",
+				"ops", "seconds", "Mops/s", "op", "p50 ns", "p99 ns",
+				"p99.9 ns", "max ns");
+		}
+		for (type = 0; type < NTABLETYPES; type++) {
+			const char *why;
+			if (options.types[type] &&
+				(why = run_child(type, NULL, &options, result))) {
+				fprintf(stderr, "%s: failed: %s\n", typetostr(type), why);
+			}
+		}
+		return 0;
+	}
+
+	// the sweep prints CSV, a line for each step
+	if (options.sweep) {
+		printf("type,nkeys,rss_bytes,table_bytes,bytes_per_key,insert_mops,"
+			"lookup_mops,last_resize_us\n");
+		for (type = 0; type < NTABLETYPES; type++) {
+			const char *why;
+			if (options.types[type] &&
+				(why = run_child(type, NULL, &options, result))) {
+				fprintf(stderr, "%s: failed: %s\n", typetostr(type), why);
+			}
+		}
+		return 0;
+	}
+
+	if (options.csv) {
+		printf("type,nkeys,phase,runs,mops,mops_ci,ns_per_op,ns_per_op_ci,"
+			"bytes,bytes_per_key\n");
+	} else {
+		printf("%-8s %9s %-8s %18s %16s %12s %10s\n", "type", "nkeys",
+			"phase", "Mops/s", "ns/op", "bytes", "bytes/key");
+	}
+
+	int i;
+	for (i = 0; i < options.nsizes; i++) {
+		Keys keys;
+		generate_keys(&keys, options.sizes[i], options.seed);
+
+		for (type = 0; type < NTABLETYPES; type++) {
+			if (!options.types[type]) {
+				continue;
+			}
+			const char *why = run_child(type, &keys, &options, result);
+			if (why) {
+				print_failure(type, keys.nkeys, why, options.csv);
+				result->runs = 0;
+			}
+			if (nrecords + NPHASES <= MAX_RECORDS) {
+				nrecords += add_records(&records[nrecords], type, &options,
+					keys.nkeys, result);
+			}
+		}
+
+		free_keys(&keys);
+	}
+
+	if (options.save) {
+		save_records(options.save, records, nrecords);
+	}
+	if (options.baseline && compare_records(baseline, nbaseline, records,
+			nrecords, &options) > 0) {
+		return EXIT_REGRESSION;
+	}
+	return 0;
+}
+
+/*************************************************************************/
+
+// run 'type' of table in a child process of its own, benchmarking it with
+// 'keys' (leaving the results in 'result'), or sweeping it or replaying a trace
+// with it if that's what 'options' ask for: returns why the child failed, or
+// NULL if it didn't
+const char *run_child(TableType type, const Keys *keys, const Options *options,
+		Result *result) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+	if (pid == 0) {
+		if (options->replay) {
+			replay_table(type, options);
+		} else if (options->sweep) {
+			sweep_table(type, options);
+		} else {
+			bench_table(type, keys, options, result);
+		}
+		exit(EXIT_SUCCESS);
+	}
+
+	int status;
+	waitpid(pid, &status, 0);
+	if (WIFSIGNALED(status)) {
+		return strsignal(WTERMSIG(status));
+	} else if (WEXITSTATUS(status) != EXIT_SUCCESS) {
+		return "exited with an error";
+	}
+	return NULL;
+}
+
+// benchmark 'type' of table with 'keys' (in a child process of its own),
+// printing its results and leaving them in 'result'
+void bench_table(TableType type, const Keys *keys, const Options *options,
+		Result *result) {
+	// the parent's counters count the parent: open this process's own
+	if (options->perf) {
+		perf_close();
+		perf_open();
+	}
+
+	// warm up (the caches, the allocator, the CPU's clock speed...)
+	result->runs = 0;
+	int run;
+	for (run = 0; run < options->warmups; run++) {
+		run_table(type, keys, options, result, false);
+	}
+
+	// then time each run
+	perf_reset();
+	for (run = 0; run < options->runs; run++) {
+		run_table(type, keys, options, result, true);
+	}
+	print_result(type, result, keys->nkeys, options->csv);
+	if (!options->csv) {
+		perf_print(19);
+	}
+}
+
+// run 'type' of table once with 'keys': insert them all, then look them all up,
+// then look up keys that were never inserted, adding how long each phase took
+// to 'result' if the run is 'timed'
+void run_table(TableType type, const Keys *keys, const Options *options,
+		Result *result, bool timed) {
+	long n = keys->nkeys;
+	bool *found = malloc((sizeof *found) * n);
+	if (!found) {
+		fprintf(stderr, "out of memory for %ld keys\n", n);
+		exit(EXIT_FAILURE);
+	}
+	uint64_t ns[NPHASES];	// how long each phase took
+
+	HashTable *table = create_table(type, options);
+
+	ns[PHASE_INSERT] = run_phase(table, PHASE_INSERT, keys->inserts, n, found,
+		options->threads);
+
+	ns[PHASE_HIT] = run_phase(table, PHASE_HIT, keys->hits, n, found,
+		options->threads);
+	long i, nhits = 0;
+	for (i = 0; i < n; i++) {
+		nhits += found[i];
+	}
+
+	ns[PHASE_MISS] = run_phase(table, PHASE_MISS, keys->misses, n, found,
+		options->threads);
+	long nmisses = 0;
+	for (i = 0; i < n; i++) {
+		nmisses += !found[i];
+	}
+
+	// a table that loses (or invents) keys isn't worth timing
+	if (nhits != n || nmisses != n) {
+		fprintf(stderr, "%s: found %ld of %ld inserted keys, and %ld of %ld "
+			"keys never inserted\n", typetostr(type), nhits, n, n - nmisses, n);
+		exit(EXIT_FAILURE);
+	}
+
+	TableStats stats = hash_table_get_stats(table);
+	free_hash_table(table);
+	free(found);
+
+	if (timed && result->runs < MAX_RUNS) {
+		int phase;
+		for (phase = 0; phase < NPHASES; phase++) {
+			result->ns[phase][result->runs] = ns[phase] * 1.0 / n;
+		}
+		result->runs++;
+		result->bytes = stats.bytes;
+		result->bytes_per_key = stats.bytes_per_key;
+	}
+}
+
+// do 'phase' of a run on 'table' with the 'n' keys in 'keys' (setting 'found'
+// for each key, for the lookup phases), splitting the keys evenly between
+// 'nthreads' threads; returns how long it took (including starting the
+// threads), in nanoseconds
+uint64_t run_phase(HashTable *table, Phase phase, const int64 *keys, long n,
+		bool *found, int nthreads) {
+	Worker workers[MAX_THREADS];
+	int t;
+	for (t = 0; t < nthreads; t++) {
+		long first = n * t / nthreads, last = n * (t + 1) / nthreads;
+		workers[t].table = table;
+		workers[t].phase = phase;
+		workers[t].keys = &keys[first];
+		workers[t].found = &found[first];
+		workers[t].n = last - first;
+	}
+
+	// with one thread, this one does it all itself
+	uint64_t start = latency_monotonic();
+	if (nthreads == 1) {
+		run_worker(&workers[0]);
+	} else {
+		for (t = 0; t < nthreads; t++) {
+			if (pthread_create(&workers[t].thread, NULL, run_worker,
+					&workers[t]) != 0) {
+				fprintf(stderr, "couldn't start thread %d\n", t);
+				exit(EXIT_FAILURE);
+			}
+		}
+		for (t = 0; t < nthreads; t++) {
+			pthread_join(workers[t].thread, NULL);
+		}
+	}
+	return latency_monotonic() - start;
+}
+
+// do the share of a phase in 'arg' (a Worker), in whichever thread calls it
+void *run_worker(void *arg) {
+	Worker *worker = arg;
+	if (worker->phase == PHASE_INSERT) {
+		long i;
+		for (i = 0; i < worker->n; i++) {
+			hash_table_insert(worker->table, worker->keys[i]);
+		}
+	} else {
+		hash_table_lookup_many(worker->table, worker->keys, worker->n,
+			worker->found);
+	}
+	return NULL;
+}
+
+// a new table of type 'type', with the initial size (and sharded into as many
+// shards) as 'options' ask for
+HashTable *create_table(TableType type, const Options *options) {
+	if (options->shards) {
+		return new_sharded_hash_table(type, options->initial_size,
+			options->shards);
+	}
+	return new_hash_table(type, options->initial_size);
+}
+
+// the 97.5th percentile of Student's t distribution with 'df' degrees of
+// freedom (rounded down, which only makes it more cautious)
+static double t975(double df) {
+	// for 1, 2, ... 30 degrees of freedom (beyond which it's close enough to
+	// the normal distribution's)
+	static const double table[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+	};
+	if (df < 1) {
+		df = 1;
+	}
+	return df <= 30 ? table[(int)df - 1] : 1.960;
+}
+
+// grow 'type' of table from empty to 'options->maxkeys' keys (in a child
+// process of its own), printing a line of CSV about it at each step
+void sweep_table(TableType type, const Options *options) {
+	int64 *lookups = malloc((sizeof *lookups) * SWEEP_LOOKUPS);
+	bool *found = malloc((sizeof *found) * SWEEP_LOOKUPS);
+	if (!lookups || !found) {
+		fprintf(stderr, "out of memory for lookups\n");
+		exit(EXIT_FAILURE);
+	}
+	Prng rng;
+	prng_seed(&rng, options->seed);
+
+	// the i'th key inserted is mix(offset + i), just as for the benchmark,
+	// so the keys never need to be stored
+	uint64_t offset = mix(options->seed);
+	HashTable *table = create_table(type, options);
+	long nkeys = 0;
+	int step;
+	for (step = 0; nkeys < options->maxkeys; step++) {
+		long target = SWEEP_START * pow(10, step * 1.0 / options->steps) + 0.5;
+		if (target > options->maxkeys) {
+			target = options->maxkeys;
+		}
+		if (target <= nkeys) {
+			continue;
+		}
+
+		// insert keys up to this step's number
+		uint64_t start = latency_monotonic();
+		long inserted = target - nkeys;
+		for (; nkeys < target; nkeys++) {
+			hash_table_insert(table, mix(offset + nkeys));
+		}
+		double insert_ns = latency_monotonic() - start;
+
+		// then look up keys chosen at random from all those inserted
+		int i;
+		for (i = 0; i < SWEEP_LOOKUPS; i++) {
+			lookups[i] = mix(offset + prng_next(&rng) % nkeys);
+		}
+		start = latency_monotonic();
+		hash_table_lookup_many(table, lookups, SWEEP_LOOKUPS, found);
+		double lookup_ns = latency_monotonic() - start;
+		for (i = 0; i < SWEEP_LOOKUPS; i++) {
+			if (!found[i]) {
+				fprintf(stderr, "%s: lost key %llu\n", typetostr(type),
+					lookups[i]);
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		TableStats stats = hash_table_get_stats(table);
+		printf("%s,%ld,%ld,%ld,%.3f,%.4f,%.4f,%.3f\n", typetostr(type), nkeys,
+			resident_bytes(), stats.bytes, stats.bytes_per_key,
+			inserted * 1e3 / insert_ns, SWEEP_LOOKUPS * 1e3 / lookup_ns,
+			stats.last_resize * 1e6);
+		fflush(stdout);
+	}
+
+	free_hash_table(table);
+	free(lookups);
+	free(found);
+}
+
+// replay the key trace in 'options->replay' against 'type' of table (in a child
+// process of its own), printing its throughput and latencies
+void replay_table(TableType type, const Options *options) {
+	KeyTrace *trace = keytrace_open(options->replay);
+	KeyTraceRecord *records = malloc((sizeof *records) * REPLAY_CHUNK);
+	if (!trace || !records) {
+		exit(EXIT_FAILURE);
+	}
+	if (options->perf) {
+		perf_close();
+		perf_open();
+	}
+
+	HashTable *table = create_table(type, options);
+	Latency latency;
+	initialise_latency(&latency);
+	long nops = 0, late = 0;
+	uint64_t busy = 0, max_lag = 0;
+
+	// replay a chunk of the trace at a time, so that reading it isn't timed
+	uint64_t begin = latency_monotonic();
+	int n;
+	do {
+		for (n = 0; n < REPLAY_CHUNK && keytrace_read(trace, &records[n]);
+			n++);
+
+		uint64_t start = latency_monotonic();
+		int i;
+		for (i = 0; i < n; i++) {
+			const KeyTraceRecord *record = &records[i];
+
+			// wait for the operation's time to come (and see how late it is)
+			if (options->timed) {
+				uint64_t lag = wait_until(begin + record->time) -
+					(begin + record->time);
+				late += lag > REPLAY_LATE_NS;
+				if (lag > max_lag) {
+					max_lag = lag;
+				}
+			}
+
+			LATENCY_START(op_start);
+			if (record->op == KEYTRACE_INSERT) {
+				hash_table_insert(table, record->key);
+				LATENCY_STOP(&latency, LATENCY_INSERT, op_start);
+			} else {
+				hash_table_lookup(table, record->key);
+				LATENCY_STOP(&latency, LATENCY_LOOKUP, op_start);
+			}
+		}
+		busy += latency_monotonic() - start;
+		nops += n;
+	} while (n == REPLAY_CHUNK);
+
+	// with the trace's timing, the replay took as long as it took
+	double seconds = (options->timed ? latency_monotonic() - begin : busy) / 1e9;
+	double mops = seconds > 0 ? nops / seconds / 1e6 : 0;
+	LatencySummary summaries[NLATENCYOPS];
+	latency_summarise(&latency, summaries);
+
+	int op;
+	for (op = 0; op < NLATENCYOPS; op++) {
+		const LatencySummary *summary = &summaries[op];
+		if (options->csv) {
+			printf("%s,%ld,%.6f,%.4f,%s,%ld,%.0f,%.0f,%.0f,%.0f,%ld,%.3f\n",
+				typetostr(type), nops, seconds, mops, latency_opnames[op],
+				summary->count, summary->p50, summary->p99, summary->p999,
+				summary->max, late, max_lag / 1e3);
+		} else if (op == 0) {
+			printf("%-8s %10ld %9.4f %9.3f %-7s %10.0f %10.0f %10.0f %10.0f\n",
+				typetostr(type), nops, seconds, mops, latency_opnames[op],
+				summary->p50, summary->p99, summary->p999, summary->max);
+		} else {
+			printf("%-8s %10s %9s %9s %-7s %10.0f %10.0f %10.0f %10.0f\n", "",
+				"", "", "", latency_opnames[op], summary->p50, summary->p99,
+				summary->p999, summary->max);
+		}
+	}
+	if (!options->csv) {
+		if (options->timed) {
+			printf("%-8s %ld operations started more than %d us late (at most "
+				"%.1f us)\n", "", late, REPLAY_LATE_NS / 1000, max_lag / 1e3);
+		}
+		perf_print(19);
+	}
+
+	free_hash_table(table);
+	keytrace_close(trace);
+	free(records);
+}
+
+// wait until the monotonic clock reaches 'deadline' (sleeping while it's far
+// off, then spinning, so as not to oversleep), returning the time it is then
+uint64_t wait_until(uint64_t deadline) {
+	uint64_t now = latency_monotonic();
+	while (now < deadline) {
+		// sleep until a little before the deadline, if it's far enough off
+		uint64_t left = deadline - now;
+		if (left > 200000) {
+			uint64_t ns = left - 100000;
+			struct timespec nap = {ns / 1000000000, ns % 1000000000};
+			nanosleep(&nap, NULL);
+		}
+		now = latency_monotonic();
+	}
+	return now;
+}
+
+// how many bytes of this process's memory are resident (from /proc, so 0 if
+// that isn't there)
+long resident_bytes(void) {
+	long pages = 0;
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if (statm) {
+		if (fscanf(statm, "%*ld %ld", &pages) != 1) {
+			pages = 0;
+		}
+		fclose(statm);
+	}
+	return pages * sysconf(_SC_PAGESIZE);
+}
+
+// the mean of the 'n' 'samples', their standard deviation, and the half-width
+// of the mean's 95% confidence interval (from Student's t distribution)
+Summary summarise(const double *samples, int n) {
+	Summary summary = {0, 0, 0};
+	int i;
+	for (i = 0; i < n; i++) {
+		summary.mean += samples[i];
+	}
+	summary.mean /= n;
+	if (n < 2) {
+		return summary;
+	}
+
+	double variance = 0;
+	for (i = 0; i < n; i++) {
+		variance += (samples[i] - summary.mean) * (samples[i] - summary.mean);
+	}
+	variance /= n - 1;
+	summary.sd = sqrt(variance);
+	summary.ci = t975(n - 1) * sqrt(variance / n);
+	return summary;
+}
+
+// print the results of running 'type' of table with 'nkeys' keys, as a line
+// per phase (of CSV, if 'csv')
+void print_result(TableType type, const Result *result, long nkeys, bool csv) {
+	int phase;
+	for (phase = 0; phase < NPHASES; phase++) {
+		// throughput is summarised run by run, rather than from the mean
+		// time, so that its confidence interval is right
+		double mops[MAX_RUNS];
+		int run;
+		for (run = 0; run < result->runs; run++) {
+			mops[run] = 1e3 / result->ns[phase][run];
+		}
+		Summary ns = summarise(result->ns[phase], result->runs);
+		Summary throughput = summarise(mops, result->runs);
+
+		if (csv) {
+			printf("%s,%ld,%s,%d,%.4f,%.4f,%.3f,%.3f,%ld,%.3f\n",
+				typetostr(type), nkeys, phasenames[phase], result->runs,
+				throughput.mean, throughput.ci, ns.mean, ns.ci,
+				result->bytes, result->bytes_per_key);
+		} else {
+			printf("%-8s %9ld %-8s %9.3f ± %-6.3f %8.2f ± %-5.2f %12ld "
+				"%10.2f\n", typetostr(type), nkeys, phasenames[phase],
+				throughput.mean, throughput.ci, ns.mean, ns.ci,
+				result->bytes, result->bytes_per_key);
+		}
+	}
+}
+
+// print that running 'type' of table with 'nkeys' keys failed, and 'why' (as
+// a line per phase, with no results, if 'csv')
+void print_failure(TableType type, long nkeys, const char *why, bool csv) {
+	if (csv) {
+		int phase;
+		for (phase = 0; phase < NPHASES; phase++) {
+			printf("%s,%ld,%s,0,,,,,,\n", typetostr(type), nkeys,
+				phasenames[phase]);
+		}
+	} else {
+		printf("%-8s %9ld failed: %s\n", typetostr(type), nkeys, why);
+	}
+	fflush(stdout);
+}
+
+/*************************************************************************/
+
+// add a record for each phase of 'result', from running 'type' of table (of
+// the initial size and shards, and with the threads, in 'options') with 'nkeys'
+// keys (records of a failure, if it has no runs) to 'records', returning how
+// many were added
+int add_records(Record *records, TableType type, const Options *options,
+		long nkeys, const Result *result) {
+	int phase;
+	for (phase = 0; phase < NPHASES; phase++) {
+		Record *record = &records[phase];
+		snprintf(record->type, sizeof record->type, "%s", typetostr(type));
+		record->size = options->initial_size;
+		record->shards = options->shards;
+		record->threads = options->threads;
+		record->nkeys = nkeys;
+		record->phase = phase;
+		record->runs = result->runs;
+		record->mean = record->sd = 0;
+		record->bytes = 0;
+		if (result->runs > 0) {
+			Summary ns = summarise(result->ns[phase], result->runs);
+			record->mean = ns.mean;
+			record->sd = ns.sd;
+			record->bytes = result->bytes;
+		}
+	}
+	return NPHASES;
+}
+
+// save the 'n' 'records' in the baseline file 'filename', a line each
+void save_records(const char *filename, const Record *records, int n) {
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		perror(filename);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(file, "# bench baseline: type size shards threads nkeys phase runs "
+		"ns/op ns/op-sd bytes\n");
+	int i;
+	for (i = 0; i < n; i++) {
+		const Record *record = &records[i];
+		fprintf(file, "%s %d %d %d %ld %s %d %.6f %.6f %ld\n", record->type,
+			record->size, record->shards, record->threads, record->nkeys,
+			phasenames[record->phase], record->runs, record->mean, record->sd,
+			record->bytes);
+	}
+	if (fclose(file) != 0) {
+		perror(filename);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// load the records in the baseline file 'filename' into 'records' (which has
+// room for MAX_RECORDS), returning how many there were
+int load_records(const char *filename, Record *records) {
+	FILE *file = fopen(filename, "r");
+	if (!file) {
+		perror(filename);
+		exit(EXIT_FAILURE);
+	}
+	int n = 0, line = 0;
+	char buffer[256];
+	while (fgets(buffer, sizeof buffer, file) && n < MAX_RECORDS) {
+		line++;
+		if (buffer[0] == '#' || buffer[0] == '\n') {
+			continue;
+		}
+		Record *record = &records[n];
+		char phase[16];
+		if (sscanf(buffer, "%15s %d %d %d %ld %15s %d %lf %lf %ld",
+				record->type, &record->size, &record->shards, &record->threads,
+				&record->nkeys, phase, &record->runs, &record->mean,
+				&record->sd, &record->bytes) != 10) {
+			fprintf(stderr, "%s:%d: not a baseline record\n", filename, line);
+			exit(EXIT_FAILURE);
+		}
+		for (record->phase = 0; record->phase < NPHASES; record->phase++) {
+			if (strcmp(phase, phasenames[record->phase]) == 0) {
+				break;
+			}
+		}
+		if (record->phase == NPHASES) {
+			fprintf(stderr, "%s:%d: unknown phase '%s'\n", filename, line,
+				phase);
+			exit(EXIT_FAILURE);
+		}
+		n++;
+	}
+	fclose(file);
+	return n;
+}
+
+// is the difference between the mean times of 'a' and 'b' significant at the
+// 5% level, by Welch's t-test? (with fewer than two runs of either, there's no
+// telling, so it's taken to be)
+static bool significant(const Record *a, const Record *b) {
+	if (a->runs < 2 || b->runs < 2) {
+		return true;
+	}
+	double va = a->sd * a->sd / a->runs, vb = b->sd * b->sd / b->runs;
+	if (va + vb == 0) {
+		return a->mean != b->mean;
+	}
+	double t = fabs(a->mean - b->mean) / sqrt(va + vb);
+	double df = (va + vb) * (va + vb) /
+		(va * va / (a->runs - 1) + vb * vb / (b->runs - 1));
+	return t > t975(df);
+}
+
+// print a line comparing 'metric' of 'record', 'now', with 'before' in the
+// baseline (to 'decimals' places), to 'out': returns whether it's a regression
+// (more than 'threshold' percent higher, and 'significant'; a metric that isn't
+// 'tested' for significance is significant if it changed at all)
+static bool compare_metric(FILE *out, const Record *record, const char *phase,
+		const char *metric, int decimals, double before, double now,
+		bool tested, bool significant, double threshold) {
+	double change = before ? (now - before) * 100 / before : 0;
+	const char *verdict = "";
+	bool regression = false;
+	if (significant && change > threshold) {
+		verdict = "REGRESSION";
+		regression = true;
+	} else if (significant && change < -threshold) {
+		verdict = "improved";
+	}
+	fprintf(out, "%-8s %9ld %-8s %-6s %14.*f %14.*f %+8.1f%% %4s  %s\n",
+		record->type, record->nkeys, phase, metric, decimals, before, decimals,
+		now, change, !tested ? "-" : significant ? "yes" : "no", verdict);
+	return regression;
+}
+
+// compare the 'nrecords' 'records' of this run with the 'nbaseline' in
+// 'baseline', printing the change in each metric (to stderr, if the results
+// are CSV), and returning how many regressions there are
+int compare_records(const Record *baseline, int nbaseline,
+		const Record *records, int nrecords, const Options *options) {
+	FILE *out = options->csv ? stderr : stdout;
+	fprintf(out, "--- compared with baseline %s (threshold %.1f%%) ---\n",
+		options->baseline, options->threshold);
+	fprintf(out, "%-8s %9s %-8s %-6s %14s %14s %9s %4s\n", "type", "nkeys",
+		"phase", "metric", "baseline", "now", "change", "sig");
+
+	int nregressions = 0, i;
+	for (i = 0; i < nrecords; i++) {
+		const Record *now = &records[i];
+		const Record *before = NULL;
+		int j;
+		for (j = 0; j < nbaseline && !before; j++) {
+			if (strcmp(baseline[j].type, now->type) == 0 &&
+				baseline[j].size == now->size &&
+				baseline[j].shards == now->shards &&
+				baseline[j].threads == now->threads &&
+				baseline[j].nkeys == now->nkeys &&
+				baseline[j].phase == now->phase) {
+				before = &baseline[j];
+			}
+		}
+		const char *phase = phasenames[now->phase];
+
+		// a table that failed before can't have regressed, but one that
+		// fails now has
+		if (!before || before->runs == 0) {
+			fprintf(out, "%-8s %9ld %-8s (no baseline)\n", now->type,
+				now->nkeys, phase);
+			continue;
+		}
+		if (now->runs == 0) {
+			fprintf(out, "%-8s %9ld %-8s REGRESSION: failed\n", now->type,
+				now->nkeys, phase);
+			nregressions++;
+			continue;
+		}
+
+		// time for each phase, and memory once for each table
+		nregressions += compare_metric(out, now, phase, "ns/op", 2,
+			before->mean, now->mean, true, significant(before, now),
+			options->threshold);
+		if (now->phase == NPHASES - 1) {
+			nregressions += compare_metric(out, now, "-", "bytes", 0,
+				before->bytes, now->bytes, false, before->bytes != now->bytes,
+				options->threshold);
+		}
+	}
+
+	fprintf(out, "--- %d regression%s ---\n", nregressions,
+		nregressions == 1 ? "" : "s");
+	return nregressions;
+}
+
+/*************************************************************************/
+
+// mix the bits of 'x' thoroughly (splitmix64's finaliser). every step can be
+// undone, so different inputs always give different outputs
+static int64 mix(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+// generate 'nkeys' distinct keys to insert from 'seed', the same keys in a
+// shuffled order to look up, and 'nkeys' more distinct keys to look up that
+// aren't inserted
+void generate_keys(Keys *keys, long nkeys, uint64_t seed) {
+	keys->nkeys = nkeys;
+	keys->inserts = malloc((sizeof *keys->inserts) * nkeys);
+	keys->hits = malloc((sizeof *keys->hits) * nkeys);
+	keys->misses = malloc((sizeof *keys->misses) * nkeys);
+	if (!keys->inserts || !keys->hits || !keys->misses) {
+		fprintf(stderr, "out of memory for %ld keys\n", nkeys);
+		exit(EXIT_FAILURE);
+	}
+
+	// mixing the numbers 0, 1, 2, ... (offset by the seed) gives keys that
+	// look random, but are certain to be distinct
+	uint64_t offset = mix(seed);
+	long i;
+	for (i = 0; i < nkeys; i++) {
+		keys->inserts[i] = mix(offset + i);
+		keys->misses[i] = mix(offset + nkeys + i);
+		keys->hits[i] = keys->inserts[i];
+	}
+
+	// shuffle the lookups, so they don't visit the table in insertion order
+	Prng rng;
+	prng_seed(&rng, seed);
+	for (i = nkeys - 1; i > 0; i--) {
+		long j = prng_next(&rng) % (i + 1);
+		int64 key = keys->hits[i];
+		keys->hits[i] = keys->hits[j];
+		keys->hits[j] = key;
+	}
+}
+
+// free the arrays of 'keys'
+void free_keys(Keys *keys) {
+	free(keys->inserts);
+	free(keys->hits);
+	free(keys->misses);
+}
+
+// pin the benchmark to CPU 'cpu' (or not at all, if it's -1), so that its caches
+// stay warm and its timing isn't disturbed by moving between CPUs
+void pin_to_cpu(int cpu) {
+	if (cpu < 0) {
+		return;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof set, &set) != 0) {
+		fprintf(stderr, "couldn't pin to CPU %d, running unpinned\n", cpu);
+	}
+}
+
+/*************************************************************************/
+
+// print usage information and exit
+void printusageexit(char *exe) {
+	fprintf(stderr, "usage: %s [-t type]... [-n nkeys]... [-s size] [-r runs] "
+		"[-w warmups] [-c cpu] [-S seed] [-p] [-C] [-B file] [-b file] "
+		"[-T percent] [-P shards] [-j threads]\n", exe);
+	fprintf(stderr, "       %s -G [-t type]... [-d steps] [-N maxkeys] "
+		"[-s size] [-c cpu] [-S seed] [-P shards]\n", exe);
+	fprintf(stderr, "       %s -R trace [-O] [-t type]... [-s size] "
+		"[-c cpu] [-p] [-C] [-P shards]\n", exe);
+	fprintf(stderr, " -t type:    a table type to run, as for a2 "
+		"(default: every type)\n");
+	fprintf(stderr, " -n nkeys:   how many keys to insert "
+		"(default: 10000, 100000, 1000000)\n");
+	fprintf(stderr, " -s size:    the initial size of each table, as for a2 "
+		"(default: 4)\n");
+	fprintf(stderr, " -r runs:    how many timed runs to average "
+		"(default: 5, at most %d)\n", MAX_RUNS);
+	fprintf(stderr, " -w warmups: how many untimed runs to do first "
+		"(default: 1)\n");
+	fprintf(stderr, " -c cpu:     the CPU to pin the benchmark to "
+		"(default: the one it starts on; -1 not to pin it)\n");
+	fprintf(stderr, " -S seed:    the seed the keys are generated from "
+		"(default: 1)\n");
+	fprintf(stderr, " -p:         also count hardware events\n");
+	fprintf(stderr, " -C:         print the results as CSV\n");
+	fprintf(stderr, " -B file:    save the results as a baseline in file\n");
+	fprintf(stderr, " -b file:    compare the results with the baseline in "
+		"file\n");
+	fprintf(stderr, " -T percent: how much worse than the baseline is a "
+		"regression (default: 5)\n");
+	fprintf(stderr, " -G:         run the scaling sweep instead\n");
+	fprintf(stderr, " -d steps:   sweep steps for each power of 10 "
+		"(default: 4)\n");
+	fprintf(stderr, " -N maxkeys: how many keys the sweep stops at "
+		"(default: %d)\n", MAX_TABLE_SIZE);
+	fprintf(stderr, " -R trace:   replay the key trace in file trace "
+		"instead\n");
+	fprintf(stderr, " -O:         replay it with its original timing\n");
+	fprintf(stderr, " -P shards:  split each table into this many shards "
+		"(a power of two, up to %d)\n", MAX_SHARDS);
+	fprintf(stderr, " -j threads: how many threads to split each phase "
+		"between (default: 1; more needs -P)\n");
+	exit(EXIT_FAILURE);
+}
+
+// scan the command line arguments for options, printing usage information and
+// exiting if any are invalid
+Options get_options(int argc, char **argv) {
+	Options options = { .nsizes = 0, .initial_size = 4, .runs = 5,
+		.warmups = 1, .cpu = sched_getcpu(), .seed = 1, .perf = false,
+		.csv = false, .save = NULL, .baseline = NULL, .threshold = 5,
+		.sweep = false, .steps = 4, .maxkeys = MAX_TABLE_SIZE,
+		.replay = NULL, .timed = false, .shards = 0, .threads = 1 };
+	bool pinned = false;
+	int ntypes = 0;
+	TableType type;
+	for (type = 0; type < NTABLETYPES; type++) {
+		options.types[type] = false;
+	}
+
+	int option;
+	while ((option = getopt(argc, argv, "t:n:s:r:w:c:S:pCB:b:T:Gd:N:R:OP:j:")) != -1) {
+		switch (option) {
+			case 't':
+				type = strtotype(optarg);
+				if (type == NOTYPE) {
+					fprintf(stderr, "unknown table type '%s'\n", optarg);
+					printusageexit(argv[0]);
+				}
+				options.types[type] = true;
+				ntypes++;
+				break;
+			case 'n':
+				if (options.nsizes == MAX_SIZES || atol(optarg) <= 0) {
+					printusageexit(argv[0]);
+				}
+				options.sizes[options.nsizes++] = atol(optarg);
+				break;
+			case 's':
+				options.initial_size = atoi(optarg);
+				break;
+			case 'r':
+				options.runs = atoi(optarg);
+				break;
+			case 'w':
+				options.warmups = atoi(optarg);
+				break;
+			case 'c':
+				options.cpu = atoi(optarg);
+				pinned = true;
+				break;
+			case 'S':
+				options.seed = strtoull(optarg, NULL, 0);
+				break;
+			case 'p':
+				options.perf = true;
+				break;
+			case 'C':
+				options.csv = true;
+				break;
+			case 'B':
+				options.save = optarg;
+				break;
+			case 'b':
+				options.baseline = optarg;
+				break;
+			case 'T':
+				options.threshold = atof(optarg);
+				break;
+			case 'G':
+				options.sweep = true;
+				break;
+			case 'd':
+				options.steps = atoi(optarg);
+				break;
+			case 'N':
+				options.maxkeys = atol(optarg);
+				break;
+			case 'R':
+				options.replay = optarg;
+				break;
+			case 'O':
+				options.timed = true;
+				break;
+			case 'P':
+				options.shards = atoi(optarg);
+				break;
+			case 'j':
+				options.threads = atoi(optarg);
+				break;
+			default:
+				printusageexit(argv[0]);
+		}
+	}
+	if (options.initial_size <= 0 || options.runs <= 0 ||
+		options.runs > MAX_RUNS || options.warmups < 0 ||
+		options.threshold < 0 || options.steps <= 0 || options.maxkeys <= 0 ||
+		options.shards < 0 || options.shards > MAX_SHARDS ||
+		(options.shards & (options.shards - 1)) != 0 ||
+		options.threads <= 0 || options.threads > MAX_THREADS) {
+		printusageexit(argv[0]);
+	}
+
+	// threads share a table, so it has to be sharded (and they don't share
+	// the hardware counters, which count just one thread)
+	if (options.threads > 1 && (!options.shards || options.perf)) {
+		fprintf(stderr, "-j %d needs a sharded table (-P), and can't be used "
+			"with -p\n", options.threads);
+		printusageexit(argv[0]);
+	}
+
+	// and they'd only get in each other's way pinned to one CPU, unless that's
+	// what was asked for
+	if (options.threads > 1 && !pinned) {
+		options.cpu = -1;
+	}
+
+	// by default, run every type of table with a few sizes
+	if (ntypes == 0) {
+		for (type = 0; type < NTABLETYPES; type++) {
+			options.types[type] = true;
+		}
+	}
+	if (options.nsizes == 0) {
+		options.sizes[options.nsizes++] = 10000;
+		options.sizes[options.nsizes++] = 100000;
+		options.sizes[options.nsizes++] = 1000000;
+	}
+
+	return options;
+}
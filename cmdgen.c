@@ -4,11 +4,47 @@
  * 
  * usage:
  *   make cmdgen
- *   ./cmdgen ninserts nlookups > commandfilename
+ *   ./cmdgen [options] ninserts nlookups ptable > commandfilename
  *       ninserts: number of insert commands to generate
  *       nlookups: number of lookup commands to generate
  *       commandfilename: name of file to store commands in
  *
+ *   options choosing the keys inserted:
+ *       -d dist:  uniform (the default): anything up to 100 * ninserts
+ *                 unique: no key twice, scattered over all 64-bit numbers
+ *                 zipf: the same as uniform, but with smaller keys far more
+ *                     popular (so many are inserted again and again)
+ *                 sequential: start, start + stride, start + 2 * stride, ...
+ *                 clustered: random keys whose h1 values share their lowest
+ *                     'bits' bits (the bad case for rightmostnbits addressing)
+ *                 collide: keys that all have the same h1 value, and whose h2
+ *                     values share their lowest 'bits' bits
+ *       -z skew:  how skewed the Zipfian distributions are, 0 < skew < 1
+ *                 (default 0.99)
+ *       -k stride, -o start: for sequential keys (default 1 and 0)
+ *       -b bits:  for clustered keys (default 8) and colliding keys (default 0)
+ *
+ *   options choosing the operations after the inserts (otherwise they're all
+ *   lookups, half of keys that were inserted and half of new random keys):
+ *       -w workload: a YCSB-style workload, A to F (see 'workloads' below)
+ *       -m read:update:insert: the percentage of each type of operation, where
+ *                 an update re-inserts a key that's already there and an
+ *                 insert adds a new key
+ *       -r dist:  which inserted keys reads and updates choose: uniform, zipf
+ *                 (early keys are popular) or latest (recent keys are popular)
+ *       -x miss:  the fraction of reads that look up new keys instead
+ *   and:
+ *       -S seed:  the seed for the random numbers (default: the time), so that
+ *                 the same commands can be generated again
+ *
+ * the commands are streamed out as they're generated, in constant memory, so
+ * there's no limit on how many there can be (10^9 is fine, given the disk
+ * space). instead of remembering the keys it has inserted, cmdgen makes the
+ * i'th key inserted a function of i, and works out any earlier key again when
+ * it needs one. the keys looked up as misses come from beyond the last index
+ * that could be inserted, so for any distribution of distinct keys (all but
+ * uniform and zipf) a hit is always a hit and a miss is always a miss
+ *
  * created for COMP20007 Design of Algorithms - Assignment 2, 2017
  * by Shreyash Patodia and Matt Farrugia
  * 
@@ -17,19 +53,119 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
 #include <time.h>
+#include <getopt.h>
 
 #include "inthash.h"
+#include "prng.h"
+
+/*************************************************************************/
+
+/* The distributions keys can be drawn from. */
+typedef enum dist {
+	UNIFORM, UNIQUE, ZIPF, LATEST, SEQUENTIAL, CLUSTERED, COLLIDE, NDISTS
+} Dist;
+const char *distnames[NDISTS] = {
+	"uniform", "unique", "zipf", "latest", "sequential", "clustered", "collide"
+};
+
+/* The types of operation that follow the inserts. */
+typedef enum op {
+	READ, UPDATE, INSERT, SCAN, RMW, NOPS
+} Op;
+
+/* A mix of operations (percentages of each type), and how to choose which
+ * inserted keys they use. The tables can't delete keys, so unlike YCSB there
+ * are no deletes; an update re-inserts a key that's already there, a scan
+ * looks up a short run of keys inserted one after another, and a
+ * read-modify-write (rmw) looks a key up and then re-inserts it. */
+typedef struct workload {
+	int percent[NOPS];
+	Dist request;
+} Workload;
+
+/* The YCSB core workloads, as far as a set of keys can follow them. */
+const Workload workloads[] = {
+	{{50, 50, 0, 0, 0}, ZIPF},		/* A: update heavy */
+	{{95, 5, 0, 0, 0}, ZIPF},		/* B: read mostly */
+	{{100, 0, 0, 0, 0}, ZIPF},		/* C: read only */
+	{{95, 0, 5, 0, 0}, LATEST},		/* D: read latest */
+	{{0, 0, 5, 95, 0}, ZIPF},		/* E: short ranges */
+	{{50, 0, 0, 0, 50}, ZIPF},		/* F: read-modify-write */
+};
+
+/* The longest run of keys a scan looks up. */
+#define MAX_SCAN 100
+
+/* How many rounds the Feistel network behind unique keys has (four rounds of
+ * a good round function are enough for the keys to look random). */
+#define FEISTEL_ROUNDS 4
+
+/* How many candidates to try (times 2^bits) for each colliding key whose h2
+ * value has to share its low bits: the chance of none of them sharing them is
+ * about e^-32. */
+#define COLLIDE_TRIES 32
+
+/* A Zipfian distribution over the numbers 0 to n-1 (Gray et al., "Quickly
+ * generating billion-record synthetic databases", as used by YCSB). */
+typedef struct zipf {
+	long n;
+	double theta, alpha, zetan, eta;
+} Zipf;
+
+/* Everything needed to work out the i'th key. */
+typedef struct generator {
+	Dist dist;			/* the distribution inserted keys come from */
+	uint64_t seed;		/* which random keys they are */
+	uint64_t round[FEISTEL_ROUNDS];	/* the Feistel network's round keys */
+	long max;			/* uniform and zipf keys are below this */
+	Zipf zipf;			/* for zipf keys */
+	int64 start;		/* the first sequential key */
+	int64 stride;		/* the step between sequential keys */
+	int bits;			/* how many low hash value bits keys share */
+	int hash;			/* ... and the hash value they share them with */
+	int64 block;		/* how many candidates each colliding key has */
+} Generator;
+
+void printusageexit(char *exe);
+double zeta(long n, double theta);
+void init_zipf(Zipf *zipf, long n, double theta);
+long zipf_at(Zipf *zipf, uint64_t random);
+uint64_t mix(uint64_t x);
+int64 permute(Generator *gen, int64 i);
+int64 key_at(Generator *gen, long i);
+long choose_inserted(Prng *rng, Dist request, Zipf *zipf, long ninserted);
+Dist strtodist(char *str);
 
 /*************************************************************************/
 
 void printusageexit(char *exe) {
 	/* Print usage information: */
-	fprintf(stderr, "usage: %s ninserts nlookups ptable> commandfilename\n", exe);
+	fprintf(stderr, "usage: %s [options] ninserts nlookups ptable> commandfilename\n", exe);
 	fprintf(stderr, " ninserts: number of insert commands to generate\n");
 	fprintf(stderr, " nlookups: number of lookup commands to generate\n");
     fprintf(stderr, " ptable: p = print table, or - = don't print table\n");
 	fprintf(stderr, " commandfilename: name of file to store commands in\n");
+	fprintf(stderr, "options:\n");
+	fprintf(stderr, " -d dist: keys to insert: uniform, unique, zipf, "
+		"sequential, clustered or collide\n");
+	fprintf(stderr, " -z skew: Zipfian skew, between 0 and 1 (default 0.99)\n");
+	fprintf(stderr, " -k stride, -o start: for sequential keys "
+		"(default 1, 0)\n");
+	fprintf(stderr, " -b bits: low hash bits clustered keys share (default 8), "
+		"or colliding keys' h2 values share (default 0)\n");
+	fprintf(stderr, " -w workload: YCSB-style workload A-F for the "
+		"operations after the inserts\n");
+	fprintf(stderr, " -m read:update:insert: percentages of each operation "
+		"after the inserts\n");
+	fprintf(stderr, " -r dist: inserted keys to read/update: uniform, zipf or "
+		"latest\n");
+	fprintf(stderr, " -x miss: fraction of reads of keys never inserted\n");
+	fprintf(stderr, " -S seed: seed for the random numbers (default: the "
+		"time)\n");
 
 	/* and exit, as promised :) */
 	exit(1);
@@ -38,45 +174,182 @@ void printusageexit(char *exe) {
 /*************************************************************************/
 
 int main(int argc, char **argv) {
-	int i;
+	long i;
+
+	/* Get command line options. */
+	Generator gen = { .dist = UNIFORM, .start = 0, .stride = 1, .bits = -1 };
+	double theta = 0.99;
+	uint64_t seed = time(NULL);
+	bool mixed = false;
+	Workload workload = {{100, 0, 0, 0, 0}, UNIFORM};
+	double miss = -1;
+	Dist request = NDISTS;
+
+	int option;
+	while ((option = getopt(argc, argv, "d:z:k:o:b:w:m:r:x:S:")) != -1) {
+		switch (option) {
+			case 'd':
+				gen.dist = strtodist(optarg);
+				if (gen.dist == NDISTS || gen.dist == LATEST) {
+					printusageexit(argv[0]);
+				}
+				break;
+			case 'z':
+				theta = atof(optarg);
+				if (theta <= 0 || theta >= 1) {
+					printusageexit(argv[0]);
+				}
+				break;
+			case 'k':
+				gen.stride = strtoull(optarg, NULL, 0);
+				break;
+			case 'o':
+				gen.start = strtoull(optarg, NULL, 0);
+				break;
+			case 'b':
+				gen.bits = atoi(optarg);
+				if (gen.bits < 0 || gen.bits > 30) {
+					printusageexit(argv[0]);
+				}
+				break;
+			case 'w':
+				if (strlen(optarg) != 1 || *optarg < 'A' || *optarg > 'F') {
+					printusageexit(argv[0]);
+				}
+				workload = workloads[*optarg - 'A'];
+				mixed = true;
+				break;
+			case 'm':
+				memset(&workload.percent, 0, sizeof workload.percent);
+				if (sscanf(optarg, "%d:%d:%d", &workload.percent[READ],
+						&workload.percent[UPDATE],
+						&workload.percent[INSERT]) != 3 ||
+					workload.percent[READ] + workload.percent[UPDATE] +
+						workload.percent[INSERT] != 100) {
+					printusageexit(argv[0]);
+				}
+				mixed = true;
+				break;
+			case 'r':
+				request = strtodist(optarg);
+				if (request != UNIFORM && request != ZIPF &&
+					request != LATEST) {
+					printusageexit(argv[0]);
+				}
+				break;
+			case 'x':
+				miss = atof(optarg);
+				break;
+			case 'S':
+				seed = strtoull(optarg, NULL, 0);
+				break;
+			default:
+				printusageexit(argv[0]);
+		}
+	}
 
 	/* Get command line arguments. */
-	if (argc < 4) {
+	if (argc - optind < 3) {
+		printusageexit(argv[0]);
+	}
+	long ninserts  = atol(argv[optind]);
+	long nlookups = atol(argv[optind + 1]);
+    char ptable = *argv[optind + 2];
+	if (ninserts <= 0 || nlookups < 0) {
 		printusageexit(argv[0]);
 	}
-	int ninserts  = atoi(argv[1]);
-	int nlookups = atoi(argv[2]);
-    char ptable = *argv[3];
 
-	/* Seed the random number generator. */
-	srand(time(NULL));
+	/* Without a workload, reads choose keys as they always have: half of them
+	 * inserted keys, chosen uniformly, and half of them new random keys. */
+	if (request != NDISTS) {
+		workload.request = request;
+	}
+	if (miss < 0) {
+		miss = mixed ? 0 : 0.5;
+	}
 
-	/* Decide on some random numbers for insertion. */
-	int max = 100 * ninserts + 1;
-	int64 *inserts = malloc(sizeof (int64) * ninserts);
-	for (i = 0; i < ninserts; i++) {
-		inserts[i] = rand() % max;
+	/* Seed the random number generator, and set up the key distribution. */
+	Prng rng;
+	prng_seed(&rng, seed);
+	gen.seed = prng_next(&rng);
+	for (i = 0; i < FEISTEL_ROUNDS; i++) {
+		gen.round[i] = prng_next(&rng);
+	}
+	gen.max = 100 * ninserts + 1;
+	if (gen.dist == ZIPF) {
+		init_zipf(&gen.zipf, gen.max, theta);
 	}
+	if (gen.bits < 0) {
+		gen.bits = gen.dist == CLUSTERED ? 8 : 0;
+	}
+	gen.hash = prng_below(&rng, 2147483563);
+	gen.block = gen.bits ? (int64)COLLIDE_TRIES << gen.bits : 1;
 
-	/* Print insertion commands for these numbers. */
+	/* Keys 0 to ninserts + nlookups - 1 may be inserted (at most one for each
+	 * command); the keys after them are for misses. */
+	long nmisses = 0;
+	long firstmiss = ninserts + nlookups;
+	if (gen.dist == COLLIDE && firstmiss + nlookups > (1ll << 32) / gen.block) {
+		fprintf(stderr, "too many keys: only %lld keys collide\n",
+			(1ll << 32) / gen.block);
+		exit(1);
+	}
+
+	/* Print insertion commands for the first keys. */
+	long ninserted = 0;
 	for (i = 0; i < ninserts; i++) {
-		printf("i %llu\n", inserts[i]);
+		printf("i %llu\n", key_at(&gen, ninserted++));
+	}
+
+	/* Which inserted keys are popular, for a Zipfian choice of them. */
+	Zipf popular;
+	if (workload.request != UNIFORM) {
+		init_zipf(&popular, ninserts, theta);
 	}
 
-	/* Print lookup commands. Some will succeed, others will fail. */
+	/* Print the operations that follow (without a workload, these are all
+	 * lookups). Some lookups will succeed, others will fail. */
 	for (i = 0; i < nlookups; i++) {
-		
-		/* Flip a coin to decide whether to use an existing key or a new one. */
-		int64 lookup;
-		if (rand() % 2) {
-			/* Use a random existing key */
-			lookup = inserts[rand() % ninserts];
-		
-		} else {
-			/* Generate a new random key */
-			lookup = rand() % max;
+
+		/* Choose a type of operation, by its percentage. */
+		int choice = prng_below(&rng, 100);
+		Op op = READ;
+		while (choice >= workload.percent[op]) {
+			choice -= workload.percent[op];
+			op++;
+		}
+
+		long index = choose_inserted(&rng, workload.request, &popular,
+			ninserted);
+		long n;
+		switch (op) {
+			case READ:
+				/* Flip a (biased) coin to decide whether to use an existing
+				 * key or a new one. */
+				if (prng_next(&rng) < miss * UINT64_MAX) {
+					index = firstmiss + nmisses++;
+				}
+				printf("l %llu\n", key_at(&gen, index));
+				break;
+			case UPDATE:
+				printf("i %llu\n", key_at(&gen, index));
+				break;
+			case INSERT:
+				printf("i %llu\n", key_at(&gen, ninserted++));
+				break;
+			case SCAN:
+				n = 1 + prng_below(&rng, MAX_SCAN);
+				for (; n > 0 && index < ninserted; n--) {
+					printf("l %llu\n", key_at(&gen, index++));
+				}
+				break;
+			case RMW:
+				printf("l %llu\n", key_at(&gen, index));
+				printf("i %llu\n", key_at(&gen, index));
+				break;
+			default:
+				break;
 		}
-		printf("l %llu\n", lookup);
 	}
 
 	/* Finish with commands to print the table, print statistics, and quit. */
@@ -85,7 +358,136 @@ int main(int argc, char **argv) {
         printf("p\n");
     }
 	printf("s\n");
-	printf("q\n"); 
+	printf("q\n");
 
 	return 0;
 }
+
+/*************************************************************************/
+
+/* Convert the name of a distribution to the distribution (NDISTS if none). */
+Dist strtodist(char *str) {
+	Dist dist;
+	for (dist = 0; dist < NDISTS; dist++) {
+		if (strcmp(distnames[dist], str) == 0) {
+			break;
+		}
+	}
+	return dist;
+}
+
+/* The sum of 1/i^theta for i from 1 to n: exactly for the first million
+ * terms, and beyond that from the integral of 1/x^theta (with the trapezium
+ * rule's correction), which is more than accurate enough. */
+double zeta(long n, double theta) {
+	const long exact = 1000000;
+	double sum = 0;
+	long i;
+	for (i = 1; i <= n && i <= exact; i++) {
+		sum += pow(i, -theta);
+	}
+	if (n > exact) {
+		sum += (pow(n, 1 - theta) - pow(exact, 1 - theta)) / (1 - theta)
+			+ (pow(n, -theta) - pow(exact, -theta)) / 2;
+	}
+	return sum;
+}
+
+/* Set up a Zipfian distribution over 0 to n-1 with skew 'theta'. */
+void init_zipf(Zipf *zipf, long n, double theta) {
+	zipf->n = n;
+	zipf->theta = theta;
+	zipf->alpha = 1 / (1 - theta);
+	zipf->zetan = zeta(n, theta);
+	zipf->eta = (1 - pow(2.0 / n, 1 - theta)) /
+		(1 - zeta(2, theta) / zipf->zetan);
+}
+
+/* The number from a Zipfian distribution (0 is the most popular) that the
+ * 64-bit random number 'random' picks. */
+long zipf_at(Zipf *zipf, uint64_t random) {
+	double u = (random >> 11) * 0x1.0p-53;
+	double uz = u * zipf->zetan;
+	if (uz < 1) {
+		return 0;
+	}
+	if (uz < 1 + pow(0.5, zipf->theta)) {
+		return 1;
+	}
+	long value = zipf->n * pow(zipf->eta * u - zipf->eta + 1, zipf->alpha);
+	return value < zipf->n ? value : zipf->n - 1;
+}
+
+/* Scramble 'x' (this is splitmix64's finaliser, a bijection whose every
+ * output bit depends on every input bit), for random numbers that depend only
+ * on which key they're for. */
+uint64_t mix(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+/* Permute 'i' with a Feistel network over its two 32-bit halves: each round
+ * swaps the halves, mixing one into the other, and any such round can be
+ * undone, so different 'i's always give different keys. */
+int64 permute(Generator *gen, int64 i) {
+	uint32_t left = i >> 32, right = (uint32_t)i;
+	int round;
+	for (round = 0; round < FEISTEL_ROUNDS; round++) {
+		uint32_t next = left ^ (uint32_t)mix(right ^ gen->round[round]);
+		left = right;
+		right = next;
+	}
+	return (int64)left << 32 | right;
+}
+
+/* The i'th key to insert, from the generator's distribution (any key can be
+ * worked out again, at any time). */
+int64 key_at(Generator *gen, long i) {
+	int64 key = 0, j;
+	int mask = (1 << gen->bits) - 1;
+	uint64_t random = mix(gen->seed + i);
+	switch (gen->dist) {
+		case UNIQUE:
+			return permute(gen, i);
+		case ZIPF:
+			return zipf_at(&gen->zipf, random);
+		case SEQUENTIAL:
+			return gen->start + i * gen->stride;
+		case CLUSTERED:
+			/* Any h1 value with the shared low bits, and any key with that
+			 * value. */
+			return h1_preimage(
+				(random >> 32) % (2147483629 >> gen->bits) << gen->bits |
+				(gen->hash & mask), (uint32_t)random);
+		case COLLIDE:
+			/* The first of this key's own block of keys with the one h1 value
+			 * whose h2 value shares the low bits (or, failing that, the last
+			 * of them). */
+			for (j = i * gen->block; j < (i + 1) * gen->block; j++) {
+				key = h1_preimage(gen->hash, j);
+				if ((h2(key) & mask) == (gen->hash & mask)) {
+					break;
+				}
+			}
+			return key;
+		default:
+			return random % gen->max;
+	}
+}
+
+/* Choose the index of one of the first 'ninserted' inserted keys, from
+ * distribution 'request' (with 'zipf' saying which keys are popular). */
+long choose_inserted(Prng *rng, Dist request, Zipf *zipf, long ninserted) {
+	long index;
+	switch (request) {
+		case ZIPF:
+			index = zipf_at(zipf, prng_next(rng));
+			return index < ninserted ? index : ninserted - 1;
+		case LATEST:
+			index = zipf_at(zipf, prng_next(rng));
+			return index < ninserted ? ninserted - 1 - index : 0;
+		default:
+			return prng_next(rng) % ninserted;
+	}
+}
@@ -0,0 +1,373 @@
+/* * * * * * * * *
+ * Benchmark program for the hash functions themselves, rather than the tables
+ * built on them: each function is timed, and its output is tested for the
+ * properties the tables rely on, with both random keys and structured keys of
+ * the kinds real programs use (sequential ids, aligned addresses, ...)
+ *
+ * for each set of keys and each function, it reports:
+ *   ns/hash:   how long the function takes, through a function pointer (the
+ *              fastest of several passes over the keys)
+ *   avalanche: how often flipping one bit of a key flips each bit of its hash
+ *              (ideally half the time): the mean over every pair of key bit and
+ *              hash bit, and the worst pair's distance from a half
+ *   chi2 z:    how evenly the lowest 8, 12 and 16 bits of the hashes (which is
+ *              all rightmostnbits uses, for tables of those sizes) spread the
+ *              keys over buckets, as the chi-squared statistic's distance from
+ *              its expected value in standard deviations (beyond about 3 is
+ *              suspicious: a large positive value means clumping, and a
+ *              large negative one means the keys are spread more evenly than
+ *              random keys would be, as sequential keys can be)
+ * and for h1 against h2 (which cuckoo tables need to be independent):
+ *   r:         the correlation of the two hash values
+ *   joint z:   the chi-squared z (as above) of the pairs of their lowest 6 bits
+ *   same:      how many times more often than chance the two put a key in the
+ *              same bucket of a 1024-bucket table
+ *
+ * usage:
+ *   make hashbench
+ *   ./hashbench [-n nkeys] [-S seed] [-C]
+ *       -n nkeys: how many keys in each set (default: 1048576)
+ *       -S seed:  the seed random keys are generated from (default: 1)
+ *       -C:       print the results as CSV (with a header line)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "inthash.h"
+#include "latency.h"
+#include "prng.h"
+
+// how many passes each function is timed for, how many keys avalanche is
+// tested with, and how many of the lowest bits the joint distribution uses
+#define TIMING_PASSES 5
+#define AVALANCHE_KEYS 10000
+#define JOINT_BITS 6
+
+// the hash functions in inthash, and a couple of well-known families to
+// compare them with (all giving 31-bit values, like h1 and h2)
+static int mix31(int64 key);
+static int multshift(int64 key);
+
+typedef struct function {
+	const char *name;
+	int (*hash)(int64 key);
+} Function;
+
+static const Function functions[] = {
+	{"h1", h1},
+	{"h2", h2},
+	{"mix", mix31},
+	{"multshift", multshift},
+};
+#define NFUNCTIONS (int)(sizeof functions / sizeof *functions)
+
+// the sets of keys each function is tested with
+typedef enum keyset {
+	KEYS_RANDOM,		// random 64-bit keys
+	KEYS_SEQUENTIAL,	// 0, 1, 2, ...
+	KEYS_STRIDED,		// 0, 4096, 8192, ... (like page-aligned addresses)
+	KEYS_HIGH,			// keys differing only in their top 32 bits
+	NKEYSETS
+} KeySet;
+static const char *keysetnames[NKEYSETS] = {
+	"random", "sequential", "strided", "high"
+};
+
+// the bucket counts (as numbers of low bits) that uniformity is tested for
+static const int chi_bits[] = {8, 12, 16};
+#define NCHIBITS (int)(sizeof chi_bits / sizeof *chi_bits)
+
+void printusageexit(char *exe);
+void generate_keys(int64 *keys, long nkeys, KeySet set, uint64_t seed);
+double time_hash(const Function *function, const int64 *keys, long nkeys);
+void avalanche(const Function *function, const int64 *keys, long nkeys,
+	double *mean, double *worst);
+double chi_squared_z(const long *counts, long nbuckets, long nkeys);
+double low_bits_z(const Function *function, const int64 *keys, long nkeys,
+	int bits);
+void correlate(const int64 *keys, long nkeys, double *r, double *joint_z,
+	double *same);
+
+/*************************************************************************/
+
+int main(int argc, char **argv) {
+	long nkeys = 1 << 20;
+	uint64_t seed = 1;
+	bool csv = false;
+
+	int option;
+	while ((option = getopt(argc, argv, "n:S:C")) != -1) {
+		switch (option) {
+			case 'n':
+				nkeys = atol(optarg);
+				break;
+			case 'S':
+				seed = strtoull(optarg, NULL, 0);
+				break;
+			case 'C':
+				csv = true;
+				break;
+			default:
+				printusageexit(argv[0]);
+		}
+	}
+	if (nkeys < AVALANCHE_KEYS) {
+		printusageexit(argv[0]);
+	}
+
+	int64 *keys = malloc((sizeof *keys) * nkeys);
+	if (!keys) {
+		fprintf(stderr, "out of memory for %ld keys\n", nkeys);
+		exit(EXIT_FAILURE);
+	}
+
+	if (csv) {
+		printf("keys,function,ns_per_hash,avalanche_mean,avalanche_worst");
+		int b;
+		for (b = 0; b < NCHIBITS; b++) {
+			printf(",chi2_z_%d", chi_bits[b]);
+		}
+		printf(",h1_h2_r,h1_h2_joint_z,h1_h2_same\n");
+	}
+
+	KeySet set;
+	for (set = 0; set < NKEYSETS; set++) {
+		generate_keys(keys, nkeys, set, seed);
+
+		double r, joint_z, same;
+		correlate(keys, nkeys, &r, &joint_z, &same);
+
+		if (!csv) {
+			printf("--- %s keys (%ld) ---\n", keysetnames[set], nkeys);
+			printf("%-10s %8s %10s %10s", "function", "ns/hash", "avalanche",
+				"worst");
+			int b;
+			for (b = 0; b < NCHIBITS; b++) {
+				printf("  chi2 z %2d", chi_bits[b]);
+			}
+			printf("\n");
+		}
+
+		int f;
+		for (f = 0; f < NFUNCTIONS; f++) {
+			const Function *function = &functions[f];
+			double ns = time_hash(function, keys, nkeys);
+			double mean, worst;
+			avalanche(function, keys, AVALANCHE_KEYS, &mean, &worst);
+
+			if (csv) {
+				printf("%s,%s,%.3f,%.4f,%.4f", keysetnames[set],
+					function->name, ns, mean, worst);
+			} else {
+				printf("%-10s %8.3f %10.4f %10.4f", function->name, ns, mean,
+					worst);
+			}
+			int b;
+			for (b = 0; b < NCHIBITS; b++) {
+				double z = low_bits_z(function, keys, nkeys, chi_bits[b]);
+				printf(csv ? ",%.2f" : " %10.2f", z);
+			}
+			if (csv) {
+				printf(",%.5f,%.2f,%.3f\n", r, joint_z, same);
+			} else {
+				printf("\n");
+			}
+		}
+
+		if (!csv) {
+			printf("h1 vs h2: r = %.5f, joint z (%d bits) = %.2f, "
+				"same bucket = %.3fx chance\n", r, JOINT_BITS, joint_z, same);
+		}
+	}
+
+	free(keys);
+	return 0;
+}
+
+/*************************************************************************/
+
+// splitmix64's finaliser, keeping the top 31 bits: about as good as a 64-bit
+// mixer gets, for comparison
+static int mix31(int64 key) {
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+	return (key ^ (key >> 31)) >> 33;
+}
+
+// multiply-shift (Dietzfelbinger et al.): multiply by a random odd constant
+// and keep the top 31 bits, which is universal and costs one multiplication
+static int multshift(int64 key) {
+	return (key * 0x9e3779b97f4a7c15ull) >> 33;
+}
+
+// fill 'keys' with 'nkeys' keys of set 'set' (random ones from 'seed')
+void generate_keys(int64 *keys, long nkeys, KeySet set, uint64_t seed) {
+	Prng rng;
+	prng_seed(&rng, seed);
+	long i;
+	for (i = 0; i < nkeys; i++) {
+		switch (set) {
+			case KEYS_RANDOM:
+				keys[i] = prng_next(&rng);
+				break;
+			case KEYS_SEQUENTIAL:
+				keys[i] = i;
+				break;
+			case KEYS_STRIDED:
+				keys[i] = (int64)i << 12;
+				break;
+			case KEYS_HIGH:
+				keys[i] = (int64)i << 32;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+// how many nanoseconds 'function' takes to hash each of 'keys', at best
+double time_hash(const Function *function, const int64 *keys, long nkeys) {
+	// the hashes are added up (and the total kept in a volatile) so that the
+	// compiler can't skip computing them
+	volatile int64 sink = 0;
+	double best = INFINITY;
+	int pass;
+	for (pass = 0; pass < TIMING_PASSES; pass++) {
+		int64 total = 0;
+		uint64_t start = latency_monotonic();
+		long i;
+		for (i = 0; i < nkeys; i++) {
+			total += function->hash(keys[i]);
+		}
+		double ns = (latency_monotonic() - start) * 1.0 / nkeys;
+		sink += total;
+		if (ns < best) {
+			best = ns;
+		}
+	}
+	(void)sink;
+	return best;
+}
+
+// test 'function' for avalanche with (the first 'nkeys' of) 'keys': the mean
+// probability, over every key bit and hash bit, that flipping the key bit
+// flips the hash bit, and the worst pair's distance from a half
+void avalanche(const Function *function, const int64 *keys, long nkeys,
+		double *mean, double *worst) {
+	static long flips[64][31];
+	int in, out;
+	for (in = 0; in < 64; in++) {
+		for (out = 0; out < 31; out++) {
+			flips[in][out] = 0;
+		}
+	}
+
+	long i;
+	for (i = 0; i < nkeys; i++) {
+		int hash = function->hash(keys[i]);
+		for (in = 0; in < 64; in++) {
+			int diff = hash ^ function->hash(keys[i] ^ (1ull << in));
+			for (out = 0; out < 31; out++) {
+				flips[in][out] += (diff >> out) & 1;
+			}
+		}
+	}
+
+	*mean = 0;
+	*worst = 0;
+	for (in = 0; in < 64; in++) {
+		for (out = 0; out < 31; out++) {
+			double p = flips[in][out] * 1.0 / nkeys;
+			*mean += p;
+			if (fabs(p - 0.5) > *worst) {
+				*worst = fabs(p - 0.5);
+			}
+		}
+	}
+	*mean /= 64 * 31;
+}
+
+// the chi-squared statistic of 'nkeys' keys counted into 'nbuckets' buckets
+// ('counts'), as its distance from its expected value in standard deviations
+double chi_squared_z(const long *counts, long nbuckets, long nkeys) {
+	double expected = nkeys * 1.0 / nbuckets;
+	double chi2 = 0;
+	long i;
+	for (i = 0; i < nbuckets; i++) {
+		chi2 += (counts[i] - expected) * (counts[i] - expected) / expected;
+	}
+	double df = nbuckets - 1;
+	return (chi2 - df) / sqrt(2 * df);
+}
+
+// how evenly the lowest 'bits' bits of 'function's hashes of 'keys' spread
+// them (as a chi-squared z)
+double low_bits_z(const Function *function, const int64 *keys, long nkeys,
+		int bits) {
+	long nbuckets = 1l << bits;
+	long *counts = calloc(nbuckets, sizeof *counts);
+	if (!counts) {
+		fprintf(stderr, "out of memory for %ld buckets\n", nbuckets);
+		exit(EXIT_FAILURE);
+	}
+	long i;
+	for (i = 0; i < nkeys; i++) {
+		counts[function->hash(keys[i]) & (nbuckets - 1)]++;
+	}
+	double z = chi_squared_z(counts, nbuckets, nkeys);
+	free(counts);
+	return z;
+}
+
+// how related h1 and h2 are over 'keys': the correlation of their values, the
+// chi-squared z of the pairs of their lowest JOINT_BITS bits, and how many
+// times more often than chance their lowest 10 bits are the same
+void correlate(const int64 *keys, long nkeys, double *r, double *joint_z,
+		double *same) {
+	static long counts[1 << (2 * JOINT_BITS)];
+	long nbuckets = 1 << (2 * JOINT_BITS), i;
+	for (i = 0; i < nbuckets; i++) {
+		counts[i] = 0;
+	}
+
+	double sum1 = 0, sum2 = 0, sum11 = 0, sum22 = 0, sum12 = 0;
+	long nsame = 0;
+	int mask = (1 << JOINT_BITS) - 1;
+	for (i = 0; i < nkeys; i++) {
+		int a = h1(keys[i]), b = h2(keys[i]);
+		sum1 += a;
+		sum2 += b;
+		sum11 += (double)a * a;
+		sum22 += (double)b * b;
+		sum12 += (double)a * b;
+		counts[(a & mask) << JOINT_BITS | (b & mask)]++;
+		nsame += (a & 1023) == (b & 1023);
+	}
+
+	double cov = sum12 / nkeys - (sum1 / nkeys) * (sum2 / nkeys);
+	double var1 = sum11 / nkeys - (sum1 / nkeys) * (sum1 / nkeys);
+	double var2 = sum22 / nkeys - (sum2 / nkeys) * (sum2 / nkeys);
+	*r = var1 > 0 && var2 > 0 ? cov / sqrt(var1 * var2) : 0;
+	*joint_z = chi_squared_z(counts, nbuckets, nkeys);
+	*same = nsame * 1024.0 / nkeys;
+}
+
+/*************************************************************************/
+
+// print usage information and exit
+void printusageexit(char *exe) {
+	fprintf(stderr, "usage: %s [-n nkeys] [-S seed] [-C]\n", exe);
+	fprintf(stderr, " -n nkeys: how many keys in each set (default: 1048576, "
+		"at least %d)\n", AVALANCHE_KEYS);
+	fprintf(stderr, " -S seed:  the seed random keys are generated from "
+		"(default: 1)\n");
+	fprintf(stderr, " -C:       print the results as CSV\n");
+	exit(EXIT_FAILURE);
+}
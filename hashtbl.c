@@ -6,11 +6,18 @@
  * by Matt Farrugia <matt.farrugia@unimelb.edu.au>
  */
 
+// for posix_memalign
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "hashtbl.h"
+#include "perfcount.h"
+#include "trace.h"
 
 #include "tables/linear.h"	// provided
 #include "tables/xtndbl1.h"	// provided
@@ -18,6 +25,8 @@
 #include "tables/xtndbln.h" // create for part 2
 #include "tables/xuckoo.h"	// create for part 3
 #include "tables/xuckoon.h"	// create for part 4
+#include "tables/xtndbld.h"	// disk-backed version of part 2
+#include "tables/linhash.h"	// linear hashing, for comparison with part 2
 
 // converts from a string representation to a TableType constant:
 // "linear"			->	LINEAR
@@ -26,6 +35,8 @@
 // "2" or "xtndbln"	->	XTNDBLN
 // "3" or "xuckoo"	->	XUCKOO
 // "4" or "xuckoon"	->	XUCKOON
+// "xtndbld"		->	XTNDBLD
+// "linhash"		->	LINHASH
 TableType strtotype(char *str) {
 	if (strcmp("linear",  str) == 0) {
 		return LINEAR;
@@ -45,16 +56,149 @@ TableType strtotype(char *str) {
     if (strcmp("4", str) == 0 || strcmp("xuckoon",  str) == 0) {
         return XUCKOON;
     }
+	if (strcmp("xtndbld", str) == 0) {
+		return XTNDBLD;
+	}
+	if (strcmp("linhash", str) == 0) {
+		return LINHASH;
+	}
 	return NOTYPE;
 }
 
+// converts from a TableType constant to its (main) string representation, e.g.
+// CUCKOO -> "cuckoo"
+const char *typetostr(TableType type) {
+	switch (type) {
+		case LINEAR:
+			return "linear";
+		case XTNDBL1:
+			return "xtndbl1";
+		case CUCKOO:
+			return "cuckoo";
+		case XTNDBLN:
+			return "xtndbln";
+		case XUCKOO:
+			return "xuckoo";
+		case XUCKOON:
+			return "xuckoon";
+		case XTNDBLD:
+			return "xtndbld";
+		case LINHASH:
+			return "linhash";
+		default:
+			return "none";
+	}
+}
+
+// the size of a cache line, in bytes
+#define CACHE_LINE 64
+
+// one shard of a sharded table: a table of its own, and the lock that is held
+// for each operation on it
+typedef struct shard {
+	HashTable *table;		// the shard's (unsharded) table
+	pthread_mutex_t lock;
+	long waits;				// how many times the lock was already held
+} Shard;
+
+// shards are padded out to a whole number of cache lines (and allocated on a
+// cache line boundary), so that threads working on different shards never
+// write to the same line
+typedef union padded_shard {
+	Shard shard;
+	char padding[(sizeof (Shard) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE];
+} PaddedShard;
+
 // a HashTable is a wrapper for an actual table structure of some type,
 // and it also remembers is own type
 struct table {
 	TableType type;	// what type of hash table is this?
-	void *table;	// the hash table itself
+	void *table;	// the hash table itself (NULL if it's sharded)
+	int nshards;	// how many shards it's split into (0 if it isn't)
+	int shift;		// how far to shift a key's hash (h1) to get its shard
+	PaddedShard *shards;
 };
 
+/* * * *
+ * helper functions for sharded tables
+ */
+
+// the shard of 'table' that 'key' belongs to: its hash's top bits (the tables
+// address keys by the low bits of their hashes, so within a shard they are
+// spread out as well as ever)
+static Shard *shard_of(HashTable *table, int64 key) {
+	return &table->shards[h1(key) >> table->shift].shard;
+}
+
+// take 'shard's lock, counting whether another thread had to be waited for
+static void lock_shard(Shard *shard) {
+	if (pthread_mutex_trylock(&shard->lock) != 0) {
+		pthread_mutex_lock(&shard->lock);
+		shard->waits++;
+	}
+}
+
+// and release it again
+static void unlock_shard(Shard *shard) {
+	pthread_mutex_unlock(&shard->lock);
+}
+
+// lookup each of the 'nkeys' keys in 'keys' in sharded 'table', as for
+// hash_table_lookup_many: the keys are sorted by shard first (a counting sort
+// of their positions), so that each shard's keys are looked up in one batch,
+// taking its lock only once
+static void sharded_lookup_many(HashTable *table, const int64 *keys, int nkeys,
+		bool *found) {
+	if (nkeys <= 0) {
+		return;
+	}
+	int *ends = calloc(table->nshards, sizeof *ends);
+	int *order = malloc((sizeof *order) * nkeys);
+	int64 *sorted = malloc((sizeof *sorted) * nkeys);
+	bool *sortedfound = malloc((sizeof *sortedfound) * nkeys);
+	assert(ends && order && sorted && sortedfound);
+
+	// count the keys in each shard, and work out where each shard's keys
+	// start (then move each shard's start along as its keys are placed, so
+	// that it ends up where the shard's keys end)
+	int i, s;
+	for (i = 0; i < nkeys; i++) {
+		ends[h1(keys[i]) >> table->shift]++;
+	}
+	int start = 0;
+	for (s = 0; s < table->nshards; s++) {
+		int count = ends[s];
+		ends[s] = start;
+		start += count;
+	}
+	for (i = 0; i < nkeys; i++) {
+		int position = ends[h1(keys[i]) >> table->shift]++;
+		order[position] = i;
+		sorted[position] = keys[i];
+	}
+
+	// look each shard's keys up together, then put the results back in order
+	start = 0;
+	for (s = 0; s < table->nshards; s++) {
+		if (ends[s] > start) {
+			Shard *shard = &table->shards[s].shard;
+			lock_shard(shard);
+			hash_table_lookup_many(shard->table, &sorted[start],
+				ends[s] - start, &sortedfound[start]);
+			unlock_shard(shard);
+		}
+		start = ends[s];
+	}
+	for (i = 0; i < nkeys; i++) {
+		found[order[i]] = sortedfound[i];
+	}
+
+	free(ends);
+	free(order);
+	free(sorted);
+	free(sortedfound);
+}
+
 // initialise a hash table of type 'type' with initial size 'size',
 // and return its pointer
 HashTable *new_hash_table(TableType type, int size) {
@@ -86,12 +230,58 @@ HashTable *new_hash_table(TableType type, int size) {
         case XUCKOON:
             table->table = new_xuckoon_hash_table(size);
             break;
+		case XTNDBLD:
+			table->table = new_xtndbld_hash_table(size);
+			break;
+		case LINHASH:
+			table->table = new_linhash_hash_table(size);
+			break;
 		default:
 			// no such table type? error. release memory and return NULL
 			free(table);
 			return NULL;
 	}
 
+	table->nshards = 0;
+	table->shards = NULL;
+	return table;
+}
+
+// initialise a sharded hash table: 'nshards' (a power of two, up to MAX_SHARDS)
+// independent tables of type 'type', each with initial size 'size', and return
+// its pointer (or NULL, if 'type' or 'nshards' isn't valid)
+HashTable *new_sharded_hash_table(TableType type, int size, int nshards) {
+	if (type <= NOTYPE || type >= NTABLETYPES || nshards < 1 ||
+		nshards > MAX_SHARDS || (nshards & (nshards - 1)) != 0) {
+		return NULL;
+	}
+
+	HashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->type = type;
+	table->table = NULL;
+	table->nshards = nshards;
+
+	// the shard is the top log2(nshards) bits of the 31-bit hash
+	int bits = 0;
+	while ((1 << bits) < nshards) {
+		bits++;
+	}
+	table->shift = 31 - bits;
+
+	void *shards;
+	int error = posix_memalign(&shards, CACHE_LINE,
+		(sizeof *table->shards) * nshards);
+	assert(error == 0);
+	table->shards = shards;
+	int s;
+	for (s = 0; s < nshards; s++) {
+		Shard *shard = &table->shards[s].shard;
+		shard->table = new_hash_table(type, size);
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->waits = 0;
+	}
+
 	return table;
 }
 
@@ -99,6 +289,19 @@ HashTable *new_hash_table(TableType type, int size) {
 void free_hash_table(HashTable *table) {
 	assert(table != NULL);
 
+	// a sharded table's shards are tables in their own right
+	if (table->shards) {
+		int s;
+		for (s = 0; s < table->nshards; s++) {
+			Shard *shard = &table->shards[s].shard;
+			free_hash_table(shard->table);
+			pthread_mutex_destroy(&shard->lock);
+		}
+		free(table->shards);
+		free(table);
+		return;
+	}
+
 	// free the actual table, using the relevant free function for its type
 	switch (table->type) {
 		case LINEAR:
@@ -119,6 +322,12 @@ void free_hash_table(HashTable *table) {
         case XUCKOON:
             free_xuckoon_hash_table(table->table);
             break;
+		case XTNDBLD:
+			free_xtndbld_hash_table(table->table);
+			break;
+		case LINHASH:
+			free_linhash_hash_table(table->table);
+			break;
 		default:
 			break;
 	}
@@ -132,30 +341,56 @@ void free_hash_table(HashTable *table) {
 bool hash_table_insert(HashTable *table, int64 key) {
 	assert(table != NULL);
 
+	// a sharded table passes the key on to its shard, under the shard's lock
+	if (table->shards) {
+		Shard *shard = shard_of(table, key);
+		lock_shard(shard);
+		bool inserted = hash_table_insert(shard->table, key);
+		unlock_shard(shard);
+		return inserted;
+	}
+
+	PERF_START(start); // start counting hardware events
+	bool inserted;
+
 	// forward the call onto the relevant insert function
 	switch (table->type) {
 		case LINEAR:
-			return linear_hash_table_insert(table->table, key);
+			inserted = linear_hash_table_insert(table->table, key);
+			break;
 		case XTNDBL1:
-			return xtndbl1_hash_table_insert(table->table, key);
+			inserted = xtndbl1_hash_table_insert(table->table, key);
+			break;
 		case CUCKOO:
-			return cuckoo_hash_table_insert(table->table, key);
+			inserted = cuckoo_hash_table_insert(table->table, key);
+			break;
 		case XTNDBLN:
-			return xtndbln_hash_table_insert(table->table, key);
+			inserted = xtndbln_hash_table_insert(table->table, key);
+			break;
 		case XUCKOO:
-			return xuckoo_hash_table_insert(table->table, key);
+			inserted = xuckoo_hash_table_insert(table->table, key);
+			break;
         case XUCKOON:
-            return xuckoon_hash_table_insert(table->table, key);
+            inserted = xuckoon_hash_table_insert(table->table, key);
+            break;
+		case XTNDBLD:
+			inserted = xtndbld_hash_table_insert(table->table, key);
+			break;
+		case LINHASH:
+			inserted = linhash_hash_table_insert(table->table, key);
+			break;
 		default:
-			return false;
+			inserted = false;
+			break;
 	}
+
+	PERF_STOP(PERF_INSERT, start, 1);
+	return inserted;
 }
 
-// lookup whether 'key' is inside 'table'
+// lookup whether 'key' is inside 'table' (without counting hardware events)
 // returns true if found, false if not
-bool hash_table_lookup(HashTable *table, int64 key) {
-	assert(table != NULL);
-
+static bool lookup_key(HashTable *table, int64 key) {
 	// forward the call onto the relevant lookup function
 	switch (table->type) {
 		case LINEAR:
@@ -170,15 +405,85 @@ bool hash_table_lookup(HashTable *table, int64 key) {
 			return xuckoo_hash_table_lookup(table->table, key);
         case XUCKOON:
             return xuckoon_hash_table_lookup(table->table, key);
+		case XTNDBLD:
+			return xtndbld_hash_table_lookup(table->table, key);
+		case LINHASH:
+			return linhash_hash_table_lookup(table->table, key);
 		default:
 			return false;
 	}
 }
 
-// print the contents of 'table' to stdout
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool hash_table_lookup(HashTable *table, int64 key) {
+	assert(table != NULL);
+
+	// a sharded table passes the key on to its shard, under the shard's lock
+	if (table->shards) {
+		Shard *shard = shard_of(table, key);
+		lock_shard(shard);
+		bool found = hash_table_lookup(shard->table, key);
+		unlock_shard(shard);
+		return found;
+	}
+
+	PERF_START(start); // start counting hardware events
+
+	bool found = lookup_key(table, key);
+
+	PERF_STOP(PERF_LOOKUP, start, 1);
+	return found;
+}
+
+// lookup whether each of the 'nkeys' keys in 'keys' is inside 'table', setting
+// the corresponding element of 'found' to true if it is, false if not
+void hash_table_lookup_many(HashTable *table, const int64 *keys, int nkeys,
+		bool *found) {
+	assert(table != NULL);
+	if (table->shards) {
+		sharded_lookup_many(table, keys, nkeys, found);
+		return;
+	}
+	PERF_START(start); // start counting hardware events
+
+	// the cuckoo tables have a batched lookup function of their own, which
+	// overlaps the cache misses of many lookups at once (other tables just
+	// look the keys up one at a time)
+	int i;
+	switch (table->type) {
+		case XUCKOO:
+			xuckoo_hash_table_lookup_many(table->table, keys, nkeys, found);
+			break;
+		case XUCKOON:
+			xuckoon_hash_table_lookup_many(table->table, keys, nkeys, found);
+			break;
+		default:
+			for (i = 0; i < nkeys; i++) {
+				found[i] = lookup_key(table, keys[i]);
+			}
+			break;
+	}
+
+	PERF_STOP(PERF_LOOKUP, start, nkeys);
+}
+
+// print the contents of 'table' to stdout (shard by shard, if it's sharded)
 void hash_table_print(HashTable *table) {
 	assert(table != NULL);
 
+	if (table->shards) {
+		int s;
+		for (s = 0; s < table->nshards; s++) {
+			Shard *shard = &table->shards[s].shard;
+			printf("shard %d of %d:\n", s, table->nshards);
+			lock_shard(shard);
+			hash_table_print(shard->table);
+			unlock_shard(shard);
+		}
+		return;
+	}
+
 	// call the relevant print function
 	switch (table->type) {
 		case LINEAR:
@@ -199,15 +504,19 @@ void hash_table_print(HashTable *table) {
         case XUCKOON:
             xuckoon_hash_table_print(table->table);
             break;
+		case XTNDBLD:
+			xtndbld_hash_table_print(table->table);
+			break;
+		case LINHASH:
+			linhash_hash_table_print(table->table);
+			break;
 		default:
 			break;
 	}
 }
 
-// print some statistics about 'table' to stdout
-void hash_table_stats(HashTable *table) {
-	assert(table != NULL);
-
+// print some statistics about (unsharded) 'table' to stdout
+static void print_stats(HashTable *table) {
 	// call the relevant print stats function
 	switch (table->type) {
 		case LINEAR:
@@ -228,7 +537,149 @@ void hash_table_stats(HashTable *table) {
         case XUCKOON:
             xuckoon_hash_table_stats(table->table);
             break;
+		case XTNDBLD:
+			xtndbld_hash_table_stats(table->table);
+			break;
+		case LINHASH:
+			linhash_hash_table_stats(table->table);
+			break;
 		default:
 			break;
 	}
 }
+
+// print some statistics about 'table' to stdout (shard by shard, if it's
+// sharded)
+void hash_table_stats(HashTable *table) {
+	assert(table != NULL);
+
+	if (table->shards) {
+		printf("%s table in %d shards (by the top %d bits of h1)\n",
+			typetostr(table->type), table->nshards, 31 - table->shift);
+		int s;
+		for (s = 0; s < table->nshards; s++) {
+			Shard *shard = &table->shards[s].shard;
+			lock_shard(shard);
+			printf("shard %d of %d (%ld lock waits):\n", s, table->nshards,
+				shard->waits);
+			print_stats(shard->table);
+			unlock_shard(shard);
+		}
+	} else {
+		print_stats(table);
+	}
+
+	// and, if hardware events are being counted, what each operation cost
+	perf_print(23);
+}
+
+// gather statistics about 'table' into a single structure, the same for every
+// type of table
+TableStats hash_table_get_stats(HashTable *table) {
+	assert(table != NULL);
+
+	TableStats stats;
+	initialise_table_stats(&stats);
+	stats.type = typetostr(table->type);
+
+	// a sharded table's statistics are its shards' put together
+	if (table->shards) {
+		int s;
+		for (s = 0; s < table->nshards; s++) {
+			Shard *shard = &table->shards[s].shard;
+			lock_shard(shard);
+			TableStats shardstats = hash_table_get_stats(shard->table);
+			shardstats.lock_waits = shard->waits;
+			unlock_shard(shard);
+			merge_table_stats(&stats, &shardstats);
+		}
+		stats.shards = table->nshards;
+		return stats;
+	}
+
+	// forward the call onto the relevant function to fill in the rest
+	switch (table->type) {
+		case LINEAR:
+			linear_hash_table_get_stats(table->table, &stats);
+			break;
+		case XTNDBL1:
+			xtndbl1_hash_table_get_stats(table->table, &stats);
+			break;
+		case CUCKOO:
+			cuckoo_hash_table_get_stats(table->table, &stats);
+			break;
+		case XTNDBLN:
+			xtndbln_hash_table_get_stats(table->table, &stats);
+			break;
+		case XUCKOO:
+			xuckoo_hash_table_get_stats(table->table, &stats);
+			break;
+		case XUCKOON:
+			xuckoon_hash_table_get_stats(table->table, &stats);
+			break;
+		case XTNDBLD:
+			xtndbld_hash_table_get_stats(table->table, &stats);
+			break;
+		case LINHASH:
+			linhash_hash_table_get_stats(table->table, &stats);
+			break;
+		default:
+			break;
+	}
+
+	return stats;
+}
+
+// print the events traced on (unsharded) 'table' into the Chrome trace being
+// printed, on track 'track'
+static void print_trace(HashTable *table, int track) {
+	// call the relevant print trace function
+	switch (table->type) {
+		case LINEAR:
+			linear_hash_table_trace(table->table, track);
+			break;
+		case XTNDBL1:
+			xtndbl1_hash_table_trace(table->table, track);
+			break;
+		case CUCKOO:
+			cuckoo_hash_table_trace(table->table, track);
+			break;
+		case XTNDBLN:
+			xtndbln_hash_table_trace(table->table, track);
+			break;
+		case XUCKOO:
+			xuckoo_hash_table_trace(table->table, track);
+			break;
+		case XUCKOON:
+			xuckoon_hash_table_trace(table->table, track);
+			break;
+		case XTNDBLD:
+			xtndbld_hash_table_trace(table->table, track);
+			break;
+		case LINHASH:
+			linhash_hash_table_trace(table->table, track);
+			break;
+		default:
+			break;
+	}
+}
+
+// print the resize, split and cycle events traced on 'table' to stdout as
+// Chrome trace JSON (with each shard on a track of its own, if it's sharded)
+void hash_table_trace(HashTable *table) {
+	assert(table != NULL);
+
+	trace_print_chrome_begin();
+	if (table->shards) {
+		int s;
+		for (s = 0; s < table->nshards; s++) {
+			Shard *shard = &table->shards[s].shard;
+			lock_shard(shard);
+			print_trace(shard->table, s + 1);
+			unlock_shard(shard);
+		}
+	} else {
+		print_trace(table, 1);
+	}
+	trace_print_chrome_end();
+}
@@ -11,11 +11,13 @@
 
 #include <stdbool.h>
 #include "inthash.h"
+#include "tablestats.h"
 
 // enumerated type containing constants for the various types of hash table
 // supported
 typedef enum type {
-	NOTYPE = -1, LINEAR, XTNDBL1, CUCKOO, XTNDBLN, XUCKOO, XUCKOON
+	NOTYPE = -1, LINEAR, XTNDBL1, CUCKOO, XTNDBLN, XUCKOO, XUCKOON, XTNDBLD,
+	LINHASH, NTABLETYPES
 } TableType;
 
 // converts from a string representation to a TableType constant:
@@ -25,14 +27,39 @@ typedef enum type {
 // "2" or "xtndbln"	->	XTNDBLN
 // "3" or "xuckoo"	->	XUCKOO
 // "3" or "xuckoon"	->	XUCKOON
+// "xtndbld"		->	XTNDBLD
+// "linhash"		->	LINHASH
 TableType strtotype(char *str);
 
+// converts from a TableType constant to its (main) string representation, e.g.
+// CUCKOO -> "cuckoo"
+const char *typetostr(TableType type);
+
 typedef struct table HashTable;
 
+// the most shards a sharded table can be split into
+#define MAX_SHARDS 256
+
 // initialise a hash table of type 'type' with initial size 'size',
 // and return its pointer
 HashTable *new_hash_table(TableType type, int size);
 
+// initialise a sharded hash table: 'nshards' (a power of two, up to MAX_SHARDS)
+// independent tables of type 'type', each with initial size 'size', and return
+// its pointer (or NULL, if 'type' or 'nshards' isn't valid)
+//
+// each key belongs to the shard picked out by the top bits of its hash (h1),
+// which the tables themselves never use to address it, since they all take
+// the low bits (or the hash modulo their size). each shard has a lock of its
+// own, held for each operation on it, so all of the functions below can be
+// called on a sharded table from many threads at once: threads only wait for
+// each other when their keys are in the same shard, and a shard that is busy
+// resizing only holds up the operations on its own keys
+//
+// (the hardware event counters of perfcount.h are an exception: they count
+// the thread that opened them, and are only meant for single-threaded runs)
+HashTable *new_sharded_hash_table(TableType type, int size, int nshards);
+
 // free all memory associated with 'table'
 void free_hash_table(HashTable *table);
 
@@ -44,10 +71,25 @@ bool hash_table_insert(HashTable *table, int64 key);
 // returns true if found, false if not
 bool hash_table_lookup(HashTable *table, int64 key);
 
-// print the contents of 'table' to stdout
+// lookup whether each of the 'nkeys' keys in 'keys' is inside 'table', setting
+// the corresponding element of 'found' to true if it is, false if not
+void hash_table_lookup_many(HashTable *table, const int64 *keys, int nkeys,
+		bool *found);
+
+// print the contents of 'table' to stdout (shard by shard, if it's sharded)
 void hash_table_print(HashTable *table);
 
-// print some statistics about 'table' to stdout
+// print some statistics about 'table' to stdout (shard by shard, if it's
+// sharded), along with the hardware events counted per operation, if they're
+// being counted: see perfcount.h
 void hash_table_stats(HashTable *table);
 
+// gather statistics about 'table' into a single structure, the same for every
+// type of table (and for a sharded table, for all of its shards together)
+TableStats hash_table_get_stats(HashTable *table);
+
+// print the resize, split and cycle events traced on 'table' to stdout as
+// Chrome trace JSON (with each shard on a track of its own, if it's sharded)
+void hash_table_trace(HashTable *table);
+
 #endif
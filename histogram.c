@@ -0,0 +1,108 @@
+/* * * * * * * * *
+ * Module for counting the distribution of small whole-number quantities, such
+ * as probe lengths, eviction chain lengths or bucket occupancies: small values
+ * are counted exactly, and larger values in buckets that double in width, so
+ * that the tail of the distribution can be seen as well as its mean
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "histogram.h"
+
+// set up 'histogram' with no values added yet
+void initialise_histogram(Histogram *histogram) {
+	memset(histogram, 0, sizeof *histogram);
+}
+
+// add all of the values counted in 'other' to 'histogram'
+void histogram_merge(Histogram *histogram, const Histogram *other) {
+	int i;
+	for (i = 0; i < HISTOGRAM_NBUCKETS; i++) {
+		histogram->counts[i] += other->counts[i];
+	}
+	histogram->count += other->count;
+	histogram->total += other->total;
+	if (other->max > histogram->max) {
+		histogram->max = other->max;
+	}
+}
+
+// the smallest value counted in bucket 'bucket'
+long histogram_bucket_min(int bucket) {
+	if (bucket < 1 << HISTOGRAM_EXACT_BITS) {
+		return bucket;
+	}
+	int bits = bucket - (1 << HISTOGRAM_EXACT_BITS) + HISTOGRAM_EXACT_BITS + 1;
+	return 1L << (bits - 1);
+}
+
+// the largest value counted in bucket 'bucket'
+long histogram_bucket_max(int bucket) {
+	if (bucket == HISTOGRAM_NBUCKETS - 1) {
+		return LONG_MAX;
+	}
+	return histogram_bucket_min(bucket + 1) - 1;
+}
+
+// the value that a fraction 'p' of the values in 'histogram' are no larger than
+// (to within the width of a bucket)
+long histogram_percentile(const Histogram *histogram, double p) {
+	long rank = p * histogram->count;
+	if (rank < p * histogram->count || rank == 0) {
+		rank++;
+	}
+	long seen = 0;
+	int i;
+	for (i = 0; i < HISTOGRAM_NBUCKETS; i++) {
+		seen += histogram->counts[i];
+		if (seen >= rank) {
+			// no value is larger than the largest one
+			long value = histogram_bucket_max(i);
+			return value < histogram->max ? value : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+// the mean of the values in 'histogram' (0 if there are none)
+double histogram_mean(const Histogram *histogram) {
+	return histogram->count ? histogram->total * 1.0 / histogram->count : 0;
+}
+
+// print a summary of 'histogram' (its count, mean, percentiles and maximum)
+// labelled 'label', and then how many values fell in each non-empty bucket,
+// with the label right-aligned to 'width' characters
+void histogram_print(const Histogram *histogram, const char *label, int width) {
+	if (histogram->count == 0) {
+		printf("%*s: none\n", width, label);
+		return;
+	}
+	printf("%*s: count %ld, mean %.3f, p50 %ld, p99 %ld, p999 %ld, max %ld\n",
+		width, label, histogram->count, histogram_mean(histogram),
+		histogram_percentile(histogram, 0.5),
+		histogram_percentile(histogram, 0.99),
+		histogram_percentile(histogram, 0.999), histogram->max);
+
+	// each non-empty bucket as 'value:count' (or 'min-max:count')
+	printf("%*s ", width, "");
+	int i;
+	for (i = 0; i < HISTOGRAM_NBUCKETS; i++) {
+		if (histogram->counts[i] == 0) {
+			continue;
+		}
+		long min = histogram_bucket_min(i), max = histogram_bucket_max(i);
+		if (min == max) {
+			printf(" %ld:%ld", min, histogram->counts[i]);
+		} else if (max == LONG_MAX) {
+			printf(" %ld+:%ld", min, histogram->counts[i]);
+		} else {
+			printf(" %ld-%ld:%ld", min, max, histogram->counts[i]);
+		}
+	}
+	printf("\n");
+}
@@ -0,0 +1,69 @@
+/* * * * * * * * *
+ * Module for counting the distribution of small whole-number quantities, such
+ * as probe lengths, eviction chain lengths or bucket occupancies: small values
+ * are counted exactly, and larger values in buckets that double in width, so
+ * that the tail of the distribution can be seen as well as its mean
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+// values below 2^HISTOGRAM_EXACT_BITS each get their own bucket; beyond that,
+// each bucket holds all values with the same highest set bit
+#define HISTOGRAM_EXACT_BITS 4
+#define HISTOGRAM_NBUCKETS (32 - HISTOGRAM_EXACT_BITS + (1 << HISTOGRAM_EXACT_BITS))
+
+// a histogram of the values added to it
+typedef struct histogram {
+	long counts[HISTOGRAM_NBUCKETS];	// how many values fell in each bucket
+	long count;		// how many values have been added
+	long total;		// the sum of those values
+	long max;		// the largest of those values
+} Histogram;
+
+// set up 'histogram' with no values added yet
+void initialise_histogram(Histogram *histogram);
+
+// the bucket that non-negative 'value' is counted in
+static inline int histogram_bucket(long value) {
+	if (value < 1 << HISTOGRAM_EXACT_BITS) {
+		return value;
+	}
+	int bits = 64 - __builtin_clzl(value);
+	int bucket = (1 << HISTOGRAM_EXACT_BITS) + bits - HISTOGRAM_EXACT_BITS - 1;
+	return bucket < HISTOGRAM_NBUCKETS ? bucket : HISTOGRAM_NBUCKETS - 1;
+}
+
+// count one more occurrence of non-negative 'value' in 'histogram'
+static inline void histogram_add(Histogram *histogram, long value) {
+	histogram->counts[histogram_bucket(value)]++;
+	histogram->count++;
+	histogram->total += value;
+	if (value > histogram->max) {
+		histogram->max = value;
+	}
+}
+
+// add all of the values counted in 'other' to 'histogram'
+void histogram_merge(Histogram *histogram, const Histogram *other);
+
+// the smallest and largest values counted in bucket 'bucket'
+long histogram_bucket_min(int bucket);
+long histogram_bucket_max(int bucket);
+
+// the value that a fraction 'p' of the values in 'histogram' are no larger than
+// (to within the width of a bucket)
+long histogram_percentile(const Histogram *histogram, double p);
+
+// the mean of the values in 'histogram' (0 if there are none)
+double histogram_mean(const Histogram *histogram);
+
+// print a summary of 'histogram' (its count, mean, percentiles and maximum)
+// labelled 'label', and then how many values fell in each non-empty bucket,
+// with the label right-aligned to 'width' characters
+void histogram_print(const Histogram *histogram, const char *label, int width);
+
+#endif
@@ -26,3 +26,25 @@ int h1(int64 k) {
 int h2(int64 k) {
 	return (A2 * k + B2) % p2;
 }
+
+// the inverse of odd number 'a', modulo 2^64 (by Newton's method: each step
+// doubles the number of correct low bits, starting from 3 correct bits)
+static int64 inverse(int64 a) {
+	int64 x = a;
+	int i;
+	for (i = 0; i < 5; i++) {
+		x *= 2 - a * x;
+	}
+	return x;
+}
+
+// the 'j'th key that h1 maps to 'hash': the key for which ( A1 * key + B1 )
+// comes to the 'j'th number above 'hash' that's 'hash' modulo p1
+int64 h1_preimage(int hash, int64 j) {
+	return inverse(A1) * ((int64)hash + j * p1 - B1);
+}
+
+// the 'j'th key that h2 maps to 'hash'
+int64 h2_preimage(int hash, int64 j) {
+	return inverse(A2) * ((int64)hash + j * p2 - B2);
+}
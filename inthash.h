@@ -36,4 +36,11 @@ int h1(int64 k);
 // second available hash function
 int h2(int64 k);
 
+// since A is odd, ( A * key + B ) can be undone (modulo 2^64), so keys can be
+// crafted to hash to any value: these return the 'j'th key that h1 (or h2)
+// maps to 'hash' (0 <= hash < p), with different keys for different 'j' (up to
+// 2^32). useful for generating adversarial input
+int64 h1_preimage(int hash, int64 j);
+int64 h2_preimage(int hash, int64 j);
+
 #endif
@@ -0,0 +1,203 @@
+/* * * * * * * * *
+ * Module for reading and writing key traces: binary files of the operations a
+ * program performed on a hash table (each an insert or a lookup of a 64-bit
+ * key, with the time it arrived), so that a real stream of keys can be
+ * recorded once and replayed against any type of table later
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "keytrace.h"
+#include "latency.h"
+
+// the names of each operation, for printing
+const char *keytrace_opnames[NKEYTRACEOPS] = {"insert", "lookup"};
+
+// the magic bytes every trace starts with
+static const char magic[6] = {'K', 'T', 'R', 'A', 'C', 'E'};
+
+/* * * *
+ * helper functions
+ */
+
+// write 'value' to 'file' as 8 little-endian bytes
+static void put_fixed(FILE *file, uint64_t value) {
+	int i;
+	for (i = 0; i < 8; i++) {
+		putc((value >> (8 * i)) & 0xff, file);
+	}
+}
+
+// write 'value' to 'file' as a varint
+static void put_varint(FILE *file, uint64_t value) {
+	while (value >= 0x80) {
+		putc((value & 0x7f) | 0x80, file);
+		value >>= 7;
+	}
+	putc(value, file);
+}
+
+// read 8 little-endian bytes from 'file' into 'value'; returns false if the
+// file ends first
+static bool get_fixed(FILE *file, uint64_t *value) {
+	*value = 0;
+	int i;
+	for (i = 0; i < 8; i++) {
+		int byte = getc(file);
+		if (byte == EOF) {
+			return false;
+		}
+		*value |= (uint64_t)byte << (8 * i);
+	}
+	return true;
+}
+
+// read a varint from 'file' into 'value'; returns false if the file ends first
+// (or the varint is longer than any 64-bit value's)
+static bool get_varint(FILE *file, uint64_t *value) {
+	*value = 0;
+	int shift;
+	for (shift = 0; shift < 64; shift += 7) {
+		int byte = getc(file);
+		if (byte == EOF) {
+			return false;
+		}
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// a signed difference, zigzag encoded so that numbers near zero (of either
+// sign) are small: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+static uint64_t zigzag(int64_t value) {
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+static int64_t unzigzag(uint64_t value) {
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// a new trace reading or writing 'file'
+static KeyTrace *new_keytrace(FILE *file, bool compressed) {
+	KeyTrace *trace = malloc(sizeof *trace);
+	assert(trace);
+	trace->file = file;
+	trace->compressed = compressed;
+	trace->start = latency_monotonic();
+	trace->time = 0;
+	trace->key = 0;
+	trace->nrecords = 0;
+	return trace;
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// create a new trace in file 'filename' (compressed, if 'compressed'), ready to
+// write records to, starting its clock now; returns NULL (having printed why to
+// stderr) if the file can't be created
+KeyTrace *keytrace_create(const char *filename, bool compressed) {
+	FILE *file = fopen(filename, "wb");
+	if (!file) {
+		perror(filename);
+		return NULL;
+	}
+	fwrite(magic, sizeof magic, 1, file);
+	putc(KEYTRACE_VERSION, file);
+	putc(compressed ? KEYTRACE_COMPRESSED : 0, file);
+	return new_keytrace(file, compressed);
+}
+
+// write a record of operation 'op' on 'key' to 'trace', arriving now
+void keytrace_write(KeyTrace *trace, KeyTraceOp op, int64 key) {
+	assert(trace != NULL);
+
+	uint64_t time = latency_monotonic() - trace->start;
+	putc(op, trace->file);
+	if (trace->compressed) {
+		put_varint(trace->file, time - trace->time);
+		put_varint(trace->file, zigzag(key - trace->key));
+	} else {
+		put_fixed(trace->file, time);
+		put_fixed(trace->file, key);
+	}
+	trace->time = time;
+	trace->key = key;
+	trace->nrecords++;
+}
+
+// open the trace in file 'filename', ready to read records from; returns NULL
+// (having printed why to stderr) if it can't be opened or isn't a key trace
+KeyTrace *keytrace_open(const char *filename) {
+	FILE *file = fopen(filename, "rb");
+	if (!file) {
+		perror(filename);
+		return NULL;
+	}
+	unsigned char header[8];
+	if (fread(header, sizeof header, 1, file) != 1 ||
+		memcmp(header, magic, sizeof magic) != 0) {
+		fprintf(stderr, "%s: not a key trace\n", filename);
+		fclose(file);
+		return NULL;
+	}
+	if (header[6] != KEYTRACE_VERSION) {
+		fprintf(stderr, "%s: key trace version %d, not %d\n", filename,
+			header[6], KEYTRACE_VERSION);
+		fclose(file);
+		return NULL;
+	}
+	return new_keytrace(file, header[7] & KEYTRACE_COMPRESSED);
+}
+
+// read the next record of 'trace' into 'record'; returns false at the end of
+// the trace (or if the rest of it is damaged, which is printed to stderr)
+bool keytrace_read(KeyTrace *trace, KeyTraceRecord *record) {
+	assert(trace != NULL);
+
+	int op = getc(trace->file);
+	if (op == EOF) {
+		return false;
+	}
+	uint64_t time, key;
+	bool complete;
+	if (trace->compressed) {
+		complete = get_varint(trace->file, &time) &&
+			get_varint(trace->file, &key);
+		time += trace->time;
+		key = trace->key + unzigzag(key);
+	} else {
+		complete = get_fixed(trace->file, &time) &&
+			get_fixed(trace->file, &key);
+	}
+	if (!complete || op >= NKEYTRACEOPS) {
+		fprintf(stderr, "key trace damaged after %ld records\n",
+			trace->nrecords);
+		return false;
+	}
+
+	record->time = trace->time = time;
+	record->op = op;
+	record->key = trace->key = key;
+	trace->nrecords++;
+	return true;
+}
+
+// close 'trace' (flushing any records still to be written) and free it
+void keytrace_close(KeyTrace *trace) {
+	assert(trace != NULL);
+
+	if (fclose(trace->file) != 0) {
+		perror("key trace");
+	}
+	free(trace);
+}
@@ -0,0 +1,82 @@
+/* * * * * * * * *
+ * Module for reading and writing key traces: binary files of the operations a
+ * program performed on a hash table (each an insert or a lookup of a 64-bit
+ * key, with the time it arrived), so that a real stream of keys can be
+ * recorded once and replayed against any type of table later
+ *
+ * a trace starts with an 8-byte header: the magic "KTRACE", a version number,
+ * and flags. then come the records, in one of two encodings:
+ *   plain:      the operation (1 byte), then the time (8 bytes) and the key
+ *               (8 bytes), little-endian, for 17 bytes a record
+ *   compressed: the operation (1 byte), then the time since the previous
+ *               record, and the difference from the previous key (zigzag
+ *               encoded, so that small negative differences stay small), as
+ *               varints (7 bits a byte, least significant first, with the top
+ *               bit set on all but the last byte). keys that are close together
+ *               and operations that come quickly take only a few bytes
+ * times are in nanoseconds since the trace started
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef KEYTRACE_H
+#define KEYTRACE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inthash.h"
+
+// the format's version, and its flags
+#define KEYTRACE_VERSION 1
+#define KEYTRACE_COMPRESSED 0x01
+
+// the operations that are traced
+typedef enum keytrace_op {
+	KEYTRACE_INSERT,
+	KEYTRACE_LOOKUP,
+	NKEYTRACEOPS
+} KeyTraceOp;
+
+// the names of each operation ("insert", "lookup"), for printing
+extern const char *keytrace_opnames[NKEYTRACEOPS];
+
+// one traced operation
+typedef struct keytrace_record {
+	uint64_t time;	// when it arrived, in nanoseconds since the trace started
+	KeyTraceOp op;	// what it was
+	int64 key;		// and the key it was for
+} KeyTraceRecord;
+
+// a key trace file, open for writing or for reading
+typedef struct keytrace {
+	FILE *file;
+	bool compressed;	// whether the records are delta/varint encoded
+	uint64_t start;		// when the trace started (writing only, monotonic ns)
+	uint64_t time;		// the time of the previous record
+	int64 key;			// the key of the previous record
+	long nrecords;		// how many records have been written or read
+} KeyTrace;
+
+// create a new trace in file 'filename' (compressed, if 'compressed'), ready to
+// write records to, starting its clock now; returns NULL (having printed why to
+// stderr) if the file can't be created
+KeyTrace *keytrace_create(const char *filename, bool compressed);
+
+// write a record of operation 'op' on 'key' to 'trace', arriving now
+void keytrace_write(KeyTrace *trace, KeyTraceOp op, int64 key);
+
+// open the trace in file 'filename', ready to read records from; returns NULL
+// (having printed why to stderr) if it can't be opened or isn't a key trace
+KeyTrace *keytrace_open(const char *filename);
+
+// read the next record of 'trace' into 'record'; returns false at the end of
+// the trace (or if the rest of it is damaged, which is printed to stderr)
+bool keytrace_read(KeyTrace *trace, KeyTraceRecord *record);
+
+// close 'trace' (flushing any records still to be written) and free it
+void keytrace_close(KeyTrace *trace);
+
+#endif
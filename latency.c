@@ -0,0 +1,177 @@
+/* * * * * * * * *
+ * Module for timing hash table operations: the latency of each operation is
+ * counted in a histogram for its type of operation (with buckets that get
+ * logarithmically wider, like an HDR histogram), so that percentiles can be
+ * reported as well as the total. timing can be switched off at compile time,
+ * in which case it costs nothing at all
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+// for clock_gettime()
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "latency.h"
+
+// the names of each type of operation, for printing
+const char *latency_opnames[NLATENCYOPS] = {"insert", "lookup"};
+
+// the current time on the monotonic clock, in nanoseconds (whether or not
+// operations are being timed)
+uint64_t latency_monotonic(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#if LATENCY_TIMING != TIMING_OFF
+
+// the shortest time to measure the clock against the monotonic clock for, to
+// work out how long a tick is (in nanoseconds)
+#define CALIBRATION_NS 10000000
+
+// the time (on both clocks) when the first table started timing: how long a
+// tick is is worked out from how far each clock has moved on since then
+static uint64_t reference_ticks = 0;
+static uint64_t reference_ns = 0;
+
+/* * * *
+ * helper functions
+ */
+
+// how many nanoseconds one tick of the clock being used lasts
+static double ns_per_tick() {
+#if LATENCY_TIMING == TIMING_RDTSC
+	// wait until enough time has passed to measure the timestamp counter
+	// accurately (usually it already has, since the first table was created)
+	uint64_t ticks, ns;
+	do {
+		ticks = latency_now();
+		ns = latency_monotonic();
+	} while (ns - reference_ns < CALIBRATION_NS);
+	return (ns - reference_ns) * 1.0 / (ticks - reference_ticks);
+#else
+	return 1.0;
+#endif
+}
+
+// the largest latency that is counted in histogram bucket 'index'
+static uint64_t bucket_value(int index) {
+	if (index < 1 << LATENCY_SUB_BITS) {
+		return index;
+	}
+	int shift = (index >> LATENCY_SUB_BITS) - 1;
+	uint64_t top = (1 << LATENCY_SUB_BITS) |
+		(index & ((1 << LATENCY_SUB_BITS) - 1));
+	return ((top + 1) << shift) - 1;
+}
+
+// the latency that a fraction 'p' of the operations counted in 'histogram'
+// took no longer than (to within the width of a histogram bucket)
+static uint64_t percentile(const LatencyHistogram *histogram, double p) {
+	uint64_t rank = p * histogram->count;
+	if (rank < p * histogram->count || rank == 0) {
+		rank++;
+	}
+	uint64_t seen = 0;
+	int i;
+	for (i = 0; i < LATENCY_NBUCKETS; i++) {
+		seen += histogram->counts[i];
+		if (seen >= rank) {
+			// no operation took longer than the slowest one
+			uint64_t value = bucket_value(i);
+			return value < histogram->max ? value : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// set up 'latency' with no operations counted yet
+void initialise_latency(Latency *latency) {
+	memset(latency, 0, sizeof *latency);
+
+	if (reference_ns == 0) {
+		reference_ticks = latency_now();
+		reference_ns = latency_monotonic();
+	}
+}
+
+// summarise the latencies of each type of operation counted in 'latency' in
+// 'summaries' (one for each type), and return the total time spent on them all
+// in seconds
+double latency_summarise(const Latency *latency,
+		LatencySummary summaries[NLATENCYOPS]) {
+	double ns = ns_per_tick();
+
+	uint64_t total = 0;
+	int op;
+	for (op = 0; op < NLATENCYOPS; op++) {
+		const LatencyHistogram *histogram = &latency->ops[op];
+		summaries[op].count = histogram->count;
+		summaries[op].p50 = percentile(histogram, 0.5) * ns;
+		summaries[op].p99 = percentile(histogram, 0.99) * ns;
+		summaries[op].p999 = percentile(histogram, 0.999) * ns;
+		summaries[op].max = histogram->max * ns;
+		total += histogram->total;
+	}
+	return total * ns / 1e9;
+}
+
+// print the total time spent on operations counted in 'latency', and the
+// percentiles of each type's latency, with labels right-aligned to 'width'
+// characters
+void latency_print(const Latency *latency, int width) {
+	LatencySummary summaries[NLATENCYOPS];
+	double seconds = latency_summarise(latency, summaries);
+	printf("%*s: %.6f sec\n", width, "time spent", seconds);
+
+	// the latency percentiles of each type of operation, in nanoseconds
+	int op;
+	for (op = 0; op < NLATENCYOPS; op++) {
+		char label[32];
+		sprintf(label, "%s latency", latency_opnames[op]);
+		if (summaries[op].count == 0) {
+			printf("%*s: none\n", width, label);
+			continue;
+		}
+		printf("%*s: p50 %.0f ns, p99 %.0f ns, p999 %.0f ns, max %.0f ns\n",
+			width, label, summaries[op].p50, summaries[op].p99,
+			summaries[op].p999, summaries[op].max);
+	}
+}
+
+#else
+
+// set up 'latency' with no operations counted yet
+void initialise_latency(Latency *latency) {
+	latency->unused = 0;
+}
+
+// with timing switched off, there's nothing to summarise
+double latency_summarise(const Latency *latency,
+		LatencySummary summaries[NLATENCYOPS]) {
+	int op;
+	for (op = 0; op < NLATENCYOPS; op++) {
+		summaries[op].count = 0;
+		summaries[op].p50 = summaries[op].p99 = summaries[op].p999 = 0;
+		summaries[op].max = 0;
+	}
+	return 0;
+}
+
+// with timing switched off, there's no time to print
+void latency_print(const Latency *latency, int width) {
+	printf("%*s: not measured\n", width, "time spent");
+}
+
+#endif
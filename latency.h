@@ -0,0 +1,150 @@
+/* * * * * * * * *
+ * Module for timing hash table operations: the latency of each operation is
+ * counted in a histogram for its type of operation (with buckets that get
+ * logarithmically wider, like an HDR histogram), so that percentiles can be
+ * reported as well as the total. timing can be switched off at compile time,
+ * in which case it costs nothing at all
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// how to time operations (compile with -DLATENCY_TIMING=t to change this):
+#define TIMING_OFF       0 // don't time operations at all
+#define TIMING_MONOTONIC 1 // read clock_gettime(CLOCK_MONOTONIC)
+#define TIMING_RDTSC     2 // read the CPU's timestamp counter (x86 only),
+                           // which is much cheaper
+#ifndef LATENCY_TIMING
+#if defined(__x86_64__) || defined(__i386__)
+#define LATENCY_TIMING TIMING_RDTSC
+#else
+#define LATENCY_TIMING TIMING_MONOTONIC
+#endif
+#endif
+
+#if LATENCY_TIMING == TIMING_RDTSC
+#include <x86intrin.h>
+#endif
+
+// the types of operation that are timed separately
+typedef enum latency_op {
+	LATENCY_INSERT, LATENCY_LOOKUP, NLATENCYOPS
+} LatencyOp;
+
+// the names of each type of operation ("insert", "lookup"), for printing
+extern const char *latency_opnames[NLATENCYOPS];
+
+// a summary of the latencies of one type of operation, in nanoseconds
+typedef struct latency_summary {
+	long count;		// how many operations there were
+	double p50;		// the latency half of them took no longer than
+	double p99;		// ... 99% of them took no longer than
+	double p999;	// ... 99.9% of them took no longer than
+	double max;		// the latency of the slowest one
+} LatencySummary;
+
+// each power of two is divided into 2^LATENCY_SUB_BITS histogram buckets, so
+// every latency is counted within about 3% of its true value
+#define LATENCY_SUB_BITS 5
+#define LATENCY_NBUCKETS ((64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+// the current time on the monotonic clock, in nanoseconds (whether or not
+// operations are being timed)
+uint64_t latency_monotonic(void);
+
+#if LATENCY_TIMING != TIMING_OFF
+
+// a histogram of the latencies of one type of operation, measured in ticks of
+// whichever clock is being used
+typedef struct latency_histogram {
+	uint64_t counts[LATENCY_NBUCKETS];	// operations per histogram bucket
+	uint64_t count;						// operations in total
+	uint64_t total;						// ticks taken by all the operations
+	uint64_t max;						// ticks taken by the slowest one
+} LatencyHistogram;
+
+// the latencies of each type of operation on one table
+typedef struct latency {
+	LatencyHistogram ops[NLATENCYOPS];
+} Latency;
+
+// the current time, in ticks of whichever clock is being used
+static inline uint64_t latency_now(void) {
+#if LATENCY_TIMING == TIMING_RDTSC
+	return __rdtsc();
+#else
+	return latency_monotonic();
+#endif
+}
+
+// count 'n' operations of type 'op' that took 'ticks' between them (each is
+// counted as taking an equal share)
+static inline void latency_record(Latency *latency, LatencyOp op,
+		uint64_t ticks, int n) {
+	if (n == 0) {
+		return;
+	}
+	LatencyHistogram *histogram = &latency->ops[op];
+	uint64_t each = ticks / n;
+
+	// small latencies get a bucket each; larger ones share a bucket with the
+	// others with the same top LATENCY_SUB_BITS+1 bits
+	int index = each;
+	if (each >= 1 << LATENCY_SUB_BITS) {
+		int exponent = 63 - __builtin_clzll(each);
+		int shift = exponent - LATENCY_SUB_BITS;
+		index = (shift + 1) << LATENCY_SUB_BITS |
+			((each >> shift) & ((1 << LATENCY_SUB_BITS) - 1));
+	}
+
+	histogram->counts[index] += n;
+	histogram->count += n;
+	histogram->total += ticks;
+	if (each > histogram->max) {
+		histogram->max = each;
+	}
+}
+
+// start timing an operation, remembering the time in a new variable 'start'
+#define LATENCY_START(start) uint64_t start = latency_now()
+
+// finish timing an operation of type 'op' (or 'n' of them) that started at
+// 'start', counting it in 'latency'
+#define LATENCY_STOP(latency, op, start) \
+	latency_record(latency, op, latency_now() - (start), 1)
+#define LATENCY_STOP_MANY(latency, op, start, n) \
+	latency_record(latency, op, latency_now() - (start), n)
+
+#else
+
+// with timing switched off, there's nothing to keep and nothing to do
+typedef struct latency {
+	char unused;
+} Latency;
+
+#define LATENCY_START(start)
+#define LATENCY_STOP(latency, op, start)
+#define LATENCY_STOP_MANY(latency, op, start, n)
+
+#endif
+
+// set up 'latency' with no operations counted yet
+void initialise_latency(Latency *latency);
+
+// summarise the latencies of each type of operation counted in 'latency' in
+// 'summaries' (one for each type), and return the total time spent on them all
+// in seconds (all zero with timing switched off)
+double latency_summarise(const Latency *latency,
+		LatencySummary summaries[NLATENCYOPS]);
+
+// print the total time spent on operations counted in 'latency', and the
+// percentiles of each type's latency, with labels right-aligned to 'width'
+// characters
+void latency_print(const Latency *latency, int width);
+
+#endif
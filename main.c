@@ -14,12 +14,18 @@
 
 #include "inthash.h"
 #include "hashtbl.h"
+#include "perfcount.h"
+#include "keytrace.h"
 
 // command line options
 #define DEFAULT_SIZE 4
 typedef struct options {
 	TableType type;
 	int initial_size;
+	int shards;	// how many shards to split the table into (0 not to)
+	bool perf;	// count hardware events (cycles, cache misses, ...)
+	char *record;	// file to record a key trace of the commands in (or NULL)
+	bool compress;	// compress the key trace (delta/varint)
 } Options;
 Options get_options(int argc, char** argv);
 
@@ -30,6 +36,9 @@ Options get_options(int argc, char** argv);
 #define LOOKUP 'l'
 #define PRINT  'p'
 #define STATS  's'
+#define JSON   'j'
+#define CSV    'c'
+#define TRACE  't'
 #define HELP   'h'
 #define QUIT   'q'
 #define MAX_LINE_LEN 80
@@ -38,21 +47,44 @@ int get_command(char *operation, int64 *key);
 
 // main program
 
-void run_interpreter(HashTable *table);
+void run_interpreter(HashTable *table, KeyTrace *trace);
 
 int main(int argc, char **argv) {
 	
 	// get command line options (to determine table type, size, etc.)
 	Options options = get_options(argc, argv);
 
-	// create hashtable (of given type)
-	HashTable *table = new_hash_table(options.type, options.initial_size);
+	// start counting hardware events, if asked to (and if they can be)
+	if (options.perf) {
+		perf_open();
+	}
+
+	// start recording a key trace, if asked to
+	KeyTrace *trace = NULL;
+	if (options.record) {
+		trace = keytrace_create(options.record, options.compress);
+		if (!trace) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// create hashtable (of given type, sharded if asked to be)
+	HashTable *table;
+	if (options.shards) {
+		table = new_sharded_hash_table(options.type, options.initial_size,
+			options.shards);
+	} else {
+		table = new_hash_table(options.type, options.initial_size);
+	}
 
 	// start the interpreter loop
-	run_interpreter(table);
+	run_interpreter(table, trace);
 
 	// done!
 	free_hash_table(table);
+	if (trace) {
+		keytrace_close(trace);
+	}
 	return 0;
 }
 
@@ -62,17 +94,22 @@ void print_operations() {
 	printf(" %c number: lookup is 'number' in table\n", LOOKUP);
 	printf(" %c: print table\n", PRINT);
 	printf(" %c: print stats\n", STATS);
+	printf(" %c: print stats as JSON\n", JSON);
+	printf(" %c: print stats as CSV (with a header line)\n", CSV);
+	printf(" %c: print resize/split events as Chrome trace JSON\n", TRACE);
 	printf(" %c: quit\n", QUIT);
 }
 
-// run the interpreter, reading and performing commands until 'quit'
-void run_interpreter(HashTable *table) {
+// run the interpreter, reading and performing commands until 'quit' (recording
+// the inserts and lookups in 'trace', unless it's NULL)
+void run_interpreter(HashTable *table, KeyTrace *trace) {
 	
 	// print a prompt at the beginning
 	printf("enter a command (h for help):\n");
 	
 	char op;
 	int64 key;
+	TableStats stats;
 	
 	// then loop, getting and executing commands, until 'quit'
 	while (true) {
@@ -92,6 +129,9 @@ void run_interpreter(HashTable *table) {
 				
 				} else {
 					// perform the insertion
+					if (trace) {
+						keytrace_write(trace, KEYTRACE_INSERT, key);
+					}
 					if (hash_table_insert(table, key)) {
 						printf("%llu inserted\n", key);
 					} else {
@@ -107,6 +147,9 @@ void run_interpreter(HashTable *table) {
 
 				} else {
 					// perform the lookup
+					if (trace) {
+						keytrace_write(trace, KEYTRACE_LOOKUP, key);
+					}
 					if (hash_table_lookup(table, key)) {
 						printf("%llu found\n", key);
 					} else {
@@ -125,6 +168,22 @@ void run_interpreter(HashTable *table) {
 				hash_table_stats(table);
 				break;
 
+			case JSON:
+				// print the stats in machine-readable form
+				stats = hash_table_get_stats(table);
+				print_table_stats_json(&stats);
+				break;
+
+			case CSV:
+				stats = hash_table_get_stats(table);
+				print_table_stats_csv(&stats, true);
+				break;
+
+			case TRACE:
+				// print the timeline of resizes and splits (for chrome://tracing)
+				hash_table_trace(table);
+				break;
+
 			default:
 				// display error
 				printf("unknown operation '%c'\n", op);
@@ -172,11 +231,12 @@ int get_command(char *operation, int64 *key) {
 Options get_options(int argc, char** argv) {
 	
 	// create the Options structure with defaults
-	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE };
+	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE,
+		.shards = 0, .perf = false, .record = NULL, .compress = false };
 
 	// use C's built-in getopt function to scan inputs by flag
 	char option;
-	while ((option = getopt(argc, argv, "t:s:")) != EOF){
+	while ((option = getopt(argc, argv, "t:s:P:pr:z")) != EOF){
 		switch (option){
 			case 't': // set hash table type
 				options.type = strtotype(optarg);
@@ -184,6 +244,18 @@ Options get_options(int argc, char** argv) {
 			case 's': // set hash table size
 				options.initial_size = atoi(optarg);
 				break;
+			case 'P': // shard the table
+				options.shards = atoi(optarg);
+				break;
+			case 'p': // count hardware events
+				options.perf = true;
+				break;
+			case 'r': // record a key trace
+				options.record = optarg;
+				break;
+			case 'z': // compress the key trace
+				options.compress = true;
+				break;
 			default:
 				break;
 		}
@@ -203,6 +275,9 @@ Options get_options(int argc, char** argv) {
 			" -t 2 or xtndbln: n-key extendible hash table (part 2)\n");
 		fprintf(stderr, " -t 3 or xuckoo:  1-key extendible cuckoo table (part 3)\n");
         fprintf(stderr, " -t 4 or xuckoon:  n-key extendible cuckoo table (bonus part)\n");
+		fprintf(stderr, " -t xtndbld: disk-backed n-key extendible hash table "
+			"(-s sets how many pages to cache in memory)\n");
+		fprintf(stderr, " -t linhash: n-key linear hashing table\n");
 		valid = false;
 	}
 
@@ -213,6 +288,14 @@ Options get_options(int argc, char** argv) {
 		valid = false;
 	}
 
+	// validate number of shards
+	if(options.shards < 0 || options.shards > MAX_SHARDS ||
+		(options.shards & (options.shards - 1)) != 0) {
+		fprintf(stderr, "please specify a power of two number of shards, "
+			"up to %d, using the -P flag\n", MAX_SHARDS);
+		valid = false;
+	}
+
 	// check overall validity before continuing
 	if(!valid){
 		exit(EXIT_FAILURE);
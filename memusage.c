@@ -0,0 +1,72 @@
+/* * * * * * * * *
+ * Module for keeping exact counts of the memory a hash table has allocated,
+ * broken down by what the memory is used for. a table allocates and frees
+ * through these functions, so its counts are always the bytes it holds right
+ * now (not counting the allocator's own overhead)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "memusage.h"
+
+// the names of each kind of memory, for printing
+const char *memory_kindnames[NMEMORYKINDS] = {
+	"table", "directory", "buckets", "keys", "occupancy", "scratch",
+	"instrumentation"
+};
+
+// set up 'usage' with no memory counted yet
+void initialise_memory_usage(MemoryUsage *usage) {
+	memset(usage, 0, sizeof *usage);
+}
+
+// count 'size' more bytes of 'kind' in 'usage' (negative for bytes freed), for
+// memory that wasn't allocated through the functions below
+void memory_count(MemoryUsage *usage, MemoryKind kind, long size) {
+	usage->bytes[kind] += size;
+	assert(usage->bytes[kind] >= 0 && "error: freed more memory than allocated");
+}
+
+// malloc() 'size' bytes of 'kind', counting them in 'usage'
+void *memory_malloc(MemoryUsage *usage, MemoryKind kind, size_t size) {
+	void *ptr = malloc(size);
+	if (ptr) {
+		memory_count(usage, kind, size);
+	}
+	return ptr;
+}
+
+// realloc() 'ptr' (of 'oldsize' bytes of 'kind') to 'size' bytes, counting
+// the difference in 'usage'
+void *memory_realloc(MemoryUsage *usage, MemoryKind kind, void *ptr,
+		size_t oldsize, size_t size) {
+	ptr = realloc(ptr, size);
+	if (ptr) {
+		memory_count(usage, kind, (long)size - (long)oldsize);
+	}
+	return ptr;
+}
+
+// free() 'ptr' (of 'size' bytes of 'kind'), no longer counting it in 'usage'
+void memory_free(MemoryUsage *usage, MemoryKind kind, void *ptr, size_t size) {
+	free(ptr);
+	memory_count(usage, kind, -(long)size);
+}
+
+// how many bytes are currently allocated altogether for the table itself (that
+// is, not counting MEMORY_INSTRUMENTATION)
+long memory_total(const MemoryUsage *usage) {
+	long total = 0;
+	int kind;
+	for (kind = 0; kind < NMEMORYKINDS; kind++) {
+		if (kind != MEMORY_INSTRUMENTATION) {
+			total += usage->bytes[kind];
+		}
+	}
+	return total;
+}
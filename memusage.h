@@ -0,0 +1,59 @@
+/* * * * * * * * *
+ * Module for keeping exact counts of the memory a hash table has allocated,
+ * broken down by what the memory is used for. a table allocates and frees
+ * through these functions, so its counts are always the bytes it holds right
+ * now (not counting the allocator's own overhead)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef MEMUSAGE_H
+#define MEMUSAGE_H
+
+#include <stddef.h>
+
+// what a block of memory is used for
+typedef enum memory_kind {
+	MEMORY_TABLE,		// the table structures themselves
+	MEMORY_DIRECTORY,	// directory entries
+	MEMORY_BUCKETS,		// bucket (or overflow page) headers
+	MEMORY_KEYS,		// arrays of key slots
+	MEMORY_OCCUPANCY,	// arrays marking which key slots are in use
+	MEMORY_SCRATCH,		// working space for inserting or splitting
+	MEMORY_INSTRUMENTATION,	// latency and probe histograms and traces, which
+							// aren't part of the table (see memory_total)
+	NMEMORYKINDS
+} MemoryKind;
+
+// the names of each kind of memory ("table", "directory", ...), for printing
+extern const char *memory_kindnames[NMEMORYKINDS];
+
+// how many bytes are currently allocated for each kind of memory
+typedef struct memory_usage {
+	long bytes[NMEMORYKINDS];
+} MemoryUsage;
+
+// set up 'usage' with no memory counted yet
+void initialise_memory_usage(MemoryUsage *usage);
+
+// count 'size' more bytes of 'kind' in 'usage' (negative for bytes freed), for
+// memory that wasn't allocated through the functions below
+void memory_count(MemoryUsage *usage, MemoryKind kind, long size);
+
+// malloc() 'size' bytes of 'kind', counting them in 'usage'
+void *memory_malloc(MemoryUsage *usage, MemoryKind kind, size_t size);
+
+// realloc() 'ptr' (of 'oldsize' bytes of 'kind') to 'size' bytes, counting
+// the difference in 'usage'
+void *memory_realloc(MemoryUsage *usage, MemoryKind kind, void *ptr,
+	size_t oldsize, size_t size);
+
+// free() 'ptr' (of 'size' bytes of 'kind'), no longer counting it in 'usage'
+void memory_free(MemoryUsage *usage, MemoryKind kind, void *ptr, size_t size);
+
+// how many bytes are currently allocated altogether for the table itself (that
+// is, not counting MEMORY_INSTRUMENTATION)
+long memory_total(const MemoryUsage *usage);
+
+#endif
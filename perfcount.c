@@ -0,0 +1,295 @@
+/* * * * * * * * *
+ * Module for counting hardware events (cycles, instructions, cache and TLB
+ * misses, branch misses) with Linux's perf_event_open, so that the tables can
+ * be compared by what their operations cost the CPU, not just by how long they
+ * take. the counters measure the whole program (well, its calling thread) and
+ * are read around each insert, each lookup and each resize, with the
+ * differences added up separately for each phase
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+// for syscall()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+
+#include "perfcount.h"
+
+#if PERF_COUNTERS
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// the names of each event and each phase, for printing
+const char *perf_eventnames[NPERFEVENTS] = {
+	"cycles", "instructions", "LLC misses", "dTLB misses", "branch misses"
+};
+const char *perf_phasenames[NPERFPHASES] = {"insert", "lookup", "resize"};
+
+// the events counted for each phase so far, and how many operations they were
+// counted over
+static uint64_t totals[NPERFPHASES][NPERFEVENTS];
+static long operations[NPERFPHASES];
+
+#if PERF_COUNTERS
+
+// the counters, opened as one group so they're all read at once (with each
+// event's file descriptor, and the index of its value in the group's reading,
+// or -1 if it isn't open)
+static int leader = -1;
+static int fds[NPERFEVENTS];
+static int position[NPERFEVENTS] = {-1, -1, -1, -1, -1};
+static int nopen = 0;
+
+// how deep inside resizes the program is right now
+static int resize_depth = 0;
+
+// a cache event's config: which cache, doing what, and with what result
+#define CACHE_EVENT(cache, op, result) \
+	((cache) | (op) << 8 | (result) << 16)
+
+// the type and config to open each event with
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[NPERFEVENTS] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_LL,
+		PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+	{PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB,
+		PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+/* * * *
+ * helper functions
+ */
+
+// open event 'event' for the calling thread, in the group led by 'group' (or
+// leading a new group, if 'group' is -1); returns its file descriptor, or -1
+static int open_event(PerfEvent event, int group) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = events[event].type;
+	attr.config = events[event].config;
+	attr.exclude_kernel = 1;	// just the program's own work (this also
+	attr.exclude_hv = 1;		// leaves out the cost of reading the counters)
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+		PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// try to open the counters for the calling thread, and start them counting;
+// returns true if at least one of them could be opened (and prints why not to
+// stderr if none could)
+bool perf_open(void) {
+	if (leader >= 0) {
+		return true;
+	}
+
+	// open whichever events this CPU (and kernel) will count: the first one
+	// that opens leads the group
+	int error = 0;
+	int event;
+	for (event = 0; event < NPERFEVENTS; event++) {
+		int fd = open_event(event, leader);
+		if (fd < 0) {
+			error = errno;
+			continue;
+		}
+		if (leader < 0) {
+			leader = fd;
+		}
+		fds[event] = fd;
+		position[event] = nopen++;
+	}
+
+	if (leader < 0) {
+		fprintf(stderr, "couldn't open hardware counters: %s\n",
+			strerror(error));
+		return false;
+	}
+	perf_reset();
+	return true;
+}
+
+// close the counters (so that a child process can open its own, say)
+void perf_close(void) {
+	int event;
+	for (event = 0; event < NPERFEVENTS; event++) {
+		if (position[event] >= 0) {
+			close(fds[event]);
+			position[event] = -1;
+		}
+	}
+	leader = -1;
+	nopen = 0;
+}
+
+// are the counters open (and is 'event' being counted)?
+bool perf_is_open(void) {
+	return leader >= 0;
+}
+bool perf_is_counted(PerfEvent event) {
+	return position[event] >= 0;
+}
+
+// read every counter into 'sample' (nothing, if they aren't open)
+void perf_read(PerfSample *sample) {
+	sample->counting = false;
+	if (leader < 0) {
+		return;
+	}
+
+	// the group's reading is how many counters there are, how long they have
+	// been enabled and running for, then each counter's value
+	uint64_t reading[3 + NPERFEVENTS];
+	ssize_t n = read(leader, reading, sizeof reading);
+	if (n < (ssize_t)(3 * sizeof *reading)) {
+		return;
+	}
+
+	// if the PMU has had to share its counters with other programs, the
+	// counts only cover part of the time: scale them up to the whole time
+	uint64_t enabled = reading[1], running = reading[2];
+	double scale = running && running < enabled ? enabled * 1.0 / running : 1;
+	int event;
+	for (event = 0; event < NPERFEVENTS; event++) {
+		if (position[event] >= 0) {
+			sample->counts[event] = reading[3 + position[event]] * scale;
+		}
+	}
+	sample->counting = true;
+}
+
+// count the events since 'start' towards 'n' operations of phase 'phase'
+void perf_count(PerfPhase phase, const PerfSample *start, long n) {
+	if (!start->counting) {
+		return;
+	}
+	PerfSample now;
+	perf_read(&now);
+	int event;
+	for (event = 0; event < NPERFEVENTS; event++) {
+		// (scaling can make a counter appear to go backwards, briefly)
+		if (now.counts[event] > start->counts[event]) {
+			totals[phase][event] += now.counts[event] - start->counts[event];
+		}
+	}
+	operations[phase] += n;
+}
+
+// start and finish counting a resize. resizes can happen inside other resizes
+// (a cuckoo cycle that doubles a table, say), and several events may be traced
+// for one resize, so only the outermost resize is counted, and only once
+void perf_resize_begin(PerfSample *start) {
+	start->counting = false;
+	start->resizing = leader >= 0;
+	if (start->resizing && resize_depth++ == 0) {
+		perf_read(start);
+	}
+}
+void perf_resize_end(PerfSample *start) {
+	if (!start->resizing) {
+		return;
+	}
+	start->resizing = false;
+	resize_depth--;
+	perf_count(PERF_RESIZE, start, 1);
+}
+
+#else
+
+// with counting switched off, the counters can never be opened
+bool perf_open(void) {
+	fprintf(stderr, "couldn't open hardware counters: not compiled in\n");
+	return false;
+}
+void perf_close(void) {
+}
+bool perf_is_open(void) {
+	return false;
+}
+bool perf_is_counted(PerfEvent event) {
+	return false;
+}
+void perf_read(PerfSample *sample) {
+	sample->counting = false;
+}
+void perf_count(PerfPhase phase, const PerfSample *start, long n) {
+}
+void perf_resize_begin(PerfSample *start) {
+	start->counting = false;
+	start->resizing = false;
+}
+void perf_resize_end(PerfSample *start) {
+}
+
+#endif
+
+// how many operations of phase 'phase' have been counted
+long perf_operations(PerfPhase phase) {
+	return operations[phase];
+}
+
+// the average count of 'event' for each operation of phase 'phase' (-1 if the
+// event isn't being counted, or there have been no such operations)
+double perf_per_operation(PerfPhase phase, PerfEvent event) {
+	if (!perf_is_counted(event) || operations[phase] == 0) {
+		return -1;
+	}
+	return totals[phase][event] * 1.0 / operations[phase];
+}
+
+// forget everything counted so far (the counters stay open)
+void perf_reset(void) {
+	memset(totals, 0, sizeof totals);
+	memset(operations, 0, sizeof operations);
+}
+
+// print the average count of each event for each phase's operations (nothing,
+// if the counters aren't open), with labels right-aligned to 'width' characters
+void perf_print(int width) {
+	if (!perf_is_open()) {
+		return;
+	}
+	printf("--- hardware counters (per operation) ---\n");
+
+	// a column for each event
+	printf("%*s ", width, "");
+	int event;
+	for (event = 0; event < NPERFEVENTS; event++) {
+		printf(" %13s", perf_eventnames[event]);
+	}
+	printf("\n");
+
+	// and a row for each phase
+	int phase;
+	for (phase = 0; phase < NPERFPHASES; phase++) {
+		char label[32];
+		sprintf(label, "%s (%ld)", perf_phasenames[phase], operations[phase]);
+		printf("%*s:", width, label);
+		for (event = 0; event < NPERFEVENTS; event++) {
+			double count = perf_per_operation(phase, event);
+			if (count < 0) {
+				printf(" %13s", "-");
+			} else {
+				printf(" %13.2f", count);
+			}
+		}
+		printf("\n");
+	}
+	printf("--- end hardware counters ---\n");
+}
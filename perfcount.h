@@ -0,0 +1,124 @@
+/* * * * * * * * *
+ * Module for counting hardware events (cycles, instructions, cache and TLB
+ * misses, branch misses) with Linux's perf_event_open, so that the tables can
+ * be compared by what their operations cost the CPU, not just by how long they
+ * take. the counters measure the whole program (well, its calling thread) and
+ * are read around each insert, each lookup and each resize, with the
+ * differences added up separately for each phase
+ *
+ * counting has to be switched on at run time (it costs a system call every
+ * time the counters are read), and it can be switched off at compile time, in
+ * which case it costs nothing at all. if the counters can't be opened (no PMU,
+ * as in many virtual machines, or perf_event_paranoid is too strict) nothing is
+ * counted, and nothing is printed
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// whether counting is compiled in at all (compile with -DPERF_COUNTERS=0 to
+// switch it off, which is the default anywhere but Linux)
+#ifndef PERF_COUNTERS
+#ifdef __linux__
+#define PERF_COUNTERS 1
+#else
+#define PERF_COUNTERS 0
+#endif
+#endif
+
+// the hardware events that are counted
+typedef enum perf_event {
+	PERF_CYCLES,		// CPU cycles
+	PERF_INSTRUCTIONS,	// instructions retired
+	PERF_LLC_MISSES,	// last-level cache read misses
+	PERF_DTLB_MISSES,	// data TLB read misses
+	PERF_BRANCH_MISSES,	// mispredicted branches
+	NPERFEVENTS
+} PerfEvent;
+
+// the names of each event ("cycles", "instructions", ...), for printing
+extern const char *perf_eventnames[NPERFEVENTS];
+
+// the phases that events are counted separately for
+typedef enum perf_phase {
+	PERF_INSERT,	// inserting keys (including any resizes they cause)
+	PERF_LOOKUP,	// looking keys up
+	PERF_RESIZE,	// growing a table, splitting buckets or doubling directories
+	NPERFPHASES
+} PerfPhase;
+
+// the names of each phase ("insert", "lookup", "resize"), for printing
+extern const char *perf_phasenames[NPERFPHASES];
+
+// a reading of every counter
+typedef struct perf_sample {
+	uint64_t counts[NPERFEVENTS];	// each event's count so far
+	bool counting;	// whether this reading is to be counted from
+	bool resizing;	// whether this reading started a resize that hasn't
+					// finished yet (see perf_resize_begin)
+} PerfSample;
+
+// try to open the counters for the calling thread, and start them counting;
+// returns true if at least one of them could be opened (and prints why not to
+// stderr if none could)
+bool perf_open(void);
+
+// close the counters (so that a child process can open its own, say)
+void perf_close(void);
+
+// are the counters open (and is 'event' being counted)?
+bool perf_is_open(void);
+bool perf_is_counted(PerfEvent event);
+
+// read every counter into 'sample' (nothing, if they aren't open)
+void perf_read(PerfSample *sample);
+
+// count the events since 'start' towards 'n' operations of phase 'phase'
+void perf_count(PerfPhase phase, const PerfSample *start, long n);
+
+// start and finish counting a resize. resizes can happen inside other resizes
+// (a cuckoo cycle that doubles a table, say), and several events may be traced
+// for one resize, so only the outermost resize is counted, and only once.
+// (these are called wherever a resize is traced, by TRACE_START and TRACE_STOP
+// in trace.h, so resizes aren't counted with tracing switched off)
+void perf_resize_begin(PerfSample *start);
+void perf_resize_end(PerfSample *start);
+
+// how many operations of phase 'phase' have been counted
+long perf_operations(PerfPhase phase);
+
+// the average count of 'event' for each operation of phase 'phase' (-1 if the
+// event isn't being counted, or there have been no such operations)
+double perf_per_operation(PerfPhase phase, PerfEvent event);
+
+// forget everything counted so far (the counters stay open)
+void perf_reset(void);
+
+// print the average count of each event for each phase's operations (nothing,
+// if the counters aren't open), with labels right-aligned to 'width' characters
+void perf_print(int width);
+
+#if PERF_COUNTERS
+
+// start counting an operation, reading the counters into a new variable
+// 'start'
+#define PERF_START(start) PerfSample start; perf_read(&start)
+
+// finish counting 'n' operations of phase 'phase' that started at 'start'
+#define PERF_STOP(phase, start, n) perf_count(phase, &(start), n)
+
+#else
+
+// with counting switched off, there's nothing to do
+#define PERF_START(start)
+#define PERF_STOP(phase, start, n)
+
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+/* * * * * * * * *
+ * Module providing a small, fast pseudorandom number generator (wyrand) whose
+ * state lives wherever it is used, instead of in one shared global like rand()
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stdint.h>
+
+// the state of one generator: seed it once, then draw numbers from it
+typedef struct prng {
+	uint64_t state;
+} Prng;
+
+// set up 'rng' to produce the sequence of numbers determined by 'seed'
+static inline void prng_seed(Prng *rng, uint64_t seed) {
+	rng->state = seed;
+}
+
+// the next pseudorandom 64-bit number from 'rng'
+static inline uint64_t prng_next(Prng *rng) {
+	rng->state += 0xa0761d6478bd642full;
+	__uint128_t product = (__uint128_t)rng->state *
+		(rng->state ^ 0xe7037ed1a0b428dbull);
+	return (uint64_t)(product >> 64) ^ (uint64_t)product;
+}
+
+// a pseudorandom number from 0 to n-1 (for n > 0), scaling the top 32 bits of
+// the next number rather than taking a (slow) remainder
+static inline uint32_t prng_below(Prng *rng, uint32_t n) {
+	return (uint32_t)(((prng_next(rng) >> 32) * n) >> 32);
+}
+
+#endif
@@ -9,9 +9,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "cuckoo.h"
+#include "../latency.h"
+#include "../memusage.h"
+#include "../histogram.h"
+#include "../trace.h"
+
+// the most keys one insertion may displace before the table grows anyway, as a
+// safety net in case a cycle somehow goes undetected
+// (compile with -DMAX_REPLACEMENTS=n to change this)
+#ifndef MAX_REPLACEMENTS
+#define MAX_REPLACEMENTS 1000
+#endif
 
 // an inner table represents one of the two internal tables for a cuckoo
 // hash table. it stores two parallel arrays: 'slots' for storing keys and
@@ -27,22 +37,40 @@ struct cuckoo_table {
 	InnerTable *table1; // first table
 	InnerTable *table2; // second table
 	int size;			// size of each table
-    int time;           // how much CPU time has been used to insert/lookup keys
+    long ndisplacements; // how many keys insertions have displaced
+    Latency latency;    // how long inserts/lookups have taken
+    MemoryUsage memory; // how many bytes the table has allocated
+    Histogram evictions; // how many keys each insertion has displaced
+    long ngrowths;      // how many times a path has had to double the table
+    Trace trace;        // when the table has grown, and how long it took
 };
 
+// the path of keys displaced while inserting a single key
+typedef struct path {
+    int64 key;          // the key this path started by inserting
+    InnerTable *table;  // the table that key was inserted into first
+    int replacements;   // how many keys have been displaced along the path
+    int ndisplaced;     // how many keys the insertion has displaced in all
+                        // (including along paths abandoned to double the table)
+} Path;
+
+static void reinsert_key(CuckooHashTable *table, int64 key);
+
 /* * * *
  * helper functions
  */
 
 // set up the internals of a linear hash table struct with new
-// arrays of size 'size'
+// arrays of size 'size', counting their memory in 'memory'
 // function modified from provided function in linear.c
-static void initialise_table(InnerTable *table, int size) {
+static void initialise_table(InnerTable *table, int size, MemoryUsage *memory) {
     assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
     
-    table->slots = malloc((sizeof *table->slots) * size);
+    table->slots = memory_malloc(memory, MEMORY_KEYS,
+        (sizeof *table->slots) * size);
     assert(table->slots);
-    table->inuse = malloc((sizeof *table->inuse) * size);
+    table->inuse = memory_malloc(memory, MEMORY_OCCUPANCY,
+        (sizeof *table->inuse) * size);
     assert(table->inuse);
     int i;
     for (i = 0; i < size; i++) {
@@ -56,36 +84,64 @@ static void initialise_table(InnerTable *table, int size) {
 // keys in the old tables
 // function modified from provided function in linear.c
 static void double_table(CuckooHashTable *table) {
+    TRACE_START(start);
     int64 *oldslots1 = table->table1->slots, *oldslots2 = table->table2->slots;
     bool  *oldinuse1 = table->table1->inuse, *oldinuse2 = table->table2->inuse;
     int oldsize = table->size;
     
     table->size *= 2;
     
-    initialise_table(table->table1, table->size);
-    initialise_table(table->table2, table->size);
+    initialise_table(table->table1, table->size, &table->memory);
+    initialise_table(table->table2, table->size, &table->memory);
     
     int i;
     for (i = 0; i < oldsize; i++) {
         if (oldinuse1[i] == true) {
-            cuckoo_hash_table_insert(table, oldslots1[i]);
+            reinsert_key(table, oldslots1[i]);
         }
         if (oldinuse2[i] == true) {
-            cuckoo_hash_table_insert(table, oldslots2[i]);
+            reinsert_key(table, oldslots2[i]);
         }
     }
     
-    free(oldslots1);
-    free(oldinuse1);
-    free(oldslots2);
-    free(oldinuse2);
-    
+    memory_free(&table->memory, MEMORY_KEYS, oldslots1,
+        (sizeof *oldslots1) * oldsize);
+    memory_free(&table->memory, MEMORY_OCCUPANCY, oldinuse1,
+        (sizeof *oldinuse1) * oldsize);
+    memory_free(&table->memory, MEMORY_KEYS, oldslots2,
+        (sizeof *oldslots2) * oldsize);
+    memory_free(&table->memory, MEMORY_OCCUPANCY, oldinuse2,
+        (sizeof *oldinuse2) * oldsize);
+    
+    TRACE_STOP(&table->trace, TRACE_GROW, start,
+        table->table1->load + table->table2->load, 2 * oldsize,
+        2 * table->size);
 }
 
 // insert a key into the cuckoo hash table
 static bool insert_key(int64 key, CuckooHashTable *table, InnerTable *tableA,
                        InnerTable *tableB, int (*hA)(int64),
-                       int (*hB)(int64), int *replacements) {
+                       int (*hB)(int64), Path *path) {
+    
+    // if the path has brought the key it started with back to the same table,
+    // it has gone around a cycle, back along itself, around a second cycle and
+    // back again, moving every key it passed back to where it started: these
+    // keys can never all fit, and the path would just repeat itself forever.
+    // so double the table and rehash all values straight away, then start a
+    // new path from here (also do this if the path grows too long anyway)
+    if ((key == path->key && tableA == path->table && path->replacements > 0)
+        || path->replacements >= MAX_REPLACEMENTS) {
+        TRACE_START(start);
+        int oldsize = table->size;
+        double_table(table);
+        table->ngrowths++;
+        TRACE_STOP(&table->trace, TRACE_CYCLE, start, path->replacements,
+            2 * oldsize, 2 * table->size);
+        path->key = key;
+        path->table = tableA;
+        path->replacements = 0;
+    }
+    
     int h = hA(key) % table->size;
     int64 prekey;
     
@@ -102,15 +158,18 @@ static bool insert_key(int64 key, CuckooHashTable *table, InnerTable *tableA,
     // and insert the new key
     tableA->slots[h] = key;
     
-    // double table and rehash all values if number of replacements is too high
-    // (there is a 'cycle')
-    if ((*replacements >= 1000)) {
-        double_table(table);
-    }
-    
-    (*replacements)++;
+    path->replacements++;
+    path->ndisplaced++;
+    table->ndisplacements++;
     // insert preexisting key using recursive call
-    return insert_key(prekey, table, tableB, tableA, hB, hA, replacements);
+    return insert_key(prekey, table, tableB, tableA, hB, hA, path);
+}
+
+// reinsert a key into the cuckoo hash table after doubling it --- we can
+// assume that the key isn't already in there
+static void reinsert_key(CuckooHashTable *table, int64 key) {
+    Path path = {key, table->table1, 0, 0};
+    insert_key(key, table, table->table1, table->table2, h1, h2, &path);
 }
 
 /* * * *
@@ -121,16 +180,31 @@ static bool insert_key(int64 key, CuckooHashTable *table, InnerTable *tableA,
 CuckooHashTable *new_cuckoo_hash_table(int size) {
     CuckooHashTable *table = malloc(sizeof *table);
     assert(table);
-    
-    table->table1 = malloc((sizeof *table->table1) * size);
-    table->table2 = malloc((sizeof *table->table2) * size);
+    initialise_memory_usage(&table->memory);
+    // the latencies, evictions and trace are instrumentation, not the table
+    long instrumentation = sizeof table->latency + sizeof table->evictions +
+        sizeof table->trace;
+    memory_count(&table->memory, MEMORY_TABLE,
+        sizeof *table - instrumentation);
+    memory_count(&table->memory, MEMORY_INSTRUMENTATION, instrumentation);
+    
+    table->table1 = memory_malloc(&table->memory, MEMORY_TABLE,
+        sizeof *table->table1);
+    assert(table->table1);
+    table->table2 = memory_malloc(&table->memory, MEMORY_TABLE,
+        sizeof *table->table2);
+    assert(table->table2);
     
     // set up the internals of the table struct with arrays of size 'size'
-    initialise_table(table->table1, size);
-    initialise_table(table->table2, size);
+    initialise_table(table->table1, size, &table->memory);
+    initialise_table(table->table2, size, &table->memory);
     
     table->size = size;
-    table->time = 0;
+    table->ndisplacements = 0;
+    initialise_histogram(&table->evictions);
+    table->ngrowths = 0;
+    initialise_trace(&table->trace);
+    initialise_latency(&table->latency);
     
 	return table;
 }
@@ -141,14 +215,20 @@ void free_cuckoo_hash_table(CuckooHashTable *table) {
     assert(table != NULL);
     
     // free the inner tables' arrays
-    free(table->table1->slots);
-    free(table->table1->inuse);
-    free(table->table2->slots);
-    free(table->table2->inuse);
+    InnerTable *innertables[2] = {table->table1, table->table2};
+    int t;
+    for (t = 0; t < 2; t++) {
+        memory_free(&table->memory, MEMORY_KEYS, innertables[t]->slots,
+            (sizeof *innertables[t]->slots) * table->size);
+        memory_free(&table->memory, MEMORY_OCCUPANCY, innertables[t]->inuse,
+            (sizeof *innertables[t]->inuse) * table->size);
+    }
     
     // free the inner tables
-    free(table->table1);
-    free(table->table2);
+    memory_free(&table->memory, MEMORY_TABLE, table->table1,
+        sizeof *table->table1);
+    memory_free(&table->memory, MEMORY_TABLE, table->table2,
+        sizeof *table->table2);
     
     // free the table struct itself
     free(table);
@@ -159,7 +239,7 @@ void free_cuckoo_hash_table(CuckooHashTable *table) {
 // returns true if insertion succeeds, false if it was already in there
 bool cuckoo_hash_table_insert(CuckooHashTable *table, int64 key) {
     assert(table != NULL);
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
     
     // calculate the addresses for the key
     int hA = h1(key) % table->size;
@@ -170,17 +250,20 @@ bool cuckoo_hash_table_insert(CuckooHashTable *table, int64 key) {
         (table->table2->inuse[hB] && table->table2->slots[hB] == key)) {
         
         // key is in table - no need to insert
-        table->time += clock() - start_time; // add time elapsed
+        // add time elapsed
+        LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
         return false;
     }
     
-    int replacements = 0;
+    Path path = {key, table->table1, 0, 0};
     
     // key is not in table - so insert it
     bool inserted = insert_key(key, table, table->table1, table->table2, h1,
-                               h2, &replacements);
+                               h2, &path);
+    histogram_add(&table->evictions, path.ndisplaced);
     
-    table->time += clock() - start_time; // add time elapsed
+    // add time elapsed
+    LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
     return inserted;
 }
 
@@ -188,7 +271,7 @@ bool cuckoo_hash_table_insert(CuckooHashTable *table, int64 key) {
 // returns true if found, false if not
 bool cuckoo_hash_table_lookup(CuckooHashTable *table, int64 key) {
     assert(table != NULL);
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
     
     // calculate the addresses for the key
     // the key will be in one of these addresses if it's in the hash table
@@ -198,12 +281,14 @@ bool cuckoo_hash_table_lookup(CuckooHashTable *table, int64 key) {
     if ((table->table1->inuse[hA] && table->table1->slots[hA] == key) ||
         (table->table2->inuse[hB] && table->table2->slots[hB] == key)) {
         // key is in table
-        table->time += clock() - start_time; // add time elapsed
+        // add time elapsed
+        LATENCY_STOP(&table->latency, LATENCY_LOOKUP, start_time);
         return true;
         
     } else {
         // key is not in table
-        table->time += clock() - start_time; // add time elapsed
+        // add time elapsed
+        LATENCY_STOP(&table->latency, LATENCY_LOOKUP, start_time);
         return false;
     }
 }
@@ -272,9 +357,44 @@ void cuckoo_hash_table_stats(CuckooHashTable *table) {
     printf("    load  factor: %.3f%%\n",
            table->table2->load * 100.0 / table->size);
     
-    // also calculate CPU usage in seconds and print this
-    float seconds = table->time * 1.0 / CLOCKS_PER_SEC;
-    printf("         CPU time spent: %.6f sec\n", seconds);
+    // also print how long operations have taken, and how much memory the
+    // table is using
+    latency_print(&table->latency, 16);
+    histogram_print(&table->evictions, "eviction chains", 16);
+    printf("%16s: %ld\n", "cycle growths", table->ngrowths);
+    TableStats stats;
+    initialise_table_stats(&stats);
+    cuckoo_hash_table_get_stats(table, &stats);
+    print_table_memory(&stats, 16);
     
     printf("--- end stats ---\n");
 }
+
+
+// fill in 'stats' with statistics about 'table'
+void cuckoo_hash_table_get_stats(CuckooHashTable *table, TableStats *stats) {
+    assert(table != NULL);
+    
+    stats->nkeys = table->table1->load + table->table2->load;
+    stats->nbuckets = table->size * 2;
+    stats->bucketsize = 1;
+    stats->size = table->size * 2;
+    stats->load_factor = stats->nkeys * 1.0 / stats->nbuckets;
+    stats->wasted = (stats->nbuckets - stats->nkeys) *
+        sizeof *table->table1->slots;
+    table_stats_memory(stats, &table->memory);
+    stats->displacements = table->ndisplacements;
+    stats->growths = table->ngrowths;
+    stats->histograms[HISTOGRAM_EVICTIONS] = table->evictions;
+    stats->time = latency_summarise(&table->latency, stats->latency);
+    stats->last_resize = trace_last_duration(&table->trace);
+}
+
+
+// print the resize events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void cuckoo_hash_table_trace(CuckooHashTable *table, int track) {
+    assert(table != NULL);
+    
+    trace_print_chrome(&table->trace, "cuckoo", track);
+}
@@ -11,6 +11,7 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../tablestats.h"
 
 typedef struct cuckoo_table CuckooHashTable;
 
@@ -34,4 +35,11 @@ void cuckoo_hash_table_print(CuckooHashTable *table);
 // print some statistics about 'table' to stdout
 void cuckoo_hash_table_stats(CuckooHashTable *table);
 
+// fill in 'stats' with statistics about 'table'
+void cuckoo_hash_table_get_stats(CuckooHashTable *table, TableStats *stats);
+
+// print the resize events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void cuckoo_hash_table_trace(CuckooHashTable *table, int track);
+
 #endif
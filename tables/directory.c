@@ -0,0 +1,142 @@
+/* * * * * * * * *
+ * Module providing the directory (table of bucket indices) used by the
+ * extendible hash tables, either as one flat array or as a two-level radix
+ * directory in which each sub-directory grows independently
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "directory.h"
+
+// macro to calculate the rightmost n bits of a number x
+#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
+
+/* * * *
+ * helper functions
+ */
+
+// double the array of bucket indices in 'subdir', duplicating the bucket
+// indices in the first half into the new second half
+// function modified from provided function in xtndbl1.c
+static void double_subdirectory(Directory *dir, Subdirectory *subdir) {
+	int oldsize = 1 << subdir->depth;
+	int size = oldsize * 2;
+	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
+
+	// get a new array of twice as many bucket indices, and copy indices down
+	subdir->buckets = memory_realloc(dir->memory, MEMORY_DIRECTORY,
+		subdir->buckets, (sizeof *subdir->buckets) * oldsize,
+		(sizeof *subdir->buckets) * size);
+	assert(subdir->buckets);
+	int i;
+	for (i = 0; i < oldsize; i++) {
+		subdir->buckets[oldsize + i] = subdir->buckets[i];
+	}
+
+	// finally, increase the depth we are using to address this sub-directory
+	subdir->depth++;
+	dir->size += oldsize;
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// set up 'dir' with every entry referring to the bucket 'index' (of depth 0),
+// counting the memory it allocates in 'memory'
+void initialise_directory(Directory *dir, BucketIndex index,
+		MemoryUsage *memory) {
+	dir->memory = memory;
+	int t;
+	for (t = 0; t < NSUBDIRECTORIES; t++) {
+		dir->subdirs[t].buckets = memory_malloc(memory, MEMORY_DIRECTORY,
+			sizeof *dir->subdirs[t].buckets);
+		assert(dir->subdirs[t].buckets);
+		dir->subdirs[t].buckets[0] = index;
+		dir->subdirs[t].depth = 0;
+	}
+	dir->size = NSUBDIRECTORIES;
+	dir->depth = 0;
+}
+
+
+// free the memory held by the sub-directories of 'dir' (but not 'dir' itself)
+void free_directory(Directory *dir) {
+	int t;
+	for (t = 0; t < NSUBDIRECTORIES; t++) {
+		memory_free(dir->memory, MEMORY_DIRECTORY, dir->subdirs[t].buckets,
+			(sizeof *dir->subdirs[t].buckets) << dir->subdirs[t].depth);
+	}
+}
+
+
+// the bucket first referenced from 'first_address' is being split from 'depth'
+// into 'depth'+1 bits: point the half of its entries whose next hash value bit
+// is a 1 at bucket 'newindex', doubling its (sub-)directory first if necessary
+void directory_split(Directory *dir, int first_address, int depth,
+		BucketIndex newindex) {
+	int new_depth = depth + 1;
+	if (new_depth > dir->depth) {
+		dir->depth = new_depth;
+	}
+
+	// the new bucket's bits: a 1 bit followed by the old bucket's bits
+	int bit_address = rightmostnbits(depth, first_address);
+	int suffix = (1 << depth) | bit_address;
+
+	// a bucket using no more bits than the radix bits covers whole
+	// sub-directories (each of which must then be a single entry): redirect
+	// every sub-directory whose radix bits end in the new bucket's bits
+	if (new_depth <= DIRECTORY_RADIX_BITS) {
+		int prefix;
+		for (prefix = 0; prefix < NSUBDIRECTORIES >> new_depth; prefix++) {
+			dir->subdirs[(prefix << new_depth) | suffix].buckets[0] = newindex;
+		}
+		return;
+	}
+
+	// otherwise the bucket lives within a single sub-directory, in which it
+	// behaves just like a bucket in a flat directory, using the bits above the
+	// radix bits
+	Subdirectory *subdir = &dir->subdirs[rightmostnbits(DIRECTORY_RADIX_BITS,
+		first_address)];
+	depth -= DIRECTORY_RADIX_BITS;
+	new_depth -= DIRECTORY_RADIX_BITS;
+	suffix >>= DIRECTORY_RADIX_BITS;
+
+	// do we need to grow the sub-directory?
+	if (depth == subdir->depth) {
+		// yep, this bucket is down to its last reference
+		double_subdirectory(dir, subdir);
+	}
+
+	// redirect every second address pointing to this bucket to the new bucket
+	// construct addresses by joining a bit 'prefix' and the bit 'suffix'
+	// prefix: all bitstrings of length equal to the difference between the new
+	// bucket depth and the sub-directory depth
+	int maxprefix = 1 << (subdir->depth - new_depth);
+	int prefix;
+	for (prefix = 0; prefix < maxprefix; prefix++) {
+		subdir->buckets[(prefix << new_depth) | suffix] = newindex;
+	}
+}
+
+
+// would splitting the bucket first referenced from 'first_address' from 'depth'
+// into 'depth'+1 bits have to double its (sub-)directory? (that is, is this
+// bucket down to its last reference?)
+bool directory_split_grows(const Directory *dir, int first_address, int depth) {
+	// buckets covering whole sub-directories split without growing anything
+	if (depth < DIRECTORY_RADIX_BITS) {
+		return false;
+	}
+	const Subdirectory *subdir = &dir->subdirs[rightmostnbits(
+		DIRECTORY_RADIX_BITS, first_address)];
+	return depth - DIRECTORY_RADIX_BITS == subdir->depth;
+}
+
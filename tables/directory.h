@@ -0,0 +1,82 @@
+/* * * * * * * * *
+ * Module providing the directory (table of bucket indices) used by the
+ * extendible hash tables, either as one flat array or as a two-level radix
+ * directory in which each sub-directory grows independently
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "../memusage.h"
+
+// how many of the lowest hash value bits choose a sub-directory. with 0 there
+// is a single sub-directory, which is just a flat extendible hashing directory.
+// with r > 0 there are 2^r sub-directories, each addressed by the hash value
+// bits above those r, and a bucket overflowing in one of them only doubles that
+// one sub-directory (compile with -DDIRECTORY_RADIX_BITS=r to change this)
+#ifndef DIRECTORY_RADIX_BITS
+#define DIRECTORY_RADIX_BITS 0
+#endif
+
+#define NSUBDIRECTORIES (1 << DIRECTORY_RADIX_BITS)
+
+// buckets live in a pool (one growable array) in each table, so the directory
+// can refer to them by 32-bit index rather than by 64-bit pointer
+typedef uint32_t BucketIndex;
+
+// a sub-directory is an array of bucket indices addressed by 'depth' bits of
+// the hash value (above the radix bits)
+typedef struct subdirectory {
+	BucketIndex *buckets;	// array of indices of buckets (2^depth of them)
+	int depth;				// how many hash value bits are used to address it
+} Subdirectory;
+
+// a directory is a fixed number of sub-directories, along with some
+// information about its total size
+typedef struct directory {
+	Subdirectory subdirs[NSUBDIRECTORIES];
+	int size;	// total number of entries across all sub-directories
+	int depth;	// how many hash value bits are used by the deepest bucket
+	MemoryUsage *memory;	// where the sub-directories' memory is counted
+} Directory;
+
+// set up 'dir' with every entry referring to the bucket 'index' (of depth 0),
+// counting the memory it allocates in 'memory'
+void initialise_directory(Directory *dir, BucketIndex index,
+	MemoryUsage *memory);
+
+// free the memory held by the sub-directories of 'dir' (but not 'dir' itself)
+void free_directory(Directory *dir);
+
+// the index of the bucket that keys with hash value 'hash' belong in
+static inline BucketIndex directory_lookup(const Directory *dir, int hash) {
+	const Subdirectory *subdir = &dir->subdirs[hash & (NSUBDIRECTORIES - 1)];
+	int address = (hash >> DIRECTORY_RADIX_BITS) & ((1 << subdir->depth) - 1);
+	return subdir->buckets[address];
+}
+
+// start fetching the entry for keys with hash value 'hash' into the cache, so
+// that a later directory_lookup() doesn't have to wait for it
+static inline void directory_prefetch(const Directory *dir, int hash) {
+	const Subdirectory *subdir = &dir->subdirs[hash & (NSUBDIRECTORIES - 1)];
+	int address = (hash >> DIRECTORY_RADIX_BITS) & ((1 << subdir->depth) - 1);
+	__builtin_prefetch(&subdir->buckets[address]);
+}
+
+// the bucket first referenced from 'first_address' is being split from 'depth'
+// into 'depth'+1 bits: point the half of its entries whose next hash value bit
+// is a 1 at bucket 'newindex', doubling its (sub-)directory first if necessary
+void directory_split(Directory *dir, int first_address, int depth,
+		BucketIndex newindex);
+
+// would splitting the bucket first referenced from 'first_address' from 'depth'
+// into 'depth'+1 bits have to double its (sub-)directory? (that is, is this
+// bucket down to its last reference?)
+bool directory_split_grows(const Directory *dir, int first_address, int depth);
+
+#endif
@@ -0,0 +1,359 @@
+/* * * * * * * * *
+ * Module providing the directory of single-key buckets used by the extendible
+ * hash tables with one key per bucket. a bucket's key is kept inline, in its
+ * directory entry, while that is the only entry referring to the bucket; the
+ * bucket only gets a place of its own (in a pool) while entries share it
+ *
+ * doubling a sub-directory copies every inline entry into the new half, but a
+ * copy whose key's hash value doesn't lead to it counts as empty: that way an
+ * inline bucket splits into two inline buckets for free when it doubles
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "inlinedir.h"
+
+// marks the end of the chain of shared buckets no longer in use
+#define NO_BUCKET ((BucketIndex)-1)
+
+// macro to calculate the rightmost n bits of a number x
+#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
+
+/* * * *
+ * helper functions
+ */
+
+// how many hash value bits a bucket uses if the entry for 'hash' is the only
+// entry referring to it
+static int full_depth(const InlineDirectory *dir, int hash) {
+	return DIRECTORY_RADIX_BITS +
+		dir->subdirs[hash & (NSUBDIRECTORIES - 1)].depth;
+}
+
+// does the inline 'entry' for hash value 'hash' hold a key that belongs there?
+// (rather than being empty, or a copy left behind by doubling)
+static bool inline_full(const InlineDirectory *dir, int hash,
+		InlineEntry entry) {
+	if (entry >= SHARED_BUCKET) {
+		return false;
+	}
+	int depth = full_depth(dir, hash);
+	return (rightmostnbits(depth, dir->h(entry))) ==
+		(rightmostnbits(depth, hash));
+}
+
+// add a bucket to the pool of shared buckets (reusing one no longer in use,
+// if there is one) and return its index
+static BucketIndex new_shared_bucket(InlineDirectory *dir, int id, int depth,
+		bool full, int64 key) {
+	BucketIndex index;
+	if (dir->freebuckets != NO_BUCKET) {
+		// reuse the first bucket in the chain of unused buckets (which are
+		// linked together through their 'key' fields)
+		index = dir->freebuckets;
+		dir->freebuckets = (BucketIndex)dir->pool[index].key;
+
+	} else {
+		// make more space in the pool if it is full (doubling, so that adding
+		// buckets costs constant time on average)
+		if (dir->npool == dir->poolsize) {
+			dir->poolsize *= 2;
+			dir->pool = memory_realloc(dir->memory, MEMORY_BUCKETS, dir->pool,
+				(sizeof *dir->pool) * dir->npool,
+				(sizeof *dir->pool) * dir->poolsize);
+			assert(dir->pool);
+		}
+		index = dir->npool++;
+	}
+
+	SharedBucket *bucket = &dir->pool[index];
+	bucket->id = id;
+	bucket->depth = depth;
+	bucket->full = full;
+	bucket->key = key;
+	dir->nshared++;
+
+	return index;
+}
+
+// return the shared bucket at 'index' to the chain of unused buckets
+static void free_shared_bucket(InlineDirectory *dir, BucketIndex index) {
+	dir->pool[index].key = dir->freebuckets;
+	dir->freebuckets = index;
+	dir->nshared--;
+}
+
+// set every entry referring to the bucket first referenced from 'first_address'
+// (using 'depth' bits of the hash value) to 'entry'
+static void set_entries(InlineDirectory *dir, int first_address, int depth,
+		InlineEntry entry) {
+
+	// a bucket using fewer bits than the radix bits covers whole
+	// sub-directories (each of which must then be a single entry)
+	if (depth < DIRECTORY_RADIX_BITS) {
+		int prefix;
+		for (prefix = 0; prefix < NSUBDIRECTORIES >> depth; prefix++) {
+			dir->subdirs[(prefix << depth) | first_address].entries[0] = entry;
+		}
+		return;
+	}
+
+	// otherwise it lives within a single sub-directory: construct addresses by
+	// joining a bit 'prefix' and the bucket's bits (above the radix bits)
+	InlineSubdirectory *subdir = &dir->subdirs[rightmostnbits(
+		DIRECTORY_RADIX_BITS, first_address)];
+	depth -= DIRECTORY_RADIX_BITS;
+	int suffix = first_address >> DIRECTORY_RADIX_BITS;
+	int maxprefix = 1 << (subdir->depth - depth);
+	int prefix;
+	for (prefix = 0; prefix < maxprefix; prefix++) {
+		subdir->entries[(prefix << depth) | suffix] = entry;
+	}
+}
+
+// make the entries for the bucket first referenced from 'id' (using 'depth'
+// bits of the hash value) hold a bucket with the given contents: inline, if
+// only one entry refers to it (and its key can be inline), or else shared
+static void place_bucket(InlineDirectory *dir, int id, int depth, bool full,
+		int64 key) {
+	if (depth == full_depth(dir, id) && (!full || key < SHARED_BUCKET)) {
+		set_entries(dir, id, depth, full ? key : EMPTY_BUCKET);
+	} else {
+		BucketIndex index = new_shared_bucket(dir, id, depth, full, key);
+		set_entries(dir, id, depth, SHARED_BUCKET | index);
+	}
+}
+
+// double the array of entries in sub-directory 's', duplicating the entries in
+// the first half into the new second half
+// function modified from provided function in xtndbl1.c
+static void double_subdirectory(InlineDirectory *dir, int s) {
+	InlineSubdirectory *subdir = &dir->subdirs[s];
+	int oldsize = 1 << subdir->depth;
+	int size = oldsize * 2;
+	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
+
+	// get a new array of twice as many entries, and copy entries down
+	subdir->entries = memory_realloc(dir->memory, MEMORY_DIRECTORY,
+		subdir->entries, (sizeof *subdir->entries) * oldsize,
+		(sizeof *subdir->entries) * size);
+	assert(subdir->entries);
+	int i;
+	for (i = 0; i < oldsize; i++) {
+		InlineEntry entry = subdir->entries[i];
+		subdir->entries[oldsize + i] = entry;
+
+		// a shared bucket just gains references, but an inline bucket becomes
+		// two: its key stays in whichever copy its hash value leads to, and the
+		// other copy counts as empty from now on
+		if (entry < SHARED_BUCKET || entry == EMPTY_BUCKET) {
+			dir->nbuckets++;
+		}
+	}
+
+	// finally, increase the depth we are using to address this sub-directory
+	subdir->depth++;
+	dir->size += oldsize;
+	if (full_depth(dir, s) > dir->depth) {
+		dir->depth = full_depth(dir, s);
+	}
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// set up 'dir' with a single empty bucket (of depth 0), for keys placed using
+// hash function 'h', counting the memory it allocates in 'memory'
+void initialise_inline_directory(InlineDirectory *dir, int (*h)(int64),
+		MemoryUsage *memory) {
+	dir->h = h;
+	dir->memory = memory;
+	int t;
+	for (t = 0; t < NSUBDIRECTORIES; t++) {
+		dir->subdirs[t].entries = memory_malloc(memory, MEMORY_DIRECTORY,
+			sizeof *dir->subdirs[t].entries);
+		assert(dir->subdirs[t].entries);
+		dir->subdirs[t].depth = 0;
+	}
+	dir->size = NSUBDIRECTORIES;
+	dir->depth = 0;
+
+	dir->npool = 0;
+	dir->poolsize = 1;
+	dir->pool = memory_malloc(memory, MEMORY_BUCKETS, sizeof *dir->pool);
+	assert(dir->pool);
+	dir->freebuckets = NO_BUCKET;
+	dir->nshared = 0;
+
+	place_bucket(dir, 0, 0, false, 0);
+	dir->nbuckets = 1;
+}
+
+
+// free the memory held by 'dir' (but not 'dir' itself)
+void free_inline_directory(InlineDirectory *dir) {
+	int t;
+	for (t = 0; t < NSUBDIRECTORIES; t++) {
+		memory_free(dir->memory, MEMORY_DIRECTORY, dir->subdirs[t].entries,
+			(sizeof *dir->subdirs[t].entries) << dir->subdirs[t].depth);
+	}
+	memory_free(dir->memory, MEMORY_BUCKETS, dir->pool,
+		(sizeof *dir->pool) * dir->poolsize);
+}
+
+
+// how many bytes of the space 'dir' has for keys (one in each entry, and one in
+// each bucket of the pool in use) aren't holding any of its 'nkeys' keys (the
+// pool's unused buckets are slack, below)
+long inline_directory_wasted(const InlineDirectory *dir, long nkeys) {
+	return ((long)dir->size + dir->nshared - nkeys) * sizeof (int64);
+}
+
+// how many bytes the pool has allocated for shared buckets that aren't in use
+long inline_directory_slack(const InlineDirectory *dir) {
+	return (long)(dir->poolsize - dir->nshared) * sizeof (SharedBucket);
+}
+
+
+// a description (id, depth and contents) of the bucket for hash value 'hash',
+// whether it is inline or shared
+SharedBucket inline_directory_bucket(const InlineDirectory *dir, int hash) {
+	InlineEntry entry = *inline_directory_entry(dir, hash);
+	if (entry >= SHARED_BUCKET && entry != EMPTY_BUCKET) {
+		return dir->pool[(BucketIndex)entry];
+	}
+
+	// an inline bucket is the only bucket its entry refers to, so it uses all
+	// of the bits that address the entry
+	SharedBucket bucket;
+	bucket.depth = full_depth(dir, hash);
+	bucket.id = rightmostnbits(bucket.depth, hash);
+	bucket.full = inline_full(dir, hash, entry);
+	bucket.key = bucket.full ? entry : 0;
+	return bucket;
+}
+
+
+// put 'key' in the bucket for hash value 'hash', if that bucket is empty
+// returns true if it was added, false if the bucket is full
+bool inline_directory_add(InlineDirectory *dir, int hash, int64 key) {
+	InlineEntry *entry = inline_directory_entry(dir, hash);
+
+	// an empty inline bucket takes the key inline (if it can)
+	if (*entry == EMPTY_BUCKET || (*entry < SHARED_BUCKET &&
+			!inline_full(dir, hash, *entry))) {
+		if (key < SHARED_BUCKET) {
+			*entry = key;
+		} else {
+			SharedBucket bucket = inline_directory_bucket(dir, hash);
+			*entry = SHARED_BUCKET | new_shared_bucket(dir, bucket.id,
+				bucket.depth, true, key);
+		}
+		return true;
+	}
+
+	// a full inline bucket has no space
+	if (*entry < SHARED_BUCKET) {
+		return false;
+	}
+
+	// and a shared bucket might or might not
+	SharedBucket *bucket = &dir->pool[(BucketIndex)*entry];
+	if (bucket->full) {
+		return false;
+	}
+	bucket->key = key;
+	bucket->full = true;
+	return true;
+}
+
+
+// replace the key in the (full) bucket for hash value 'hash' with 'key', and
+// return the key that was there
+int64 inline_directory_swap(InlineDirectory *dir, int hash, int64 key) {
+	InlineEntry *entry = inline_directory_entry(dir, hash);
+	int64 oldkey;
+
+	if (*entry < SHARED_BUCKET) {
+		// the bucket is inline: keep it that way, if the new key can be
+		assert(inline_full(dir, hash, *entry));
+		oldkey = *entry;
+		if (key < SHARED_BUCKET) {
+			*entry = key;
+		} else {
+			SharedBucket bucket = inline_directory_bucket(dir, hash);
+			*entry = SHARED_BUCKET | new_shared_bucket(dir, bucket.id,
+				bucket.depth, true, key);
+		}
+		return oldkey;
+	}
+
+	assert(*entry != EMPTY_BUCKET);
+	SharedBucket *bucket = &dir->pool[(BucketIndex)*entry];
+	assert(bucket->full);
+	oldkey = bucket->key;
+	bucket->key = key;
+	return oldkey;
+}
+
+
+// would splitting the bucket for hash value 'hash' have to double its
+// (sub-)directory? (that is, is this bucket down to its last reference?)
+bool inline_directory_split_grows(const InlineDirectory *dir, int hash) {
+	InlineEntry entry = *inline_directory_entry(dir, hash);
+	if (entry < SHARED_BUCKET || entry == EMPTY_BUCKET) {
+		return true;
+	}
+	return dir->pool[(BucketIndex)entry].depth == full_depth(dir, hash);
+}
+
+
+// split the bucket for hash value 'hash' into two buckets using one more bit of
+// the hash value, doubling its (sub-)directory first if necessary, and put its
+// key (if any) back in whichever bucket it now belongs in
+void inline_directory_split(InlineDirectory *dir, int hash) {
+
+	// an inline bucket is split just by doubling its sub-directory, which
+	// leaves its key in the copy its hash value leads to
+	InlineEntry entry = *inline_directory_entry(dir, hash);
+	if (entry < SHARED_BUCKET || entry == EMPTY_BUCKET) {
+		double_subdirectory(dir, hash & (NSUBDIRECTORIES - 1));
+		return;
+	}
+
+	// FIRST,
+	// take note of the bucket, and double its sub-directory if this bucket is
+	// down to its last entry (only possible for a key that can't be inline)
+	SharedBucket bucket = inline_directory_bucket(dir, hash);
+	if (inline_directory_split_grows(dir, hash)) {
+		double_subdirectory(dir, hash & (NSUBDIRECTORIES - 1));
+	}
+
+	// the bucket's entries are all about to be redirected: it's no longer
+	// needed
+	free_shared_bucket(dir, (BucketIndex)entry);
+
+	// SECOND,
+	// replace it with two empty buckets using one more bit each: the new
+	// bucket's first address will be a 1 bit plus the old first address
+	int new_depth = bucket.depth + 1;
+	place_bucket(dir, bucket.id, new_depth, false, 0);
+	place_bucket(dir, 1 << bucket.depth | bucket.id, new_depth, false, 0);
+	dir->nbuckets++;
+	if (new_depth > dir->depth) {
+		dir->depth = new_depth;
+	}
+
+	// FINALLY,
+	// put the key back into its rightful place (which may be either bucket,
+	// and will definitely have space, since both are empty)
+	if (bucket.full) {
+		inline_directory_add(dir, dir->h(bucket.key), bucket.key);
+	}
+}
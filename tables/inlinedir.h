@@ -0,0 +1,155 @@
+/* * * * * * * * *
+ * Module providing the directory of single-key buckets used by the extendible
+ * hash tables with one key per bucket. a bucket's key is kept inline, in its
+ * directory entry, while that is the only entry referring to the bucket; the
+ * bucket only gets a place of its own (in a pool) while entries share it
+ *
+ * doubling a sub-directory copies every inline entry into the new half, but a
+ * copy whose key's hash value doesn't lead to it counts as empty: that way an
+ * inline bucket splits into two inline buckets for free when it doubles
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef INLINEDIR_H
+#define INLINEDIR_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "directory.h"
+
+// an entry is a single 64-bit word holding either
+// - the key in a bucket that only this entry refers to (or, if the key's hash
+//   value doesn't lead to this entry, a left-over copy meaning empty),
+// - EMPTY_BUCKET, for an empty bucket that only this entry refers to, or
+// - SHARED_BUCKET plus the index of a bucket in the pool of shared buckets.
+// keys from SHARED_BUCKET upwards would look like one of the last two, so
+// they always live in a shared bucket (even if only one entry refers to it)
+typedef uint64_t InlineEntry;
+#define SHARED_BUCKET ((InlineEntry)0xffffffff << 32)
+#define EMPTY_BUCKET ((InlineEntry)-1)
+
+// a shared bucket stores a single key (full=true) or is empty (full=false)
+// it also knows how many bits are shared between possible keys, and the first
+// table address that references it
+typedef struct shared_bucket {
+	int id;		// a unique id for this bucket, equal to the first address
+				// in the table which points to it
+	int depth;	// how many hash value bits are being used by this bucket
+	bool full;	// does this bucket contain a key
+	int64 key;	// the key stored in this bucket
+} SharedBucket;
+
+// a sub-directory is an array of entries addressed by 'depth' bits of the hash
+// value (above the radix bits, just like the sub-directories in directory.h)
+typedef struct inline_subdirectory {
+	InlineEntry *entries;	// array of entries (2^depth of them)
+	int depth;				// how many hash value bits are used to address it
+} InlineSubdirectory;
+
+// an inline directory is a fixed number of sub-directories, along with the pool
+// of buckets they share, and some information about its total size
+typedef struct inline_directory {
+	InlineSubdirectory subdirs[NSUBDIRECTORIES];
+	int (*h)(int64);		// the hash function keys are placed by
+	SharedBucket *pool;		// array of shared buckets
+	int npool;				// how many buckets have been added to the pool
+	int poolsize;			// how many buckets the pool has space for
+	BucketIndex freebuckets;// chain of buckets in the pool no longer in use
+	int nshared;			// how many buckets in the pool are in use
+	int nbuckets;			// how many distinct buckets there are (inline or
+							// shared)
+	int size;				// total number of entries across all sub-directories
+	int depth;				// how many hash value bits are used by the deepest
+							// bucket
+	MemoryUsage *memory;	// where the directory's memory is counted
+} InlineDirectory;
+
+// set up 'dir' with a single empty bucket (of depth 0), for keys placed using
+// hash function 'h', counting the memory it allocates in 'memory'
+void initialise_inline_directory(InlineDirectory *dir, int (*h)(int64),
+	MemoryUsage *memory);
+
+// free the memory held by 'dir' (but not 'dir' itself)
+void free_inline_directory(InlineDirectory *dir);
+
+// how many bytes of the space 'dir' has for keys (one in each entry, and one in
+// each bucket of the pool in use) aren't holding any of its 'nkeys' keys (the
+// pool's unused buckets are slack, below)
+long inline_directory_wasted(const InlineDirectory *dir, long nkeys);
+
+// how many bytes the pool has allocated for shared buckets that aren't in use
+long inline_directory_slack(const InlineDirectory *dir);
+
+// a pointer to the entry for keys with hash value 'hash'
+static inline InlineEntry *inline_directory_entry(const InlineDirectory *dir,
+		int hash) {
+	const InlineSubdirectory *subdir =
+		&dir->subdirs[hash & (NSUBDIRECTORIES - 1)];
+	int address = (hash >> DIRECTORY_RADIX_BITS) & ((1 << subdir->depth) - 1);
+	return &subdir->entries[address];
+}
+
+// is 'key' (with hash value 'hash') in its bucket in 'dir'? an inline key is
+// found with the single load of its entry (a left-over copy of a key is never
+// in the entry for that key's own hash value, so can't be mistaken for it)
+static inline bool inline_directory_find(const InlineDirectory *dir, int hash,
+		int64 key) {
+	InlineEntry entry = *inline_directory_entry(dir, hash);
+	if (entry < SHARED_BUCKET) {
+		return entry == key;
+	}
+	if (entry == EMPTY_BUCKET) {
+		return false;
+	}
+	const SharedBucket *bucket = &dir->pool[(BucketIndex)entry];
+	return bucket->full && bucket->key == key;
+}
+
+// is 'key' in either its bucket in 'dir1' (for hash value 'hash1') or its
+// bucket in 'dir2' (for hash value 'hash2')? both entries are loaded before
+// either is looked at, so that their cache misses overlap, and two inline
+// entries are compared without branching
+static inline bool inline_directory_find_either(const InlineDirectory *dir1,
+		int hash1, const InlineDirectory *dir2, int hash2, int64 key) {
+	InlineEntry entry1 = *inline_directory_entry(dir1, hash1);
+	InlineEntry entry2 = *inline_directory_entry(dir2, hash2);
+	bool inline1 = entry1 < SHARED_BUCKET || entry1 == EMPTY_BUCKET;
+	bool inline2 = entry2 < SHARED_BUCKET || entry2 == EMPTY_BUCKET;
+	if (inline1 & inline2 & (key < SHARED_BUCKET)) {
+		return (entry1 == key) | (entry2 == key);
+	}
+	return inline_directory_find(dir1, hash1, key) ||
+		inline_directory_find(dir2, hash2, key);
+}
+
+// start fetching the entry for keys with hash value 'hash' into the cache, so
+// that a later lookup doesn't have to wait for it
+static inline void inline_directory_prefetch(const InlineDirectory *dir,
+		int hash) {
+	__builtin_prefetch(inline_directory_entry(dir, hash));
+}
+
+// a description (id, depth and contents) of the bucket for hash value 'hash',
+// whether it is inline or shared
+SharedBucket inline_directory_bucket(const InlineDirectory *dir, int hash);
+
+// put 'key' in the bucket for hash value 'hash', if that bucket is empty
+// returns true if it was added, false if the bucket is full
+bool inline_directory_add(InlineDirectory *dir, int hash, int64 key);
+
+// replace the key in the (full) bucket for hash value 'hash' with 'key', and
+// return the key that was there
+int64 inline_directory_swap(InlineDirectory *dir, int hash, int64 key);
+
+// would splitting the bucket for hash value 'hash' have to double its
+// (sub-)directory? (that is, is this bucket down to its last reference?)
+bool inline_directory_split_grows(const InlineDirectory *dir, int hash);
+
+// split the bucket for hash value 'hash' into two buckets using one more bit of
+// the hash value, doubling its (sub-)directory first if necessary, and put its
+// key (if any) back in whichever bucket it now belongs in
+void inline_directory_split(InlineDirectory *dir, int hash);
+
+#endif
@@ -0,0 +1,97 @@
+/* * * * * * * * *
+ * Module for searching the array of keys in an n-key bucket, comparing several
+ * keys per instruction (with AVX2 or AVX-512) when the CPU supports it
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include "keysearch.h"
+
+// the vector versions are only built for x86 with a compiler that can target
+// individual functions at an instruction set, so the rest of the program
+// doesn't need to be compiled for (and only run on) AVX machines
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEYSEARCH_VECTOR
+#include <immintrin.h>
+#endif
+
+// compare one key at a time, without branching on each comparison
+static bool keysearch_scalar(const int64 *keys, int nkeys, int64 key) {
+	bool found = false;
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		found |= keys[i] == key;
+	}
+	return found;
+}
+
+#ifdef KEYSEARCH_VECTOR
+
+// compare 4 keys at a time. the final vector may run into the bucket's padding,
+// so any matches there are masked off
+__attribute__((target("avx2")))
+static bool keysearch_avx2(const int64 *keys, int nkeys, int64 key) {
+	__m256i target = _mm256_set1_epi64x((long long)key);
+	int i;
+	for (i = 0; i < nkeys; i += KEYSEARCH_WIDTH) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)(keys + i));
+		__m256i equal = _mm256_cmpeq_epi64(block, target);
+		int matches = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+
+		// only the first nkeys-i lanes hold real keys
+		if (nkeys - i < KEYSEARCH_WIDTH) {
+			matches &= (1 << (nkeys - i)) - 1;
+		}
+		if (matches) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// compare 8 keys at a time, using a masked load for the final vector so that
+// nothing past the first nkeys keys is read or compared
+__attribute__((target("avx512f")))
+static bool keysearch_avx512(const int64 *keys, int nkeys, int64 key) {
+	__m512i target = _mm512_set1_epi64((long long)key);
+	int i;
+	for (i = 0; i < nkeys; i += 2 * KEYSEARCH_WIDTH) {
+		__mmask8 lanes = 0xFF;
+		if (nkeys - i < 2 * KEYSEARCH_WIDTH) {
+			lanes = (1 << (nkeys - i)) - 1;
+		}
+		__m512i block = _mm512_maskz_loadu_epi64(lanes, keys + i);
+		if (_mm512_mask_cmpeq_epi64_mask(lanes, block, target)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
+
+// the search function to use on this CPU (chosen before main() starts, so that
+// threads searching sharded tables never race to choose it)
+static bool (*search)(const int64 *keys, int nkeys, int64 key) = NULL;
+
+// pick the widest search function that this CPU can run
+__attribute__((constructor))
+static void choose_search(void) {
+	search = keysearch_scalar;
+#ifdef KEYSEARCH_VECTOR
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		search = keysearch_avx512;
+	} else if (__builtin_cpu_supports("avx2")) {
+		search = keysearch_avx2;
+	}
+#endif
+}
+
+// lookup whether 'key' is among the first 'nkeys' keys of 'keys', an array
+// with space for at least keysearch_padded(nkeys) keys
+// returns true if found, false if not
+bool keysearch(const int64 *keys, int nkeys, int64 key) {
+	return search(keys, nkeys, key);
+}
@@ -0,0 +1,29 @@
+/* * * * * * * * *
+ * Module for searching the array of keys in an n-key bucket, comparing several
+ * keys per instruction (with AVX2 or AVX-512) when the CPU supports it
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+
+// the number of keys compared by one vector instruction (for AVX2; AVX-512
+// compares twice this many). a bucket's array of keys should have space for a
+// multiple of this many keys, so that whole vectors can be read from it
+#define KEYSEARCH_WIDTH 4
+
+// round 'n' keys up to a whole number of vectors of keys
+#define keysearch_padded(n) \
+	(((n) + KEYSEARCH_WIDTH - 1) / KEYSEARCH_WIDTH * KEYSEARCH_WIDTH)
+
+// lookup whether 'key' is among the first 'nkeys' keys of 'keys', an array
+// with space for at least keysearch_padded(nkeys) keys
+// returns true if found, false if not
+bool keysearch(const int64 *keys, int nkeys, int64 key);
+
+#endif
@@ -10,6 +10,9 @@
 #include <assert.h>
 
 #include "linear.h"
+#include "../memusage.h"
+#include "../histogram.h"
+#include "../trace.h"
 
 // how many cells to advance at a time while looking for a free slot
 #define STEP_SIZE 1
@@ -27,6 +30,10 @@ struct linear_table {
                         // hash to is already occupied
     int total_probe;    // the sum of the number of slots checked before each
                         // kew was inserted into a free space
+	MemoryUsage memory; // how many bytes the table has allocated
+	Histogram probes_hit;  // extra slots probed by lookups that found their key
+	Histogram probes_miss; // extra slots probed by lookups that didn't
+	Trace trace;        // when the table has grown, and how long it took
 };
 
 
@@ -39,9 +46,11 @@ struct linear_table {
 static void initialise_table(LinearHashTable *table, int size) {
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 
-	table->slots = malloc((sizeof *table->slots) * size);
+	table->slots = memory_malloc(&table->memory, MEMORY_KEYS,
+		(sizeof *table->slots) * size);
 	assert(table->slots);
-	table->inuse = malloc((sizeof *table->inuse) * size);
+	table->inuse = memory_malloc(&table->memory, MEMORY_OCCUPANCY,
+		(sizeof *table->inuse) * size);
 	assert(table->inuse);
 	int i;
 	for (i = 0; i < size; i++) {
@@ -58,6 +67,7 @@ static void initialise_table(LinearHashTable *table, int size) {
 // double the size of the internal table arrays and re-hash all
 // keys in the old tables
 static void double_table(LinearHashTable *table) {
+	TRACE_START(start);
 	int64 *oldslots = table->slots;
 	bool  *oldinuse = table->inuse;
 	int oldsize = table->size;
@@ -74,8 +84,13 @@ static void double_table(LinearHashTable *table) {
 		}
 	}
 
-	free(oldslots);
-	free(oldinuse);
+	memory_free(&table->memory, MEMORY_KEYS, oldslots,
+		(sizeof *oldslots) * oldsize);
+	memory_free(&table->memory, MEMORY_OCCUPANCY, oldinuse,
+		(sizeof *oldinuse) * oldsize);
+
+	TRACE_STOP(&table->trace, TRACE_GROW, start, table->load, oldsize,
+		table->size);
 }
 
 
@@ -87,6 +102,16 @@ static void double_table(LinearHashTable *table) {
 LinearHashTable *new_linear_hash_table(int size) {
 	LinearHashTable *table = malloc(sizeof *table);
 	assert(table);
+	initialise_memory_usage(&table->memory);
+	// the probe histograms and trace are instrumentation, not the table
+	long instrumentation = sizeof table->probes_hit + sizeof table->probes_miss +
+		sizeof table->trace;
+	memory_count(&table->memory, MEMORY_TABLE,
+		sizeof *table - instrumentation);
+	memory_count(&table->memory, MEMORY_INSTRUMENTATION, instrumentation);
+	initialise_histogram(&table->probes_hit);
+	initialise_histogram(&table->probes_miss);
+	initialise_trace(&table->trace);
 
 	// set up the internals of the table struct with arrays of size 'size'
 	initialise_table(table, size);
@@ -100,8 +125,10 @@ void free_linear_hash_table(LinearHashTable *table) {
 	assert(table != NULL);
 
 	// free the table's arrays
-	free(table->slots);
-	free(table->inuse);
+	memory_free(&table->memory, MEMORY_KEYS, table->slots,
+		(sizeof *table->slots) * table->size);
+	memory_free(&table->memory, MEMORY_OCCUPANCY, table->inuse,
+		(sizeof *table->inuse) * table->size);
 
 	// free the table struct itself
 	free(table);
@@ -172,6 +199,7 @@ bool linear_hash_table_lookup(LinearHashTable *table, int64 key) {
 
 		if (table->slots[h] == key) {
 			// found the key!
+			histogram_add(&table->probes_hit, steps);
 			return true;
 		}
 
@@ -182,6 +210,7 @@ bool linear_hash_table_lookup(LinearHashTable *table, int64 key) {
 
 	// we have either searched the whole table or come back to where we started
 	// either way, the key is not in the hash table
+	histogram_add(&table->probes_miss, steps);
 	return false;
 }
 
@@ -227,6 +256,44 @@ void linear_hash_table_stats(LinearHashTable *table) {
 	printf("              step size: %d slots\n", STEP_SIZE);
     printf("             collisions: %d\n", table->collisions);
     printf(" average probe sequence: %.3f\n", (table->total_probe * 1.0) / (table->load * 1.0));
+
+	// the distributions of lookups' probe lengths
+	histogram_print(&table->probes_hit, "hit probe lengths", 23);
+	histogram_print(&table->probes_miss, "miss probe lengths", 23);
+
+	// also print how much memory the table is using
+	TableStats stats;
+	initialise_table_stats(&stats);
+	linear_hash_table_get_stats(table, &stats);
+	print_table_memory(&stats, 23);
 	
 	printf("--- end stats ---\n");
 }
+
+
+// fill in 'stats' with statistics about 'table'
+void linear_hash_table_get_stats(LinearHashTable *table, TableStats *stats) {
+	assert(table != NULL);
+
+	stats->nkeys = table->load;
+	stats->nbuckets = table->size;
+	stats->bucketsize = 1;
+	stats->size = table->size;
+	stats->load_factor = table->load * 1.0 / table->size;
+	stats->wasted = (long)(table->size - table->load) * sizeof *table->slots;
+	table_stats_memory(stats, &table->memory);
+	stats->probes = table->total_probe;
+	stats->collisions = table->collisions;
+	stats->histograms[HISTOGRAM_PROBES_HIT] = table->probes_hit;
+	stats->histograms[HISTOGRAM_PROBES_MISS] = table->probes_miss;
+	stats->last_resize = trace_last_duration(&table->trace);
+}
+
+
+// print the resize events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void linear_hash_table_trace(LinearHashTable *table, int track) {
+	assert(table != NULL);
+
+	trace_print_chrome(&table->trace, "linear", track);
+}
@@ -7,6 +7,7 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../tablestats.h"
 
 typedef struct linear_table LinearHashTable;
 
@@ -30,3 +31,10 @@ void linear_hash_table_print(LinearHashTable *table);
 // print some statistics about 'table' to stdout
 void linear_hash_table_stats(LinearHashTable *table);
 
+// fill in 'stats' with statistics about 'table'
+void linear_hash_table_get_stats(LinearHashTable *table, TableStats *stats);
+
+
+// print the resize events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void linear_hash_table_trace(LinearHashTable *table, int track);
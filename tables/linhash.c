@@ -0,0 +1,566 @@
+/* * * * * * * * *
+ * Dynamic hash table using linear hashing (Litwin) with multiple keys per
+ * bucket, growing one bucket at a time in round-robin order as the table fills
+ * up, with overflow pages for buckets that fill before their turn to split
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "linhash.h"
+#include "../latency.h"
+#include "../memusage.h"
+#include "../histogram.h"
+#include "../trace.h"
+#include "keysearch.h"
+#include "directory.h"
+
+// the table splits another bucket whenever its keys fill more than this
+// fraction of the space in its (non-overflow) buckets
+// (compile with -DMAX_LOAD_FACTOR=f to change this)
+#ifndef MAX_LOAD_FACTOR
+#define MAX_LOAD_FACTOR 0.8
+#endif
+
+// how many buckets are allocated together, in one segment. the table grows a
+// segment at a time, so adding a bucket never moves the existing ones
+#define SEGMENT_SIZE 256
+
+// marks the end of a chain of overflow pages
+#define NO_OVERFLOW ((BucketIndex)-1)
+
+// macro to calculate the rightmost n bits of a number x
+#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
+
+// a bucket (or an overflow page) stores an array of keys (kept alongside it,
+// at the same index, in its segment or in the pool of overflow pages), and
+// knows where the next overflow page in its chain is
+typedef struct linhash_bucket {
+	int nkeys;				// number of keys currently contained in this bucket
+	BucketIndex overflow;	// the next overflow page in this bucket's chain
+} Bucket;
+
+// a segment is a block of SEGMENT_SIZE consecutive buckets
+typedef struct segment {
+	Bucket *buckets;	// the buckets in this segment
+	int64 *keys;		// keystride keys for each bucket in this segment
+} Segment;
+
+// helper structure to store statistics gathered
+typedef struct stats {
+	int nkeys;		// how many keys are being stored in the table
+	int nsplits;	// how many buckets have been split
+	Latency latency;	// how long inserts/lookups have taken
+	MemoryUsage memory;	// how many bytes the table has allocated
+	Trace trace;		// when buckets have split, and how long it took
+} Stats;
+
+// a linear hashing table is an array of buckets that grows by one bucket at a
+// time: when the table gets too full, the bucket at the split pointer 'next'
+// is split into itself and a new bucket added at the end of the array, and the
+// split pointer moves along. buckets before the split pointer (and the new
+// buckets at the end) use level+1 hash value bits; the rest use level bits
+struct linhash_table {
+	Segment *segments;		// array of segments of buckets
+	int nsegments;			// how many segments are in use
+	int segmentssize;		// how many segments the array has space for
+	int nbuckets;			// how many buckets are in use (2^level + next)
+	int level;				// how many hash value bits to use (at least)
+	int next;				// the split pointer: which bucket to split next
+	Bucket *pages;			// pool of overflow pages
+	int64 *pagekeys;		// keystride keys for each overflow page in the pool
+	int npages;				// how many overflow pages are in the pool
+	int pagessize;			// how many overflow pages the pool has space for
+	int noverflow;			// how many overflow pages are in use
+	BucketIndex freepages;	// chain of overflow pages no longer in use
+	int bucketsize;			// maximum number of keys per bucket
+	int keystride;			// space for keys per bucket (bucketsize, padded to
+							// a whole number of vectors for keysearch)
+	int64 *scratch;			// space to hold a chain's keys while it splits
+	int scratchsize;		// how many keys 'scratch' has space for
+	Stats stats;			// collection of statistics about this hash table
+};
+
+// macros to get pointers to bucket 'i' and its keys, and to overflow page 'p'
+// and its keys (only valid until the next overflow page is added, since the
+// pool of overflow pages may move --- buckets themselves never move)
+#define bucketat(table, i) \
+	(&(table)->segments[(i) / SEGMENT_SIZE].buckets[(i) % SEGMENT_SIZE])
+#define bucketkeys(table, i) (&(table)->segments[(i) / SEGMENT_SIZE].keys[ \
+	(size_t)((i) % SEGMENT_SIZE) * (table)->keystride])
+#define pageat(table, p) (&(table)->pages[p])
+#define pagekeys(table, p) (&(table)->pagekeys[(size_t)(p) * (table)->keystride])
+
+/* * * *
+ * helper functions
+ */
+
+// calculate the address of the bucket for keys with hash value 'hash'
+static int bucket_address(LinHashTable *table, int hash) {
+	int address = rightmostnbits(table->level, hash);
+
+	// buckets before the split pointer have already been split, so use an
+	// extra bit to choose between the bucket and its split image
+	if (address < table->next) {
+		address = rightmostnbits(table->level + 1, hash);
+	}
+	return address;
+}
+
+// add a new (empty) bucket to the end of the array of buckets, adding a new
+// segment if the last one is full
+static void add_bucket(LinHashTable *table) {
+	assert(table->nbuckets < MAX_TABLE_SIZE && "error: table has grown too large!");
+
+	if (table->nbuckets == table->nsegments * SEGMENT_SIZE) {
+		// make space for more segments (only the small array of segments is
+		// ever copied, never the buckets themselves)
+		if (table->nsegments == table->segmentssize) {
+			size_t oldsize = (sizeof *table->segments) * table->segmentssize;
+			table->segmentssize *= 2;
+			table->segments = memory_realloc(&table->stats.memory,
+				MEMORY_DIRECTORY, table->segments, oldsize, oldsize * 2);
+			assert(table->segments);
+		}
+
+		Segment *segment = &table->segments[table->nsegments++];
+		segment->buckets = memory_malloc(&table->stats.memory, MEMORY_BUCKETS,
+			(sizeof *segment->buckets) * SEGMENT_SIZE);
+		assert(segment->buckets);
+		segment->keys = memory_malloc(&table->stats.memory, MEMORY_KEYS,
+			(sizeof *segment->keys) * SEGMENT_SIZE * table->keystride);
+		assert(segment->keys);
+	}
+
+	Bucket *bucket = bucketat(table, table->nbuckets);
+	bucket->nkeys = 0;
+	bucket->overflow = NO_OVERFLOW;
+	table->nbuckets++;
+}
+
+// get an empty overflow page (reusing one that's no longer in use, if there is
+// one) and return its index in the pool of overflow pages
+static BucketIndex new_page(LinHashTable *table) {
+	BucketIndex p;
+	if (table->freepages != NO_OVERFLOW) {
+		// reuse the first page in the chain of unused pages
+		p = table->freepages;
+		table->freepages = pageat(table, p)->overflow;
+
+	} else {
+		// make more space in the pool if it is full (doubling, so that adding
+		// pages costs constant time on average)
+		if (table->npages == table->pagessize) {
+			size_t oldpages = (sizeof *table->pages) * table->pagessize;
+			size_t oldkeys = (sizeof *table->pagekeys) * table->pagessize *
+				table->keystride;
+			table->pagessize *= 2;
+			table->pages = memory_realloc(&table->stats.memory, MEMORY_BUCKETS,
+				table->pages, oldpages, oldpages * 2);
+			assert(table->pages);
+			table->pagekeys = memory_realloc(&table->stats.memory, MEMORY_KEYS,
+				table->pagekeys, oldkeys, oldkeys * 2);
+			assert(table->pagekeys);
+		}
+		p = table->npages++;
+	}
+
+	pageat(table, p)->nkeys = 0;
+	pageat(table, p)->overflow = NO_OVERFLOW;
+	table->noverflow++;
+	return p;
+}
+
+// checks if key is in the bucket at address 'address', or in its chain of
+// overflow pages; returns true if it is, false if it is not
+static bool find_key(LinHashTable *table, int address, int64 key) {
+	// compare several of the bucket's keys at once
+	Bucket *bucket = bucketat(table, address);
+	if (keysearch(bucketkeys(table, address), bucket->nkeys, key)) {
+		return true;
+	}
+
+	// then do the same for each overflow page in turn
+	BucketIndex p;
+	for (p = bucket->overflow; p != NO_OVERFLOW; p = pageat(table, p)->overflow) {
+		if (keysearch(pagekeys(table, p), pageat(table, p)->nkeys, key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// add a key to the bucket at address 'address' (we can assume it's not already
+// there), putting it in the bucket's chain of overflow pages if the bucket is
+// full: in the first page with space, or a new page at the end of the chain
+static void append_key(LinHashTable *table, int address, int64 key) {
+	Bucket *bucket = bucketat(table, address);
+	if (bucket->nkeys < table->bucketsize) {
+		bucketkeys(table, address)[bucket->nkeys] = key;
+		bucket->nkeys++;
+		return;
+	}
+
+	if (bucket->overflow == NO_OVERFLOW) {
+		BucketIndex page = new_page(table);
+		bucket->overflow = page;
+	}
+	BucketIndex p = bucket->overflow;
+	while (pageat(table, p)->nkeys == table->bucketsize) {
+		if (pageat(table, p)->overflow == NO_OVERFLOW) {
+			BucketIndex page = new_page(table);
+			pageat(table, p)->overflow = page;
+		}
+		p = pageat(table, p)->overflow;
+	}
+	pagekeys(table, p)[pageat(table, p)->nkeys] = key;
+	pageat(table, p)->nkeys++;
+}
+
+// copy 'nkeys' keys into the scratch space, starting at position 'start',
+// making more space first if necessary
+static void save_keys(LinHashTable *table, int start, int64 *keys, int nkeys) {
+	if (start + nkeys > table->scratchsize) {
+		size_t oldsize = (sizeof *table->scratch) * table->scratchsize;
+		while (start + nkeys > table->scratchsize) {
+			table->scratchsize *= 2;
+		}
+		table->scratch = memory_realloc(&table->stats.memory, MEMORY_SCRATCH,
+			table->scratch, oldsize,
+			(sizeof *table->scratch) * table->scratchsize);
+		assert(table->scratch);
+	}
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		table->scratch[start + i] = keys[i];
+	}
+}
+
+// split the bucket at the split pointer into itself and a new bucket at the end
+// of the table, and advance the split pointer
+static void split_bucket(LinHashTable *table) {
+	TRACE_START(start);
+
+	// FIRST,
+	// add the new bucket (the split image of the bucket being split)
+	int address = table->next;
+	add_bucket(table);
+
+	// SECOND,
+	// take all of the keys out of the bucket and its chain of overflow pages,
+	// returning the overflow pages to the chain of unused pages
+	Bucket *bucket = bucketat(table, address);
+	int nkeys = 0;
+	save_keys(table, nkeys, bucketkeys(table, address), bucket->nkeys);
+	nkeys += bucket->nkeys;
+	bucket->nkeys = 0;
+
+	BucketIndex p = bucket->overflow;
+	while (p != NO_OVERFLOW) {
+		save_keys(table, nkeys, pagekeys(table, p), pageat(table, p)->nkeys);
+		nkeys += pageat(table, p)->nkeys;
+
+		BucketIndex nextpage = pageat(table, p)->overflow;
+		pageat(table, p)->overflow = table->freepages;
+		table->freepages = p;
+		table->noverflow--;
+		p = nextpage;
+	}
+	bucket->overflow = NO_OVERFLOW;
+
+	// THIRD,
+	// move the split pointer along, starting the next round of splits (with
+	// one more bit of the hash value) once every bucket has been split
+	table->next++;
+	if (table->next == 1 << table->level) {
+		table->level++;
+		table->next = 0;
+	}
+	table->stats.nsplits++;
+
+	// FINALLY,
+	// filter the keys into their rightful places in the new table (which may
+	// be the old bucket, or may be the new bucket)
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		int64 key = table->scratch[i];
+		append_key(table, bucket_address(table, h1(key)), key);
+	}
+
+	TRACE_STOP(&table->stats.trace, TRACE_SPLIT, start, nkeys,
+		table->nbuckets - 1, table->nbuckets);
+}
+
+
+// count how many keys each bucket (with its chain of overflow pages) holds in
+// 'occupancy'
+static void count_occupancy(LinHashTable *table, Histogram *occupancy) {
+	initialise_histogram(occupancy);
+	int i;
+	for (i = 0; i < table->nbuckets; i++) {
+		Bucket *bucket = bucketat(table, i);
+		long nkeys = bucket->nkeys;
+		BucketIndex p;
+		for (p = bucket->overflow; p != NO_OVERFLOW;
+				p = pageat(table, p)->overflow) {
+			nkeys += pageat(table, p)->nkeys;
+		}
+		histogram_add(occupancy, nkeys);
+	}
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// initialise a linear hashing table with 'bucketsize' keys per bucket
+LinHashTable *new_linhash_hash_table(int bucketsize) {
+	LinHashTable *table = malloc(sizeof *table);
+	assert(table);
+	initialise_memory_usage(&table->stats.memory);
+	// the latencies and trace are instrumentation, not the table
+	long instrumentation = sizeof table->stats.latency +
+		sizeof table->stats.trace;
+	memory_count(&table->stats.memory, MEMORY_TABLE,
+		sizeof *table - instrumentation);
+	memory_count(&table->stats.memory, MEMORY_INSTRUMENTATION, instrumentation);
+
+	table->bucketsize = bucketsize;
+	table->keystride = keysearch_padded(bucketsize);
+
+	// start with a single segment, holding a single bucket
+	table->nsegments = 0;
+	table->segmentssize = 1;
+	table->segments = memory_malloc(&table->stats.memory, MEMORY_DIRECTORY,
+		sizeof *table->segments);
+	assert(table->segments);
+	table->nbuckets = 0;
+	add_bucket(table);
+	table->level = 0;
+	table->next = 0;
+
+	// and no overflow pages yet
+	table->npages = 0;
+	table->pagessize = 1;
+	table->pages = memory_malloc(&table->stats.memory, MEMORY_BUCKETS,
+		sizeof *table->pages);
+	assert(table->pages);
+	table->pagekeys = memory_malloc(&table->stats.memory, MEMORY_KEYS,
+		(sizeof *table->pagekeys) * table->keystride);
+	assert(table->pagekeys);
+	table->noverflow = 0;
+	table->freepages = NO_OVERFLOW;
+
+	table->scratchsize = bucketsize;
+	table->scratch = memory_malloc(&table->stats.memory, MEMORY_SCRATCH,
+		(sizeof *table->scratch) * table->scratchsize);
+	assert(table->scratch);
+
+	table->stats.nkeys = 0;
+	table->stats.nsplits = 0;
+	initialise_trace(&table->stats.trace);
+	initialise_latency(&table->stats.latency);
+
+	return table;
+}
+
+
+// free all memory associated with 'table'
+void free_linhash_hash_table(LinHashTable *table) {
+	assert(table);
+
+	// free each segment of buckets, then the array of segments
+	MemoryUsage *memory = &table->stats.memory;
+	int s;
+	for (s = 0; s < table->nsegments; s++) {
+		memory_free(memory, MEMORY_BUCKETS, table->segments[s].buckets,
+			(sizeof *table->segments[s].buckets) * SEGMENT_SIZE);
+		memory_free(memory, MEMORY_KEYS, table->segments[s].keys,
+			(sizeof *table->segments[s].keys) * SEGMENT_SIZE *
+			table->keystride);
+	}
+	memory_free(memory, MEMORY_DIRECTORY, table->segments,
+		(sizeof *table->segments) * table->segmentssize);
+
+	// free the pool of overflow pages and the scratch space
+	memory_free(memory, MEMORY_BUCKETS, table->pages,
+		(sizeof *table->pages) * table->pagessize);
+	memory_free(memory, MEMORY_KEYS, table->pagekeys,
+		(sizeof *table->pagekeys) * table->pagessize * table->keystride);
+	memory_free(memory, MEMORY_SCRATCH, table->scratch,
+		(sizeof *table->scratch) * table->scratchsize);
+
+	// free the table struct itself
+	free(table);
+}
+
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool linhash_hash_table_insert(LinHashTable *table, int64 key) {
+	assert(table);
+	LATENCY_START(start_time); // start timing
+
+	// find the bucket for this key
+	int address = bucket_address(table, h1(key));
+
+	// is this key already there?
+	if (find_key(table, address, key)) {
+		// add time elapsed
+		LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
+		return false;
+	}
+
+	// if not, add it to its bucket (or the bucket's overflow pages)
+	append_key(table, address, key);
+	table->stats.nkeys++;
+
+	// then, if the table has become too full, split the next bucket in turn
+	// (just one bucket per insertion, so growth is smooth)
+	if (table->stats.nkeys >
+			MAX_LOAD_FACTOR * table->nbuckets * table->bucketsize) {
+		split_bucket(table);
+	}
+
+	// count the time elapsed before returning
+	LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
+	return true;
+}
+
+
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool linhash_hash_table_lookup(LinHashTable *table, int64 key) {
+	assert(table);
+	LATENCY_START(start_time); // start timing
+
+	// look for the key in its bucket (and the bucket's overflow pages)
+	bool found = find_key(table, bucket_address(table, h1(key)), key);
+
+	// count the time elapsed before returning result
+	LATENCY_STOP(&table->stats.latency, LATENCY_LOOKUP, start_time);
+	return found;
+}
+
+
+// print the 'nkeys' keys of a bucket or overflow page between square brackets,
+// with a dash for each unused key slot
+static void print_keys(int64 *keys, int nkeys, int bucketsize) {
+	printf("[");
+	int j;
+	for (j = 0; j < bucketsize; j++) {
+		if (j < nkeys) {
+			printf(" %llu", keys[j]);
+		} else {
+			printf(" -");
+		}
+	}
+	printf(" ]");
+}
+
+// print the contents of 'table' to stdout
+void linhash_hash_table_print(LinHashTable *table) {
+	assert(table);
+	printf("--- table size: %d\n", table->nbuckets);
+
+	// print header
+	printf("  address | [keys] -> [overflow keys]\n");
+
+	// print each bucket followed by its chain of overflow pages
+	int i;
+	for (i = 0; i < table->nbuckets; i++) {
+		Bucket *bucket = bucketat(table, i);
+		printf("%9d | ", i);
+		print_keys(bucketkeys(table, i), bucket->nkeys, table->bucketsize);
+
+		BucketIndex p;
+		for (p = bucket->overflow; p != NO_OVERFLOW;
+				p = pageat(table, p)->overflow) {
+			printf(" -> ");
+			print_keys(pagekeys(table, p), pageat(table, p)->nkeys,
+				table->bucketsize);
+		}
+		printf("\n");
+	}
+
+	printf("--- end table ---\n");
+}
+
+
+// print some statistics about 'table' to stdout
+void linhash_hash_table_stats(LinHashTable *table) {
+	assert(table);
+
+	printf("--- table stats ---\n");
+
+	// print some stats about state of the table
+	printf("               current table size: %d\n", table->nbuckets);
+	printf("                   number of keys: %d keys\n", table->stats.nkeys);
+	printf("                      bucket size: %d keys per bucket\n",
+		table->bucketsize);
+	printf("                number of buckets: %d buckets\n", table->nbuckets);
+	printf("         number of overflow pages: %d pages\n", table->noverflow);
+	printf("average number of keys per bucket: %.3f keys\n",
+		table->stats.nkeys * 1.0 / table->nbuckets);
+	printf("                      load factor: %.3f%%\n",
+		table->stats.nkeys * 100.0 / (table->nbuckets * table->bucketsize));
+	printf("             level, split pointer: %d, %d\n", table->level,
+		table->next);
+	printf("                 number of splits: %d\n", table->stats.nsplits);
+
+	// also print how long operations have taken, and how much memory the
+	// table is using
+	latency_print(&table->stats.latency, 18);
+	Histogram occupancy;
+	count_occupancy(table, &occupancy);
+	histogram_print(&occupancy, "bucket occupancy", 18);
+	TableStats stats;
+	initialise_table_stats(&stats);
+	linhash_hash_table_get_stats(table, &stats);
+	print_table_memory(&stats, 18);
+
+	printf("--- end stats ---\n");
+}
+
+
+// fill in 'stats' with statistics about 'table'
+void linhash_hash_table_get_stats(LinHashTable *table, TableStats *stats) {
+	assert(table);
+
+	size_t bucketbytes = sizeof (Bucket) + table->keystride * sizeof (int64);
+	stats->nkeys = table->stats.nkeys;
+	stats->nbuckets = table->nbuckets;
+	stats->bucketsize = table->bucketsize;
+	stats->size = table->nbuckets;
+	stats->noverflow = table->noverflow;
+	stats->load_factor = stats->nkeys * 1.0 /
+		(table->nbuckets * table->bucketsize);
+	// (only the buckets and overflow pages in use can waste space: the rest
+	// are slack, below)
+	stats->wasted = ((long)(table->nbuckets + table->noverflow) *
+		table->keystride - stats->nkeys) * sizeof (int64);
+
+	// segments and overflow pages not yet (or no longer) holding a bucket
+	stats->slack = (long)(table->segmentssize - table->nsegments) *
+		sizeof *table->segments +
+		((long)table->nsegments * SEGMENT_SIZE - table->nbuckets) * bucketbytes +
+		(long)(table->pagessize - table->noverflow) * bucketbytes;
+	table_stats_memory(stats, &table->stats.memory);
+	count_occupancy(table, &stats->histograms[HISTOGRAM_OCCUPANCY]);
+	stats->time = latency_summarise(&table->stats.latency, stats->latency);
+	stats->last_resize = trace_last_duration(&table->stats.trace);
+}
+
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void linhash_hash_table_trace(LinHashTable *table, int track) {
+	assert(table);
+
+	trace_print_chrome(&table->stats.trace, "linhash", track);
+}
@@ -0,0 +1,46 @@
+/* * * * * * * * *
+ * Dynamic hash table using linear hashing (Litwin) with multiple keys per
+ * bucket, growing one bucket at a time in round-robin order as the table fills
+ * up, with overflow pages for buckets that fill before their turn to split
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef LINHASH_H
+#define LINHASH_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "../tablestats.h"
+
+typedef struct linhash_table LinHashTable;
+
+// initialise a linear hashing table with 'bucketsize' keys per bucket
+LinHashTable *new_linhash_hash_table(int bucketsize);
+
+// free all memory associated with 'table'
+void free_linhash_hash_table(LinHashTable *table);
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool linhash_hash_table_insert(LinHashTable *table, int64 key);
+
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool linhash_hash_table_lookup(LinHashTable *table, int64 key);
+
+// print the contents of 'table' to stdout
+void linhash_hash_table_print(LinHashTable *table);
+
+// print some statistics about 'table' to stdout
+void linhash_hash_table_stats(LinHashTable *table);
+
+// fill in 'stats' with statistics about 'table'
+void linhash_hash_table_get_stats(LinHashTable *table, TableStats *stats);
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void linhash_hash_table_trace(LinHashTable *table, int track);
+
+#endif
@@ -9,148 +9,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xtndbl1.h"
-
-// macro to calculate the rightmost n bits of a number x
-#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
-
-// a bucket stores a single key (full=true) or is empty (full=false)
-// it also knows how many bits are shared between possible keys, and the first 
-// table address that references it
-typedef struct bucket {
-	int id;		// a unique id for this bucket, equal to the first address
-				// in the table which points to it
-	int depth;	// how many hash value bits are being used by this bucket
-	bool full;	// does this bucket contain a key
-	int64 key;	// the key stored in this bucket
-} Bucket;
+#include "../latency.h"
+#include "../memusage.h"
+#include "../trace.h"
+#include "inlinedir.h"
 
 // helper structure to store statistics gathered
 typedef struct stats {
-	int nbuckets;	// how many distinct buckets does the table point to
 	int nkeys;		// how many keys are being stored in the table
-	int time;		// how much CPU time has been used to insert/lookup keys
-					// in this table
+	Latency latency;	// how long inserts/lookups have taken
+	MemoryUsage memory;	// how many bytes the table has allocated
+	Trace trace;		// when buckets have split, and how long it took
 } Stats;
 
-// a hash table is an array of slots pointing to buckets holding up to 1 key,
-// along with some usage statistics and information about the number of hash
-// value bits to use for addressing
+// a hash table is a directory of slots holding buckets of up to 1 key (inline
+// in the slot, if it's the only slot referring to the bucket), along with some
+// usage statistics
 struct xtndbl1_table {
-	Bucket **buckets;	// array of pointers to buckets
-	int size;			// how many entries in the table of pointers (2^depth)
-	int depth;			// how many bits of the hash value to use (log2(size))
-	Stats stats;		// collection of statistics about this hash table
+	InlineDirectory directory;	// table of buckets
+	Stats stats;				// collection of statistics about this hash table
 };
 
-/* * * *
- * helper functions
- */
-
-// create a new bucket first referenced from 'first_address', based on 'depth'
-// bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth) {
-	Bucket *bucket = malloc(sizeof *bucket);
-	assert(bucket);
-
-	bucket->id = first_address;
-	bucket->depth = depth;
-	bucket->full = false;
-
-	return bucket;
-}
-
-// double the table of bucket pointers, duplicating the bucket pointers in the
-// first half into the new second half of the table
-static void double_table(Xtndbl1HashTable *table) {
-	int size = table->size * 2;
-	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
-
-	// get a new array of twice as many bucket pointers, and copy pointers down
-	table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size);
-	assert(table->buckets);
-	int i;
-	for (i = 0; i < table->size; i++) {
-		table->buckets[table->size + i] = table->buckets[i];
-	}
-
-	// finally, increase the table size and the depth we are using to hash keys
-	table->size = size;
-	table->depth++;
-}
-
-// reinsert a key into the hash table after splitting a bucket --- we can assume
-// that there will definitely be space for this key because it was already
-// inside the hash table previously
-// use 'xtndbl1_hash_table_insert()' instead for inserting new keys
-static void reinsert_key(Xtndbl1HashTable *table, int64 key) {
-	int address = rightmostnbits(table->depth, h1(key));
-	table->buckets[address]->key = key;
-	table->buckets[address]->full = true;
-}
-
-// split the bucket in 'table' at address 'address', growing table if necessary
-static void split_bucket(Xtndbl1HashTable *table, int address) {
-	
-	// FIRST,
-	// do we need to grow the table?
-	if (table->buckets[address]->depth == table->depth) {
-		// yep, this bucket is down to its last pointer
-		double_table(table);
-	}
-	// either way, now it's time to split this bucket
-
-
-	// SECOND,
-	// create a new bucket and update both buckets' depth
-	Bucket *bucket = table->buckets[address];
-	int depth = bucket->depth;
-	int first_address = bucket->id;
-
-	int new_depth = depth + 1;
-	bucket->depth = new_depth;
-
-	// new bucket's first address will be a 1 bit plus the old first address
-	int new_first_address = 1 << depth | first_address;
-	Bucket *newbucket = new_bucket(new_first_address, new_depth);
-	table->stats.nbuckets++;
-	
-	// THIRD,
-	// redirect every second address pointing to this bucket to the new bucket
-	// construct addresses by joining a bit 'prefix' and a bit 'suffix'
-	// (defined below)
-
-	// suffix: a 1 bit followed by the previous bucket bit address
-	int bit_address = rightmostnbits(depth, first_address);
-	int suffix = (1 << depth) | bit_address;
-
-	// prefix: all bitstrings of length equal to the difference between the new
-	// bucket depth and the table depth
-	// use a for loop to enumerate all possible prefixes less than maxprefix:
-	int maxprefix = 1 << (table->depth - new_depth);
-
-	int prefix;
-	for (prefix = 0; prefix < maxprefix; prefix++) {
-		
-		// construct address by joining this prefix and the suffix
-		int a = (prefix << new_depth) | suffix;
-
-		// redirect this table entry to point at the new bucket
-		table->buckets[a] = newbucket;
-	}
-
-	// FINALLY,
-	// filter the key from the old bucket into its rightful place in the new 
-	// table (which may be the old bucket, or may be the new bucket)
-
-	// remove and reinsert the key
-	int64 key = bucket->key;
-	bucket->full = false;
-	reinsert_key(table, key);
-}
-
 
 /* * * *
  * all functions
@@ -160,16 +41,19 @@ static void split_bucket(Xtndbl1HashTable *table, int address) {
 Xtndbl1HashTable *new_xtndbl1_hash_table() {
 	Xtndbl1HashTable *table = malloc(sizeof *table);
 	assert(table);
+	initialise_memory_usage(&table->stats.memory);
+	// the latencies and trace are instrumentation, not the table
+	long instrumentation = sizeof table->stats.latency +
+		sizeof table->stats.trace;
+	memory_count(&table->stats.memory, MEMORY_TABLE,
+		sizeof *table - instrumentation);
+	memory_count(&table->stats.memory, MEMORY_INSTRUMENTATION, instrumentation);
 
-	table->size = 1;
-	table->buckets = malloc(sizeof *table->buckets);
-	assert(table->buckets);
-	table->buckets[0] = new_bucket(0, 0);
-	table->depth = 0;
+	initialise_inline_directory(&table->directory, h1, &table->stats.memory);
 
-	table->stats.nbuckets = 1;
 	table->stats.nkeys = 0;
-	table->stats.time = 0;
+	initialise_trace(&table->stats.trace);
+	initialise_latency(&table->stats.latency);
 
 	return table;
 }
@@ -179,18 +63,8 @@ Xtndbl1HashTable *new_xtndbl1_hash_table() {
 void free_xtndbl1_hash_table(Xtndbl1HashTable *table) {
 	assert(table);
 
-	// loop backwards through the array of pointers, freeing buckets only as we
-	// reach their first reference
-	// (if we loop through forwards, we wouldn't know which reference was last)
-	int i;
-	for (i = table->size-1; i >= 0; i--) {
-		if (table->buckets[i]->id == i) {
-			free(table->buckets[i]);
-		}
-	}
-
-	// free the array of bucket pointers
-	free(table->buckets);
+	// free the directory (and its pool of shared buckets)
+	free_inline_directory(&table->directory);
 	
 	// free the table struct itself
 	free(table);
@@ -201,33 +75,39 @@ void free_xtndbl1_hash_table(Xtndbl1HashTable *table) {
 // returns true if insertion succeeds, false if it was already in there
 bool xtndbl1_hash_table_insert(Xtndbl1HashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // start timing
+	LATENCY_START(start_time); // start timing
 	
-	// calculate table address
+	// find the bucket for this key
 	int hash = h1(key);
-	int address = rightmostnbits(table->depth, hash);
 	
 	// is this key already there?
-	if (table->buckets[address]->full && table->buckets[address]->key == key) {
-		table->stats.time += clock() - start_time; // add time elapsed
+	if (inline_directory_find(&table->directory, hash, key)) {
+		// add time elapsed
+		LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
 		return false;
 	}
 
-	// if not, make space in the table until our target bucket has space
-	while (table->buckets[address]->full) {
-		split_bucket(table, address);
-
-		// and recalculate address because we might now need more bits
-		address = rightmostnbits(table->depth, hash);
+	// if not, make space in the table until our target bucket has space (and
+	// we can insert this key)
+	while (!inline_directory_add(&table->directory, hash, key)) {
+		TRACE_START(split_time);
+		int oldsize = table->directory.size;
+		int oldnbuckets = table->directory.nbuckets;
+		int moved = inline_directory_bucket(&table->directory, hash).full;
+		inline_directory_split(&table->directory, hash);
+
+		// trace the split (and the doubling of the directory, if it had to)
+		TRACE_STOP(&table->stats.trace, TRACE_SPLIT, split_time, moved,
+			oldnbuckets, table->directory.nbuckets);
+		if (table->directory.size != oldsize) {
+			TRACE_STOP(&table->stats.trace, TRACE_DOUBLE, split_time, 0,
+				oldsize, table->directory.size);
+		}
 	}
-
-	// there's now space! we can insert this key
-	table->buckets[address]->key = key;
-	table->buckets[address]->full = true;
 	table->stats.nkeys++;
 
-	// add time elapsed to total CPU time before returning
-	table->stats.time += clock() - start_time;
+	// count the time elapsed before returning
+	LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
 	return true;
 }
 
@@ -236,20 +116,13 @@ bool xtndbl1_hash_table_insert(Xtndbl1HashTable *table, int64 key) {
 // returns true if found, false if not
 bool xtndbl1_hash_table_lookup(Xtndbl1HashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // start timing
+	LATENCY_START(start_time); // start timing
 
-	// calculate table address for this key
-	int address = rightmostnbits(table->depth, h1(key));
-	
-	// look for the key in that bucket (unless it's empty)
-	bool found = false;
-	if (table->buckets[address]->full) {
-		// found it?
-		found = table->buckets[address]->key == key;
-	}
+	// look for the key in its bucket
+	bool found = inline_directory_find(&table->directory, h1(key), key);
 
-	// add time elapsed to total CPU time before returning result
-	table->stats.time += clock() - start_time;
+	// count the time elapsed before returning result
+	LATENCY_STOP(&table->stats.latency, LATENCY_LOOKUP, start_time);
 	return found;
 }
 
@@ -257,7 +130,8 @@ bool xtndbl1_hash_table_lookup(Xtndbl1HashTable *table, int64 key) {
 // print the contents of 'table' to stdout
 void xtndbl1_hash_table_print(Xtndbl1HashTable *table) {
 	assert(table);
-	printf("--- table size: %d\n", table->size);
+	int size = 1 << table->directory.depth;
+	printf("--- table size: %d\n", size);
 
 	// print header
 	printf("  table:               buckets:\n");
@@ -265,15 +139,16 @@ void xtndbl1_hash_table_print(Xtndbl1HashTable *table) {
 	
 	// print table and buckets
 	int i;
-	for (i = 0; i < table->size; i++) {
+	for (i = 0; i < size; i++) {
 		// table entry
-		printf("%9d | %-9d ", i, table->buckets[i]->id);
+		SharedBucket bucket = inline_directory_bucket(&table->directory, i);
+		printf("%9d | %-9d ", i, bucket.id);
 
 		// if this is the first address at which a bucket occurs, print it
-		if (table->buckets[i]->id == i) {
-			printf("%9d ", table->buckets[i]->id);
-			if (table->buckets[i]->full) {
-				printf("[%llu]", table->buckets[i]->key);
+		if (bucket.id == i) {
+			printf("%9d ", bucket.id);
+			if (bucket.full) {
+				printf("[%llu]", bucket.key);
 			} else {
 				printf("[ ]");
 			}
@@ -294,13 +169,44 @@ void xtndbl1_hash_table_stats(Xtndbl1HashTable *table) {
 	printf("--- table stats ---\n");
 
 	// print some stats about state of the table
-	printf("current table size: %d\n", table->size);
+	printf("current table size: %d\n", table->directory.size);
 	printf("    number of keys: %d\n", table->stats.nkeys);
-	printf(" number of buckets: %d\n", table->stats.nbuckets);
-
-	// also calculate CPU usage in seconds and print this
-	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-	printf("    CPU time spent: %.6f sec\n", seconds);
+	printf(" number of buckets: %d\n", table->directory.nbuckets);
+	printf("    shared buckets: %d\n", table->directory.nshared);
+
+	// also print how long operations have taken, and how much memory the
+	// table is using
+	latency_print(&table->stats.latency, 18);
+	TableStats stats;
+	initialise_table_stats(&stats);
+	xtndbl1_hash_table_get_stats(table, &stats);
+	print_table_memory(&stats, 18);
 	
 	printf("--- end stats ---\n");
 }
+
+
+// fill in 'stats' with statistics about 'table'
+void xtndbl1_hash_table_get_stats(Xtndbl1HashTable *table, TableStats *stats) {
+	assert(table);
+
+	stats->nkeys = table->stats.nkeys;
+	stats->nbuckets = table->directory.nbuckets;
+	stats->bucketsize = 1;
+	stats->size = table->directory.size;
+	stats->load_factor = stats->nkeys * 1.0 / stats->nbuckets;
+	stats->wasted = inline_directory_wasted(&table->directory, stats->nkeys);
+	stats->slack = inline_directory_slack(&table->directory);
+	table_stats_memory(stats, &table->stats.memory);
+	stats->time = latency_summarise(&table->stats.latency, stats->latency);
+	stats->last_resize = trace_last_duration(&table->stats.trace);
+}
+
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xtndbl1_hash_table_trace(Xtndbl1HashTable *table, int track) {
+	assert(table);
+
+	trace_print_chrome(&table->stats.trace, "xtndbl1", track);
+}
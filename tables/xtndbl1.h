@@ -11,6 +11,7 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../tablestats.h"
 
 typedef struct xtndbl1_table Xtndbl1HashTable;
 
@@ -34,4 +35,11 @@ void xtndbl1_hash_table_print(Xtndbl1HashTable *table);
 // print some statistics about 'table' to stdout
 void xtndbl1_hash_table_stats(Xtndbl1HashTable *table);
 
+// fill in 'stats' with statistics about 'table'
+void xtndbl1_hash_table_get_stats(Xtndbl1HashTable *table, TableStats *stats);
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xtndbl1_hash_table_trace(Xtndbl1HashTable *table, int track);
+
 #endif
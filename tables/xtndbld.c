@@ -0,0 +1,516 @@
+/* * * * * * * * *
+ * Disk-backed hash table using extendible hashing with multiple keys per
+ * bucket, storing each bucket as a fixed-size page in a file and keeping only
+ * the directory (and a buffer pool of recently used pages) in memory
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+// for pread, pwrite and mkstemp
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "xtndbld.h"
+#include "../latency.h"
+#include "../memusage.h"
+#include "../trace.h"
+#include "keysearch.h"
+#include "directory.h"
+
+// how many bytes are in each page of the table's file (and in each frame of
+// its buffer pool) (compile with -DPAGE_SIZE=n to change this)
+#ifndef PAGE_SIZE
+#define PAGE_SIZE 4096
+#endif
+
+// a page stores a bucket: a small header followed by as many keys as fit
+// the header knows how many bits are shared between possible keys, and the
+// first directory address that references it (just like an xtndbln bucket)
+typedef struct page {
+	int32_t id;		// a unique id for this bucket, equal to the first address
+					// in the directory which points to it
+	int32_t depth;	// how many hash value bits are being used by this bucket
+	int32_t nkeys;	// number of keys currently contained in this bucket
+	int32_t unused;	// (keeps the keys 8-byte aligned)
+	int64 keys[];	// the keys stored in this bucket
+} Page;
+
+// maximum number of keys per bucket, given the size of a page
+// (rounded down to whole vectors of keys, which keysearch may read in full)
+#define BUCKETSIZE ((PAGE_SIZE - sizeof (Page)) / sizeof (int64) / \
+                    KEYSEARCH_WIDTH * KEYSEARCH_WIDTH)
+
+// marks a frame holding no page, or a page not held in any frame
+#define NO_PAGE ((BucketIndex)-1)
+#define NO_FRAME -1
+
+// a frame is a slot in the buffer pool that can hold one page in memory
+typedef struct frame {
+	BucketIndex page;	// which page of the file is held here (or NO_PAGE)
+	bool dirty;			// has the page changed since it was last written?
+	bool referenced;	// has the page been used since the clock hand passed?
+} Frame;
+
+// helper structure to store statistics gathered
+typedef struct stats {
+	int nkeys;		// how many keys are being stored in the table
+	long hits;		// how many page requests were answered from the pool
+	long reads;		// how many pages have been read from the file
+	long writes;	// how many pages have been written to the file
+	Latency latency;	// how long inserts/lookups have taken
+	MemoryUsage memory;	// how many bytes the table has allocated
+	Trace trace;		// when buckets have split, and how long it took
+} Stats;
+
+// a disk-backed hash table is a directory of slots holding the numbers of
+// pages in a file, each page holding a bucket of keys. recently used pages are
+// cached in a buffer pool of frames, which are replaced in 'clock' order
+struct xtndbld_table {
+	Directory directory;	// table of page numbers of buckets in the file
+	int fd;					// the (already unlinked) file holding the pages
+	int npages;				// how many pages are in the file
+	int *frameof;			// which frame each page is held in (or NO_FRAME)
+	int frameofsize;		// how many pages 'frameof' has space for
+	Frame *frames;			// the frames in the buffer pool
+	char *data;				// PAGE_SIZE bytes of page data for each frame
+	int nframes;			// how many frames are in the buffer pool
+	int hand;				// the frame the clock hand is pointing at
+	int64 *scratch;			// space to hold a bucket's keys while it splits
+	Stats stats;			// collection of statistics about this hash table
+};
+
+// macro to get a pointer to the page data held in frame 'f'
+#define framedata(table, f) ((Page *)&(table)->data[(size_t)(f) * PAGE_SIZE])
+
+/* * * *
+ * helper functions
+ */
+
+// write the page held in frame 'f' back to its place in the file
+static void write_frame(XtndblDHashTable *table, int f) {
+	off_t offset = (off_t)table->frames[f].page * PAGE_SIZE;
+	ssize_t n = pwrite(table->fd, framedata(table, f), PAGE_SIZE, offset);
+	assert(n == PAGE_SIZE && "error: couldn't write page to file!");
+	table->frames[f].dirty = false;
+	table->stats.writes++;
+}
+
+// choose a frame to hold a new page, by sweeping the clock hand past recently
+// used frames (clearing their reference bits as it goes) until it reaches one
+// that hasn't been used since the hand last passed. the page in that frame is
+// written back to the file if it has changed, and evicted
+static int evict_frame(XtndblDHashTable *table) {
+	while (table->frames[table->hand].referenced) {
+		table->frames[table->hand].referenced = false;
+		table->hand = (table->hand + 1) % table->nframes;
+	}
+	int f = table->hand;
+	table->hand = (table->hand + 1) % table->nframes;
+
+	if (table->frames[f].page != NO_PAGE) {
+		if (table->frames[f].dirty) {
+			write_frame(table, f);
+		}
+		table->frameof[table->frames[f].page] = NO_FRAME;
+		table->frames[f].page = NO_PAGE;
+	}
+	return f;
+}
+
+// get a pointer to page number 'pageno' in the buffer pool, reading it from the
+// file first if it's not already there
+// (only valid until the next page is requested, since its frame may be reused)
+static Page *get_page(XtndblDHashTable *table, BucketIndex pageno) {
+	int f = table->frameof[pageno];
+	if (f != NO_FRAME) {
+		// it's already in memory
+		table->stats.hits++;
+
+	} else {
+		// it's not in memory: make space for it and read it in
+		f = evict_frame(table);
+		off_t offset = (off_t)pageno * PAGE_SIZE;
+		ssize_t n = pread(table->fd, framedata(table, f), PAGE_SIZE, offset);
+		assert(n == PAGE_SIZE && "error: couldn't read page from file!");
+		table->stats.reads++;
+
+		table->frames[f].page = pageno;
+		table->frames[f].dirty = false;
+		table->frameof[pageno] = f;
+	}
+
+	table->frames[f].referenced = true;
+	return framedata(table, f);
+}
+
+// get a pointer to page number 'pageno' in the buffer pool (as for get_page),
+// and remember that it is going to be changed
+static Page *get_page_for_update(XtndblDHashTable *table, BucketIndex pageno) {
+	Page *page = get_page(table, pageno);
+	table->frames[table->frameof[pageno]].dirty = true;
+	return page;
+}
+
+// add a new page to the end of the file to hold a bucket first referenced from
+// 'first_address', based on 'depth' bits of its keys' hash values, and return
+// its page number. the new page starts out in the buffer pool, to be written
+// to the file when it is evicted
+static BucketIndex new_page(XtndblDHashTable *table, int first_address,
+		int depth) {
+
+	// make more space in the page-to-frame map if it is full
+	if (table->npages == table->frameofsize) {
+		size_t oldsize = (sizeof *table->frameof) * table->frameofsize;
+		table->frameofsize *= 2;
+		table->frameof = memory_realloc(&table->stats.memory, MEMORY_BUCKETS,
+			table->frameof, oldsize, oldsize * 2);
+		assert(table->frameof);
+	}
+
+	BucketIndex pageno = table->npages++;
+	int f = evict_frame(table);
+	table->frames[f].page = pageno;
+	table->frames[f].dirty = true;
+	table->frames[f].referenced = true;
+	table->frameof[pageno] = f;
+
+	Page *page = framedata(table, f);
+	memset(page, 0, PAGE_SIZE);
+	page->id = first_address;
+	page->depth = depth;
+	page->nkeys = 0;
+
+	return pageno;
+}
+
+// reinsert a key into the hash table after splitting a bucket --- we can assume
+// that there will definitely be space for this key because it was already
+// inside the hash table previously
+// use 'xtndbld_hash_table_insert()' instead for inserting new keys
+// function modified from provided function in xtndbl1.c
+static void reinsert_key(XtndblDHashTable *table, int64 key) {
+	BucketIndex pageno = directory_lookup(&table->directory, h1(key));
+	Page *page = get_page_for_update(table, pageno);
+	page->keys[page->nkeys] = key;
+	page->nkeys++;
+}
+
+// split the bucket in 'table' held in page 'pageno', growing the directory if
+// necessary
+// function modified from provided function in xtndbl1.c
+static void split_bucket(XtndblDHashTable *table, BucketIndex pageno) {
+	TRACE_START(start);
+	int oldsize = table->directory.size;
+
+	// FIRST,
+	// take the keys out of the old bucket and update its depth
+	// (they are copied out, since the page may leave the buffer pool while the
+	// new page is being added)
+	Page *page = get_page_for_update(table, pageno);
+	int depth = page->depth;
+	int first_address = page->id;
+	int nkeys = page->nkeys;
+	memcpy(table->scratch, page->keys, (sizeof *table->scratch) * nkeys);
+
+	int new_depth = depth + 1;
+	page->depth = new_depth;
+	page->nkeys = 0;
+
+	// SECOND,
+	// create a new bucket, with the new bucket's first address being a 1 bit
+	// plus the old first address
+	int new_first_address = 1 << depth | first_address;
+	BucketIndex newpageno = new_page(table, new_first_address, new_depth);
+
+	// THIRD,
+	// redirect every second directory entry pointing to this bucket to the new
+	// bucket (the directory grows first if this bucket is down to its last
+	// entry)
+	directory_split(&table->directory, first_address, depth, newpageno);
+
+	// FINALLY,
+	// filter the keys from the old bucket into their rightful places in the
+	// new table (which may be the old bucket, or may be the new bucket)
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		reinsert_key(table, table->scratch[i]);
+	}
+
+	// trace the split (and the doubling of the directory, if it had to)
+	TRACE_STOP(&table->stats.trace, TRACE_SPLIT, start, nkeys,
+		table->npages - 1, table->npages);
+	if (table->directory.size != oldsize) {
+		TRACE_STOP(&table->stats.trace, TRACE_DOUBLE, start, 0, oldsize,
+			table->directory.size);
+	}
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// initialise a disk-backed extendible hash table, caching up to 'npages' of its
+// pages in memory at once
+XtndblDHashTable *new_xtndbld_hash_table(int npages) {
+	XtndblDHashTable *table = malloc(sizeof *table);
+	assert(table);
+	initialise_memory_usage(&table->stats.memory);
+	// the latencies and trace are instrumentation, not the table
+	long instrumentation = sizeof table->stats.latency +
+		sizeof table->stats.trace;
+	memory_count(&table->stats.memory, MEMORY_TABLE,
+		sizeof *table - instrumentation);
+	memory_count(&table->stats.memory, MEMORY_INSTRUMENTATION, instrumentation);
+
+	// create the file to hold the pages, in $TMPDIR (or /tmp). it's unlinked
+	// straight away, so that it's removed however the program exits
+	char *dir = getenv("TMPDIR");
+	char path[1024];
+	snprintf(path, sizeof path, "%s/xtndbld.XXXXXX", dir ? dir : "/tmp");
+	table->fd = mkstemp(path);
+	assert(table->fd >= 0 && "error: couldn't create page file!");
+	unlink(path);
+
+	// set up an empty buffer pool
+	table->nframes = npages;
+	table->frames = memory_malloc(&table->stats.memory, MEMORY_BUCKETS,
+		(sizeof *table->frames) * npages);
+	assert(table->frames);
+	table->data = memory_malloc(&table->stats.memory, MEMORY_KEYS,
+		(size_t)PAGE_SIZE * npages);
+	assert(table->data);
+	int f;
+	for (f = 0; f < npages; f++) {
+		table->frames[f].page = NO_PAGE;
+		table->frames[f].dirty = false;
+		table->frames[f].referenced = false;
+	}
+	table->hand = 0;
+
+	table->npages = 0;
+	table->frameofsize = 1;
+	table->frameof = memory_malloc(&table->stats.memory, MEMORY_BUCKETS,
+		sizeof *table->frameof);
+	assert(table->frameof);
+	table->scratch = memory_malloc(&table->stats.memory, MEMORY_SCRATCH,
+		(sizeof *table->scratch) * BUCKETSIZE);
+	assert(table->scratch);
+
+	table->stats.nkeys = 0;
+	table->stats.hits = 0;
+	table->stats.reads = 0;
+	table->stats.writes = 0;
+	initialise_trace(&table->stats.trace);
+	initialise_latency(&table->stats.latency);
+
+	// start with a single empty bucket
+	initialise_directory(&table->directory, new_page(table, 0, 0),
+		&table->stats.memory);
+
+	return table;
+}
+
+
+// free all memory associated with 'table' (and remove its file)
+void free_xtndbld_hash_table(XtndblDHashTable *table) {
+	assert(table);
+
+	// closing the file removes it, since it has already been unlinked
+	close(table->fd);
+
+	MemoryUsage *memory = &table->stats.memory;
+	memory_free(memory, MEMORY_BUCKETS, table->frames,
+		(sizeof *table->frames) * table->nframes);
+	memory_free(memory, MEMORY_KEYS, table->data,
+		(size_t)PAGE_SIZE * table->nframes);
+	memory_free(memory, MEMORY_BUCKETS, table->frameof,
+		(sizeof *table->frameof) * table->frameofsize);
+	memory_free(memory, MEMORY_SCRATCH, table->scratch,
+		(sizeof *table->scratch) * BUCKETSIZE);
+	free_directory(&table->directory);
+
+	// free the table struct itself
+	free(table);
+}
+
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+// function modified from provided function in xtndbl1.c
+bool xtndbld_hash_table_insert(XtndblDHashTable *table, int64 key) {
+	assert(table);
+	LATENCY_START(start_time); // start timing
+
+	// find the bucket for this key
+	int hash = h1(key);
+	BucketIndex pageno = directory_lookup(&table->directory, hash);
+	Page *page = get_page(table, pageno);
+
+	// is this key already there?
+	if (keysearch(page->keys, page->nkeys, key)) {
+		// add time elapsed
+		LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
+		return false;
+	}
+
+	// if not, make space in the table until our target bucket has space
+	while (page->nkeys == BUCKETSIZE) {
+		split_bucket(table, pageno);
+
+		// and find the bucket again because we might now need more bits
+		pageno = directory_lookup(&table->directory, hash);
+		page = get_page(table, pageno);
+	}
+
+	// there's now space! we can insert this key
+	page = get_page_for_update(table, pageno);
+	page->keys[page->nkeys] = key;
+	page->nkeys++;
+	table->stats.nkeys++;
+
+	// count the time elapsed before returning
+	LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
+	return true;
+}
+
+
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+// function modified from provided function in xtndbl1.c
+bool xtndbld_hash_table_lookup(XtndblDHashTable *table, int64 key) {
+	assert(table);
+	LATENCY_START(start_time); // start timing
+
+	// find the bucket for this key (reading at most one page from the file)
+	BucketIndex pageno = directory_lookup(&table->directory, h1(key));
+	Page *page = get_page(table, pageno);
+
+	// look for the key in that bucket (comparing several keys at once)
+	bool found = keysearch(page->keys, page->nkeys, key);
+
+	// count the time elapsed before returning result
+	LATENCY_STOP(&table->stats.latency, LATENCY_LOOKUP, start_time);
+	return found;
+}
+
+
+// print the contents of 'table' to stdout
+void xtndbld_hash_table_print(XtndblDHashTable *table) {
+	assert(table);
+	int size = 1 << table->directory.depth;
+	printf("--- table size: %d\n", size);
+
+	// print header
+	printf("  table:               buckets:\n");
+	printf("  address | bucketid   bucketid [key]\n");
+
+	// print table and buckets
+	int i;
+	for (i = 0; i < size; i++) {
+		// table entry
+		Page *page = get_page(table, directory_lookup(&table->directory, i));
+		printf("%9d | %-9d ", i, page->id);
+
+		// if this is the first address at which a bucket occurs, print it now
+		if (page->id == i) {
+			printf("%9d ", page->id);
+
+			// print the bucket's contents
+			printf("[");
+			int j;
+			for (j = 0; j < page->nkeys; j++) {
+				printf(" %llu", page->keys[j]);
+			}
+			printf(" ]");
+		}
+		// end the line
+		printf("\n");
+	}
+
+	printf("--- end table ---\n");
+}
+
+
+// print some statistics about 'table' to stdout
+// function modified from provided function in xtndbl1.c
+void xtndbld_hash_table_stats(XtndblDHashTable *table) {
+	assert(table);
+
+	printf("--- table stats ---\n");
+
+	// print some stats about state of the table
+	printf("               current table size: %d\n", table->directory.size);
+	printf("                   number of keys: %d keys\n", table->stats.nkeys);
+	printf("                      bucket size: %d keys per bucket\n",
+		(int)BUCKETSIZE);
+	printf("                  number of pages: %d pages of %d bytes\n",
+		table->npages, PAGE_SIZE);
+	printf("average number of keys per bucket: %.3f keys\n",
+		table->stats.nkeys * 1.0 / table->npages);
+
+	// and about how well the buffer pool is caching the file
+	long requests = table->stats.hits + table->stats.reads;
+	printf("                 buffer pool size: %d pages\n", table->nframes);
+	printf("            buffer pool hit ratio: %.3f%%\n",
+		requests ? table->stats.hits * 100.0 / requests : 0.0);
+	printf("                       page reads: %ld\n", table->stats.reads);
+	printf("                      page writes: %ld\n", table->stats.writes);
+
+	// also print how long operations have taken, and how much memory the
+	// table is using
+	latency_print(&table->stats.latency, 33);
+	TableStats stats;
+	initialise_table_stats(&stats);
+	xtndbld_hash_table_get_stats(table, &stats);
+	print_table_memory(&stats, 33);
+
+	printf("--- end stats ---\n");
+}
+
+
+// fill in 'stats' with statistics about 'table' (its bytes are those held in
+// memory: the pages in the file aren't counted)
+void xtndbld_hash_table_get_stats(XtndblDHashTable *table, TableStats *stats) {
+	assert(table);
+
+	stats->nkeys = table->stats.nkeys;
+	stats->nbuckets = table->npages;
+	stats->bucketsize = BUCKETSIZE;
+	stats->size = table->directory.size;
+	stats->load_factor = stats->nkeys * 1.0 / (table->npages * BUCKETSIZE);
+
+	// a buffer pool frame holding a page wastes the space for keys the page
+	// doesn't fill, and a frame not holding a page at all is slack
+	stats->wasted = 0;
+	stats->slack = (long)(table->frameofsize - table->npages) *
+		sizeof *table->frameof;
+	int f;
+	for (f = 0; f < table->nframes; f++) {
+		if (table->frames[f].page == NO_PAGE) {
+			stats->slack += sizeof *table->frames + PAGE_SIZE;
+		} else {
+			stats->wasted += (BUCKETSIZE - framedata(table, f)->nkeys) *
+				sizeof (int64);
+		}
+	}
+	table_stats_memory(stats, &table->stats.memory);
+	stats->time = latency_summarise(&table->stats.latency, stats->latency);
+	stats->last_resize = trace_last_duration(&table->stats.trace);
+}
+
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xtndbld_hash_table_trace(XtndblDHashTable *table, int track) {
+	assert(table);
+
+	trace_print_chrome(&table->stats.trace, "xtndbld", track);
+}
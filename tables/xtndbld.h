@@ -0,0 +1,47 @@
+/* * * * * * * * *
+ * Disk-backed hash table using extendible hashing with multiple keys per
+ * bucket, storing each bucket as a fixed-size page in a file and keeping only
+ * the directory (and a buffer pool of recently used pages) in memory
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef XTNDBLD_H
+#define XTNDBLD_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "../tablestats.h"
+
+typedef struct xtndbld_table XtndblDHashTable;
+
+// initialise a disk-backed extendible hash table, caching up to 'npages' of its
+// pages in memory at once
+XtndblDHashTable *new_xtndbld_hash_table(int npages);
+
+// free all memory associated with 'table' (and remove its file)
+void free_xtndbld_hash_table(XtndblDHashTable *table);
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool xtndbld_hash_table_insert(XtndblDHashTable *table, int64 key);
+
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool xtndbld_hash_table_lookup(XtndblDHashTable *table, int64 key);
+
+// print the contents of 'table' to stdout
+void xtndbld_hash_table_print(XtndblDHashTable *table);
+
+// print some statistics about 'table' to stdout
+void xtndbld_hash_table_stats(XtndblDHashTable *table);
+
+// fill in 'stats' with statistics about 'table'
+void xtndbld_hash_table_get_stats(XtndblDHashTable *table, TableStats *stats);
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xtndbld_hash_table_trace(XtndblDHashTable *table, int track);
+
+#endif
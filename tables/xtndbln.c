@@ -8,82 +8,161 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xtndbln.h"
+#include "../latency.h"
+#include "../memusage.h"
+#include "../histogram.h"
+#include "../trace.h"
+#include "keysearch.h"
+#include "directory.h"
 
-// macro to calculate the rightmost n bits of a number x
-#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
+// the deepest a bucket may get: a full bucket using this many hash value bits
+// is not split any further, and instead chains extra keys onto overflow pages.
+// the default is as deep as the directory can grow (compile with
+// -DMAX_LOCAL_DEPTH=d to change this)
+#ifndef MAX_LOCAL_DEPTH
+#define MAX_LOCAL_DEPTH 26
+#endif
 
-// a bucket stores an array of keys
+// how deep a bucket may get relative to the number of buckets: a full bucket
+// that is as deep as the directory only doubles it if the directory is left
+// with at most 2^MAX_EXCESS_DEPTH entries for each bucket, and otherwise
+// chains onto overflow pages. keys sharing their lowest hash value bits (by
+// accident, or on purpose) fill one bucket without adding more, so they get an
+// overflow page each bucketsize keys, instead of doubling the directory again
+// and again; evenly spread keys keep the directory well under this limit
+// (compile with -DMAX_EXCESS_DEPTH=d to change it)
+#ifndef MAX_EXCESS_DEPTH
+#define MAX_EXCESS_DEPTH 6
+#endif
+
+// marks the end of a chain of overflow pages
+#define NO_OVERFLOW ((BucketIndex)-1)
+
+// a bucket stores an array of keys (kept alongside the bucket, in the table's
+// pool of keys, at the same index as the bucket)
 // it also knows how many bits are shared between possible keys, and the first 
 // table address that references it
+// an overflow page is a bucket that no table address references, holding more
+// keys for the bucket that chains to it
 typedef struct xtndbln_bucket {
 	int id;			// a unique id for this bucket, equal to the first address
-					// in the table which points to it
+					// in the table which points to it (-1 for overflow pages)
 	int depth;		// how many hash value bits are being used by this bucket
 	int nkeys;		// number of keys currently contained in this bucket
-	int64 *keys;	// the keys stored in this bucket
+	BucketIndex overflow;	// the next overflow page in this bucket's chain
 } Bucket;
 
 // helper structure to store statistics gathered
 typedef struct stats {
     double nbuckets;        // how many distinct buckets does the table point to
+    int noverflow;          // how many overflow pages are chained to buckets
     double nkeys;           // how many keys are being stored in the table
-    int time;               // how much CPU time has been used to insert/lookup
-                            // keys in this table
+    Latency latency;        // how long inserts/lookups have taken
+    MemoryUsage memory;     // how many bytes the table has allocated
+    Trace trace;            // when buckets have split, and how long it took
 } Stats;
 
-// a hash table is an array of slots pointing to buckets holding up to 
-// bucketsize keys, along with some information about the number of hash value 
-// bits to use for addressing
+// a hash table is a directory of slots holding the indices of buckets (in a
+// pool) holding up to bucketsize keys
 struct xtndbln_table {
-	Bucket **buckets;	// array of pointers to buckets
-	int size;			// how many entries in the table of pointers (2^depth)
-	int depth;			// how many bits of the hash value to use (log2(size))
-	int bucketsize;		// maximum number of keys per bucket
+	Directory directory;	// table of indices of buckets in the pool
+	Bucket *pool;			// array of all buckets, in order of creation
+	int64 *keys;			// keystride keys for each bucket in the pool
+	int npool;				// how many buckets are in the pool
+	int poolsize;			// how many buckets the pool has space for
+	int bucketsize;			// maximum number of keys per bucket
+	int keystride;			// space for keys per bucket (bucketsize, padded to
+							// a whole number of vectors for keysearch)
+	BucketIndex freepages;	// overflow pages no longer in any chain, linked
+							// through their 'overflow' fields, for reuse
     Stats stats;
 };
 
+// macro to get a pointer to the keys of the bucket at index 'index' in the pool
+// (only valid until the next new bucket is added, since the pool may move)
+#define bucketkeys(table, index) (&(table)->keys[(size_t)(index) * \
+                                                 (table)->keystride])
+
 /* * * *
  * helper functions
  */
 
-// create a new bucket first referenced from 'first_address', based on 'depth'
-// bits of its keys' hash values
+// add a new bucket to the pool, first referenced from 'first_address', based
+// on 'depth' bits of its keys' hash values, and return its index
 // function modified from provided function in xtndbl1.c
-static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
-    Bucket *bucket = malloc(sizeof *bucket);
-    assert(bucket);
+static BucketIndex new_bucket(XtndblNHashTable *table, int first_address,
+                              int depth) {
+    
+    // make more space in the pools if they are full (doubling, so that adding
+    // buckets costs constant time on average)
+    if (table->npool == table->poolsize) {
+        size_t oldbuckets = (sizeof *table->pool) * table->poolsize;
+        size_t oldkeys = (sizeof *table->keys) * table->poolsize *
+            table->keystride;
+        table->poolsize *= 2;
+        table->pool = memory_realloc(&table->stats.memory, MEMORY_BUCKETS,
+                                     table->pool, oldbuckets, oldbuckets * 2);
+        assert(table->pool);
+        table->keys = memory_realloc(&table->stats.memory, MEMORY_KEYS,
+                                     table->keys, oldkeys, oldkeys * 2);
+        assert(table->keys);
+    }
     
+    BucketIndex index = table->npool++;
+    Bucket *bucket = &table->pool[index];
     bucket->id = first_address;
     bucket->depth = depth;
     bucket->nkeys = 0;
+    bucket->overflow = NO_OVERFLOW;
     
-    bucket->keys = malloc((sizeof bucket->keys) * bucketsize);
-    
-    return bucket;
+    return index;
 }
 
-// double the table of bucket pointers, duplicating the bucket pointers in the
-// first half into the new second half of the table
-// function modified from provided function in xtndbl1.c
-static void double_table(XtndblNHashTable *table) {
-    int size = table->size * 2;
-    assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
-    
-    // get a new array of twice as many bucket pointers, and copy pointers down
-    table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size);
-    assert(table->buckets);
-    int i;
-    for (i = 0; i < table->size; i++) {
-        table->buckets[table->size + i] = table->buckets[i];
+// an empty overflow page for a bucket of depth 'depth': a free page if there
+// is one, or else a new one
+static BucketIndex new_page(XtndblNHashTable *table, int depth) {
+    BucketIndex page = table->freepages;
+    if (page == NO_OVERFLOW) {
+        page = new_bucket(table, -1, depth);
+    } else {
+        table->freepages = table->pool[page].overflow;
+        table->pool[page].depth = depth;
+        table->pool[page].overflow = NO_OVERFLOW;
     }
-    
-    // finally, increase the table size and the depth we are using to hash keys
-    table->size = size;
-    table->depth++;
+    table->stats.noverflow++;
+    return page;
+}
+
+// add 'key' to the bucket at index 'index' of the pool, or if it is full, to
+// the first page in its chain of overflow pages with space (adding a new page
+// to the end of the chain if they are all full)
+static void append_key(XtndblNHashTable *table, BucketIndex index, int64 key) {
+    while (table->pool[index].nkeys == table->bucketsize) {
+        if (table->pool[index].overflow == NO_OVERFLOW) {
+            BucketIndex page = new_page(table, table->pool[index].depth);
+            table->pool[index].overflow = page;
+        }
+        index = table->pool[index].overflow;
+    }
+    bucketkeys(table, index)[table->pool[index].nkeys] = key;
+    table->pool[index].nkeys++;
+}
+
+// checks if key is in the bucket at index 'index' of the pool, or in its chain
+// of overflow pages; returns true if it is, false if it is not
+static bool find_key(XtndblNHashTable *table, BucketIndex index, int64 key) {
+    for (; index != NO_OVERFLOW; index = table->pool[index].overflow) {
+        // compare several of the page's keys at once
+        if (keysearch(bucketkeys(table, index), table->pool[index].nkeys,
+                      key)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 // reinsert a key into the hash table after splitting a bucket --- we can assume
@@ -92,73 +171,144 @@ static void double_table(XtndblNHashTable *table) {
 // use 'xtndblN_hash_table_insert()' instead for inserting new keys
 // function modified from provided function in xtndbl1.c
 static void reinsert_key(XtndblNHashTable *table, int64 key) {
-    int address = rightmostnbits(table->depth, h1(key));
-    table->buckets[address]->keys[table->buckets[address]->nkeys] = key;
-    table->buckets[address]->nkeys++;
+    BucketIndex index = directory_lookup(&table->directory, h1(key));
+    bucketkeys(table, index)[table->pool[index].nkeys] = key;
+    table->pool[index].nkeys++;
 }
 
-// split the bucket in 'table' at address 'address', growing table if necessary
-// function modified from provided function in xtndbl1.c
-static void split_bucket(XtndblNHashTable *table, int address) {
+// whether the full bucket at index 'index' of the pool may be split: only if it
+// is shallower than MAX_LOCAL_DEPTH, and if splitting it would double the
+// directory, only if that leaves no more than 2^MAX_EXCESS_DEPTH directory
+// entries for each bucket
+static bool can_split(XtndblNHashTable *table, BucketIndex index) {
+    int depth = table->pool[index].depth;
+    if (depth >= MAX_LOCAL_DEPTH) {
+        return false;
+    }
+    if (depth < table->directory.depth) {
+        return true;
+    }
+    return 2.0 * table->directory.size <=
+        table->stats.nbuckets * (1 << MAX_EXCESS_DEPTH);
+}
+
+// filter the keys of the bucket at index 'index' of the pool and of its chain
+// of overflow pages into their rightful buckets (after the bucket has been
+// split), and return how many there were. the keys are copied out of the way
+// first, and the pages put on the table's list of free pages, so that both
+// halves of the split bucket can chain onto them again if they need to
+static int refilter_chain(XtndblNHashTable *table, BucketIndex index) {
+    int nkeys = 0;
+    BucketIndex page;
+    for (page = index; page != NO_OVERFLOW; page = table->pool[page].overflow) {
+        nkeys += table->pool[page].nkeys;
+    }
+    size_t size = (sizeof (int64)) * nkeys;
+    int64 *keys = memory_malloc(&table->stats.memory, MEMORY_SCRATCH, size);
+    assert(keys);
+    
+    // empty the bucket and each page, freeing the pages
+    int n = 0;
+    page = index;
+    while (page != NO_OVERFLOW) {
+        Bucket *bucket = &table->pool[page];
+        memcpy(&keys[n], bucketkeys(table, page),
+               (sizeof *keys) * bucket->nkeys);
+        n += bucket->nkeys;
+        bucket->nkeys = 0;
+        BucketIndex next = bucket->overflow;
+        if (page == index) {
+            bucket->overflow = NO_OVERFLOW;
+        } else {
+            bucket->overflow = table->freepages;
+            table->freepages = page;
+            table->stats.noverflow--;
+        }
+        page = next;
+    }
     
-    // FIRST,
-    // do we need to grow the table?
-    if (table->buckets[address]->depth == table->depth) {
-        // yep, this bucket is down to its last pointer
-        double_table(table);
+    // then put every key back where it now belongs
+    int i;
+    for (i = 0; i < nkeys; i++) {
+        append_key(table, directory_lookup(&table->directory, h1(keys[i])),
+                   keys[i]);
     }
-    // either way, now it's time to split this bucket
     
+    memory_free(&table->stats.memory, MEMORY_SCRATCH, keys, size);
+    return nkeys;
+}
+
+// split the bucket in 'table' at index 'index' of the pool, growing the
+// directory if necessary
+// function modified from provided function in xtndbl1.c
+static void split_bucket(XtndblNHashTable *table, BucketIndex index) {
+    TRACE_START(start);
+    int oldsize = table->directory.size;
     
-    // SECOND,
+    // FIRST,
     // create a new bucket and update both buckets' depth
-    Bucket *bucket = table->buckets[address];
-    int depth = bucket->depth;
-    int first_address = bucket->id;
+    // (hold on to the old bucket by index: adding a bucket may move the pool)
+    int depth = table->pool[index].depth;
+    int first_address = table->pool[index].id;
     
     int new_depth = depth + 1;
-    bucket->depth = new_depth;
+    table->pool[index].depth = new_depth;
     
     // new bucket's first address will be a 1 bit plus the old first address
     int new_first_address = 1 << depth | first_address;
-    Bucket *newbucket = new_bucket(new_first_address, new_depth,
-                                   table->bucketsize);
+    BucketIndex newindex = new_bucket(table, new_first_address, new_depth);
     table->stats.nbuckets++;
     
-    // THIRD,
-    // redirect every second address pointing to this bucket to the new bucket
-    // construct addresses by joining a bit 'prefix' and a bit 'suffix'
-    // (defined below)
-    
-    // suffix: a 1 bit followed by the previous bucket bit address
-    int bit_address = rightmostnbits(depth, first_address);
-    int suffix = (1 << depth) | bit_address;
-    
-    // prefix: all bitstrings of length equal to the difference between the new
-    // bucket depth and the table depth
-    // use a for loop to enumerate all possible prefixes less than maxprefix:
-    int maxprefix = 1 << (table->depth - new_depth);
-    
-    int prefix;
-    for (prefix = 0; prefix < maxprefix; prefix++) {
-        
-        // construct address by joining this prefix and the suffix
-        int a = (prefix << new_depth) | suffix;
-        
-        // redirect this table entry to point at the new bucket
-        table->buckets[a] = newbucket;
-    }
+    // SECOND,
+    // redirect every second directory entry pointing to this bucket to the new
+    // bucket (the directory grows first if this bucket is down to its last
+    // entry)
+    directory_split(&table->directory, first_address, depth, newindex);
     
     // FINALLY,
     // filter the keys from the old bucket into their rightful places in the
     // new table (which may be the old bucket, or may be the new bucket)
     
     // remove and reinsert the keys
+    // (a key is never reinserted at a later position of its own bucket than
+    // the one it is read from, so the keys can be filtered in place)
     int i;
-    int nkeys = bucket->nkeys;
-    bucket->nkeys = 0;
-    for (i = 0; i < nkeys; i++) {
-        reinsert_key(table, bucket->keys[i]);
+    int nkeys = table->pool[index].nkeys;
+    if (table->pool[index].overflow == NO_OVERFLOW) {
+        table->pool[index].nkeys = 0;
+        for (i = 0; i < nkeys; i++) {
+            reinsert_key(table, bucketkeys(table, index)[i]);
+        }
+    } else {
+        nkeys = refilter_chain(table, index);
+    }
+    
+    // trace the split (and the doubling of the directory, if it had to)
+    TRACE_STOP(&table->stats.trace, TRACE_SPLIT, start, nkeys,
+        (long)table->stats.nbuckets - 1, (long)table->stats.nbuckets);
+    if (table->directory.size != oldsize) {
+        TRACE_STOP(&table->stats.trace, TRACE_DOUBLE, start, 0, oldsize,
+            table->directory.size);
+    }
+}
+
+// count how many keys each bucket (with its chain of overflow pages) holds in
+// 'occupancy'
+static void count_occupancy(XtndblNHashTable *table, Histogram *occupancy) {
+    initialise_histogram(occupancy);
+    BucketIndex i;
+    for (i = 0; i < table->npool; i++) {
+        // overflow pages are counted along with the bucket they belong to
+        if (table->pool[i].id == -1) {
+            continue;
+        }
+        long nkeys = 0;
+        BucketIndex index;
+        for (index = i; index != NO_OVERFLOW;
+             index = table->pool[index].overflow) {
+            nkeys += table->pool[index].nkeys;
+        }
+        histogram_add(occupancy, nkeys);
     }
 }
 
@@ -171,17 +321,34 @@ static void split_bucket(XtndblNHashTable *table, int address) {
 XtndblNHashTable *new_xtndbln_hash_table(int bucketsize) {
     XtndblNHashTable *table = malloc(sizeof *table);
     assert(table);
+    initialise_memory_usage(&table->stats.memory);
+    // the latencies and trace are instrumentation, not the table
+    long instrumentation = sizeof table->stats.latency +
+        sizeof table->stats.trace;
+    memory_count(&table->stats.memory, MEMORY_TABLE,
+        sizeof *table - instrumentation);
+    memory_count(&table->stats.memory, MEMORY_INSTRUMENTATION, instrumentation);
     
-    table->size = 1;
     table->bucketsize = bucketsize;
-    table->buckets = malloc(sizeof *table->buckets);
-    assert(table->buckets);
-    table->buckets[0] = new_bucket(0, 0, bucketsize);
-    table->depth = 0;
-    
+    table->npool = 0;
+    table->poolsize = 1;
+    table->pool = memory_malloc(&table->stats.memory, MEMORY_BUCKETS,
+                                sizeof *table->pool);
+    assert(table->pool);
+    table->keystride = keysearch_padded(bucketsize);
+    table->keys = memory_malloc(&table->stats.memory, MEMORY_KEYS,
+                                (sizeof *table->keys) * table->keystride);
+    assert(table->keys);
+    
+    initialise_directory(&table->directory, new_bucket(table, 0, 0),
+                         &table->stats.memory);
+    
+    table->freepages = NO_OVERFLOW;
     table->stats.nbuckets = 1.0;
+    table->stats.noverflow = 0;
     table->stats.nkeys = 0.0;
-    table->stats.time = 0;
+    initialise_trace(&table->stats.trace);
+    initialise_latency(&table->stats.latency);
     
     return table;
 }
@@ -192,19 +359,12 @@ XtndblNHashTable *new_xtndbln_hash_table(int bucketsize) {
 void free_xtndbln_hash_table(XtndblNHashTable *table) {
     assert(table);
     
-    // loop backwards through the array of pointers, freeing buckets only as we
-    // reach their first reference
-    // (if we loop through forwards, we wouldn't know which reference was last)
-    int i;
-    for (i = table->size-1; i >= 0; i--) {
-        if (table->buckets[i]->id == i) {
-            free(table->buckets[i]->keys);
-            free(table->buckets[i]);
-        }
-    }
-    
-    // free the array of bucket pointers
-    free(table->buckets);
+    // free the pools of buckets and keys (all at once) and the directory
+    memory_free(&table->stats.memory, MEMORY_BUCKETS, table->pool,
+                (sizeof *table->pool) * table->poolsize);
+    memory_free(&table->stats.memory, MEMORY_KEYS, table->keys,
+                (sizeof *table->keys) * table->poolsize * table->keystride);
+    free_directory(&table->directory);
     
     // free the table struct itself
     free(table);
@@ -216,38 +376,36 @@ void free_xtndbln_hash_table(XtndblNHashTable *table) {
 // function modified from provided function in xtndbl1.c
 bool xtndbln_hash_table_insert(XtndblNHashTable *table, int64 key) {
     assert(table);
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
     
-    // calculate table address
+    // find the bucket for this key
     int hash = h1(key);
-    int address = rightmostnbits(table->depth, hash);
+    BucketIndex index = directory_lookup(&table->directory, hash);
     
     // is this key already there?
-    if (table->buckets[address]->nkeys) {
-        int i;
-        for (i = 0; i < table->bucketsize; i++) {
-            if (table->buckets[address]->keys[i] == key) {
-                table->stats.time += clock() - start_time; // add time elapsed
-                return false;
-            }
-        }
+    if (find_key(table, index, key)) {
+        // add time elapsed
+        LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
+        return false;
     }
     
-    // if not, make space in the table until our target bucket has space
-    while (table->buckets[address]->nkeys == table->bucketsize) {
-        split_bucket(table, address);
+    // if not, make space in the table until our target bucket has space (or
+    // is too deep to split)
+    while (table->pool[index].nkeys == table->bucketsize &&
+           can_split(table, index)) {
+        split_bucket(table, index);
         
-        // and recalculate address because we might now need more bits
-        address = rightmostnbits(table->depth, hash);
+        // and find the bucket again because we might now need more bits
+        index = directory_lookup(&table->directory, hash);
     }
     
-    // there's now space! we can insert this key
-    table->buckets[address]->keys[table->buckets[address]->nkeys] = key;
-    table->buckets[address]->nkeys++;
+    // there's now space! we can insert this key (a full bucket that can't be
+    // split keeps it in its chain of overflow pages instead)
+    append_key(table, index, key);
     table->stats.nkeys++;
     
-    // add time elapsed to total CPU time before returning
-    table->stats.time += clock() - start_time;
+    // count the time elapsed before returning
+    LATENCY_STOP(&table->stats.latency, LATENCY_INSERT, start_time);
     return true;
 }
 
@@ -257,25 +415,16 @@ bool xtndbln_hash_table_insert(XtndblNHashTable *table, int64 key) {
 // function modified from provided function in xtndbl1.c
 bool xtndbln_hash_table_lookup(XtndblNHashTable *table, int64 key) {
     assert(table);
-    int start_time = clock(); // start timing
-    
-    // calculate table address for this key
-    int address = rightmostnbits(table->depth, h1(key));
-    
-    // look for the key in that bucket (unless it's empty)
-    bool found = false;
-    if (table->buckets[address]->nkeys) {
-        int i;
-        for (i = 0; i < table->buckets[address]->nkeys; i++) {
-            if (table->buckets[address]->keys[i] == key) {
-                found = true;
-                break;
-            }
-        }
-    }
+    LATENCY_START(start_time); // start timing
+    
+    // find the bucket for this key
+    BucketIndex index = directory_lookup(&table->directory, h1(key));
     
-    // add time elapsed to total CPU time before returning result
-    table->stats.time += clock() - start_time;
+    // look for the key in that bucket (and its overflow pages, if any)
+    bool found = find_key(table, index, key);
+    
+    // count the time elapsed before returning result
+    LATENCY_STOP(&table->stats.latency, LATENCY_LOOKUP, start_time);
     return found;
 }
 
@@ -283,7 +432,8 @@ bool xtndbln_hash_table_lookup(XtndblNHashTable *table, int64 key) {
 // print the contents of 'table' to stdout
 void xtndbln_hash_table_print(XtndblNHashTable *table) {
 	assert(table);
-	printf("--- table size: %d\n", table->size);
+	int size = 1 << table->directory.depth;
+	printf("--- table size: %d\n", size);
 
 	// print header
 	printf("  table:               buckets:\n");
@@ -291,24 +441,31 @@ void xtndbln_hash_table_print(XtndblNHashTable *table) {
 	
 	// print table and buckets
 	int i;
-	for (i = 0; i < table->size; i++) {
+	for (i = 0; i < size; i++) {
 		// table entry
-		printf("%9d | %-9d ", i, table->buckets[i]->id);
+		BucketIndex index = directory_lookup(&table->directory, i);
+		Bucket *bucket = &table->pool[index];
+		printf("%9d | %-9d ", i, bucket->id);
 
 		// if this is the first address at which a bucket occurs, print it now
-		if (table->buckets[i]->id == i) {
-			printf("%9d ", table->buckets[i]->id);
-
-			// print the bucket's contents
-			printf("[");
-			for(int j = 0; j < table->bucketsize; j++) {
-				if (j < table->buckets[i]->nkeys) {
-					printf(" %llu", table->buckets[i]->keys[j]);
-				} else {
-					printf(" -");
+		if (bucket->id == i) {
+			printf("%9d ", bucket->id);
+
+			// print the bucket's contents, followed by any overflow pages
+			for (; index != NO_OVERFLOW; index = table->pool[index].overflow) {
+				if (table->pool[index].id == -1) {
+					printf(" -> ");
 				}
+				printf("[");
+				for(int j = 0; j < table->bucketsize; j++) {
+					if (j < table->pool[index].nkeys) {
+						printf(" %llu", bucketkeys(table, index)[j]);
+					} else {
+						printf(" -");
+					}
+				}
+				printf(" ]");
 			}
-			printf(" ]");
 		}
 		// end the line
 		printf("\n");
@@ -326,17 +483,60 @@ void xtndbln_hash_table_stats(XtndblNHashTable *table) {
     printf("--- table stats ---\n");
     
     // print some stats about state of the table
-    printf("               current table size: %d\n", table->size);
+    printf("               current table size: %d\n", table->directory.size);
     printf("                   number of keys: %.0f keys\n", table->stats.nkeys);
     printf("                      bucket size: %d keys per bucket\n", table->bucketsize);
     printf("                number of buckets: %.0f buckets\n", table->stats.nbuckets);
+    printf("         number of overflow pages: %d pages\n",
+           table->stats.noverflow);
     printf("average number of keys per bucket: %.3f keys\n",
            table->stats.nkeys / table->stats.nbuckets);
     
-    // also calculate CPU usage in seconds and print this
-    float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-    printf("    CPU time spent: %.6f sec\n", seconds);
+    // also print how long operations have taken, and how much memory the
+    // table is using
+    latency_print(&table->stats.latency, 18);
+    Histogram occupancy;
+    count_occupancy(table, &occupancy);
+    histogram_print(&occupancy, "bucket occupancy", 18);
+    TableStats stats;
+    initialise_table_stats(&stats);
+    xtndbln_hash_table_get_stats(table, &stats);
+    print_table_memory(&stats, 18);
     
     printf("--- end stats ---\n");
 
 }
+
+
+// fill in 'stats' with statistics about 'table'
+void xtndbln_hash_table_get_stats(XtndblNHashTable *table, TableStats *stats) {
+    assert(table);
+    
+    stats->nkeys = table->stats.nkeys;
+    stats->nbuckets = table->stats.nbuckets;
+    stats->bucketsize = table->bucketsize;
+    stats->size = table->directory.size;
+    stats->noverflow = table->stats.noverflow;
+    stats->load_factor = table->stats.nkeys /
+        (table->stats.nbuckets * table->bucketsize);
+    // only the buckets and overflow pages in use can waste space: the rest of
+    // the pool (including free overflow pages, until they're reused) is slack
+    long inuse = (long)table->stats.nbuckets + table->stats.noverflow;
+    stats->wasted = (inuse * table->keystride - stats->nkeys) *
+        sizeof *table->keys;
+    stats->slack = (table->poolsize - inuse) *
+        (sizeof *table->pool + table->keystride * sizeof *table->keys);
+    table_stats_memory(stats, &table->stats.memory);
+    count_occupancy(table, &stats->histograms[HISTOGRAM_OCCUPANCY]);
+    stats->time = latency_summarise(&table->stats.latency, stats->latency);
+    stats->last_resize = trace_last_duration(&table->stats.trace);
+}
+
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xtndbln_hash_table_trace(XtndblNHashTable *table, int track) {
+    assert(table);
+    
+    trace_print_chrome(&table->stats.trace, "xtndbln", track);
+}
@@ -11,6 +11,7 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../tablestats.h"
 
 typedef struct xtndbln_table XtndblNHashTable;
 
@@ -34,4 +35,11 @@ void xtndbln_hash_table_print(XtndblNHashTable *table);
 // print some statistics about 'table' to stdout
 void xtndbln_hash_table_stats(XtndblNHashTable *table);
 
+// fill in 'stats' with statistics about 'table'
+void xtndbln_hash_table_get_stats(XtndblNHashTable *table, TableStats *stats);
+
+// print the split events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xtndbln_hash_table_trace(XtndblNHashTable *table, int track);
+
 #endif
@@ -11,72 +11,76 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xuckoo.h"
-
-// macro to calculate the rightmost n bits of a number x
-#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
-
-// a bucket stores a single key (full=true) or is empty (full=false)
-// it also knows how many bits are shared between possible keys, and the first 
-// table address that references it
-typedef struct bucket {
-	int id;		// a unique id for this bucket, equal to the first address
-				// in the table which points to it
-	int depth;	// how many hash value bits are being used by this bucket
-	bool full;	// does this bucket contain a key
-	int64 key;	// the key stored in this bucket
-} Bucket;
-
-// an inner table is an extendible hash table with an array of slots pointing 
-// to buckets holding up to 1 key, along with some information about the number 
-// of hash value bits to use for addressing
+#include "../latency.h"
+#include "../memusage.h"
+#include "../histogram.h"
+#include "../trace.h"
+#include "inlinedir.h"
+
+// the most keys one insertion may displace before a bucket is split anyway, as
+// a safety net in case a cycle somehow goes undetected
+// (compile with -DMAX_REPLACEMENTS=n to change this)
+#ifndef MAX_REPLACEMENTS
+#define MAX_REPLACEMENTS 1000
+#endif
+
+// how many keys a batch of lookups works on at once: all of their entries are
+// prefetched before any of them are looked at
+// (compile with -DLOOKUP_BATCH=n to change this)
+#ifndef LOOKUP_BATCH
+#define LOOKUP_BATCH 16
+#endif
+
+// an inner table is an extendible hash table with a directory of slots holding
+// buckets of up to 1 key (inline in the slot, if it's the only slot referring
+// to the bucket)
 typedef struct inner_table {
-	Bucket **buckets;	// array of pointers to buckets
-	int size;			// how many entries in the table of pointers (2^depth)
-	int depth;			// how many bits of the hash value to use (log2(size))
-    int nbuckets;       // how many distinct buckets does the table point to
-	int nkeys;			// how many keys are being stored in the table
+	InlineDirectory directory;	// table of buckets
+	int nkeys;					// how many keys are being stored in the table
 } InnerTable;
 
+// a step along an insertion path: a bucket the path displaced a key from
+typedef struct step {
+    InnerTable *table;  // the inner table the bucket is in
+    int hash;           // the hash value (for that table) of the bucket's keys
+} Step;
+
 // a xuckoo hash table is just two inner tables for storing inserted keys
 struct xuckoo_table {
 	InnerTable *table1;
 	InnerTable *table2;
-    int time;           // how much CPU time has been used to insert/lookup keys
+    Step *steps;        // the steps along the current insertion path
+    int stepssize;      // how many steps there is space for
+    long ndisplacements; // how many keys insertions have displaced
+    Latency latency;    // how long inserts/lookups have taken
+    MemoryUsage memory; // how many bytes the table has allocated
+    Histogram evictions; // how many keys each insertion has displaced
+    long ngrowths;      // how many times a path has had to split buckets
+    Trace trace;        // when paths have split buckets, and how long it took
 };
 
+// the path of keys displaced while inserting a single key
+typedef struct path {
+    int64 key;          // the key this path started by inserting
+    InnerTable *table;  // the table that key was inserted into first
+    int replacements;   // how many keys have been displaced along the path
+                        // (this is also how many steps the path has taken)
+    int ndisplaced;     // how many keys the insertion has displaced in all
+                        // (including along paths abandoned to split buckets)
+} Path;
+
 /* * * *
  * helper functions
  */
 
-// create a new bucket first referenced from 'first_address', based on 'depth'
-// bits of its keys' hash values
-// function modified from provided function in xtndbl1.c
-static Bucket *new_bucket(int first_address, int depth) {
-    Bucket *bucket = malloc(sizeof *bucket);
-    assert(bucket);
-    
-    bucket->id = first_address;
-    bucket->depth = depth;
-    bucket->full = false;
-    
-    return bucket;
-}
-
-// set up the internals of a linear hash table struct with new
-// arrays of size 'size'
+// set up the internals of an inner table, whose keys are placed by hash
+// function 'h', counting its memory in 'memory'
 // function modified from provided function in linear.c
-static void initialise_table(InnerTable *table) {
-    
-    table->size = 1;
-    table->buckets = malloc(sizeof *table->buckets);
-    assert(table->buckets);
-    table->buckets[0] = new_bucket(0, 0);
-    table->depth = 0;
-    
-    table->nbuckets = 1;
+static void initialise_table(InnerTable *table, int (*h)(int64),
+                             MemoryUsage *memory) {
+    initialise_inline_directory(&table->directory, h, memory);
     table->nkeys = 0;
 }
 
@@ -84,145 +88,126 @@ static void initialise_table(InnerTable *table) {
 // function modified from provided functions in linear.c/xtndbl1.c
 static void free_inner_table(InnerTable *table) {
     assert(table);
+    MemoryUsage *memory = table->directory.memory;
     
-    // loop backwards through the array of pointers, freeing buckets only as we
-    // reach their first reference
-    // (if we loop through forwards, we wouldn't know which reference was last)
-    int i;
-    for (i = table->size-1; i >= 0; i--) {
-        if (table->buckets[i]->id == i) {
-            free(table->buckets[i]);
-        }
-    }
-    
-    // free the array of bucket pointers
-    free(table->buckets);
+    // free the directory (and its pool of shared buckets)
+    free_inline_directory(&table->directory);
     
     // free the inner table struct itself
-    free(table);
+    memory_free(memory, MEMORY_TABLE, table, sizeof *table);
 }
 
-// double the table of bucket pointers, duplicating the bucket pointers in the
-// first half into the new second half of the table
-// function modified from provided function in xtndbl1.c
-static void double_table(InnerTable *table) {
-    int size = table->size * 2;
-    assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
-    
-    // get a new array of twice as many bucket pointers, and copy pointers down
-    table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size);
-    assert(table->buckets);
-    int i;
-    for (i = 0; i < table->size; i++) {
-        table->buckets[table->size + i] = table->buckets[i];
+// remember that 'path' is displacing a key from the bucket for hash value
+// 'hash' in 'inner', as its next step
+static void record_step(XuckooHashTable *table, Path *path, InnerTable *inner,
+                        int hash) {
+    if (path->replacements == table->stepssize) {
+        size_t oldsize = (sizeof *table->steps) * table->stepssize;
+        table->stepssize *= 2;
+        table->steps = memory_realloc(&table->memory, MEMORY_SCRATCH,
+                                      table->steps, oldsize, oldsize * 2);
+        assert(table->steps);
     }
-    
-    // finally, increase the table size and the depth we are using to hash keys
-    table->size = size;
-    table->depth++;
+    table->steps[path->replacements].table = inner;
+    table->steps[path->replacements].hash = hash;
 }
 
-// reinsert a key into the hash table after splitting a bucket --- we can assume
-// that there will definitely be space for this key because it was already
-// inside the hash table previously
-// use 'xtndbl1_hash_table_insert()' instead for inserting new keys
-// function modified from provided function in xtndbl1.c
-static void reinsert_key(InnerTable *table, int64 key, int (*h)(int64)) {
-    int address = rightmostnbits(table->depth, h(key));
-    table->buckets[address]->key = key;
-    table->buckets[address]->full = true;
+// split every (full) bucket of 'inner' along 'path' that can split without
+// doubling the directory of 'inner', and return how many were split
+static int split_path_buckets_in(XuckooHashTable *table, Path *path,
+                                 InnerTable *inner) {
+    int i, nsplit = 0;
+    for (i = 0; i < path->replacements; i++) {
+        Step *step = &table->steps[i];
+        if (step->table == inner &&
+            inline_directory_bucket(&inner->directory, step->hash).full &&
+            !inline_directory_split_grows(&inner->directory, step->hash)) {
+            inline_directory_split(&inner->directory, step->hash);
+            nsplit++;
+        }
+    }
+    return nsplit;
 }
 
-// split the bucket in 'table' at address 'address', growing table if necessary
-// function modified from provided function in xtndbl1.c
-static void split_bucket(InnerTable *table, int address, int (*h)(int64)) {
+// split buckets along 'path' to make space for its keys: the buckets that can
+// split without doubling a directory, from the less-loaded inner table if it
+// has any, or else from the other. if every bucket on the path would double its
+// directory, split just the bucket for hash value 'hash' in 'inner' (where the
+// path is now)
+static void split_path_buckets(XuckooHashTable *table, Path *path,
+                               InnerTable *inner, int hash) {
+    InnerTable *table1 = table->table1;
+    InnerTable *table2 = table->table2;
     
-    // FIRST,
-    // do we need to grow the table?
-    if (table->buckets[address]->depth == table->depth) {
-        // yep, this bucket is down to its last pointer
-        double_table(table);
+    // try the less-loaded table first
+    InnerTable *tables[2] = {table1, table2};
+    if (table1->nkeys * 1.0 / table1->directory.nbuckets >
+        table2->nkeys * 1.0 / table2->directory.nbuckets) {
+        tables[0] = table2;
+        tables[1] = table1;
     }
-    // either way, now it's time to split this bucket
-    
-    
-    // SECOND,
-    // create a new bucket and update both buckets' depth
-    Bucket *bucket = table->buckets[address];
-    int depth = bucket->depth;
-    int first_address = bucket->id;
-    
-    int new_depth = depth + 1;
-    bucket->depth = new_depth;
-    
-    // new bucket's first address will be a 1 bit plus the old first address
-    int new_first_address = 1 << depth | first_address;
-    Bucket *newbucket = new_bucket(new_first_address, new_depth);
-    table->nbuckets++;
-    
-    // THIRD,
-    // redirect every second address pointing to this bucket to the new bucket
-    // construct addresses by joining a bit 'prefix' and a bit 'suffix'
-    // (defined below)
-    
-    // suffix: a 1 bit followed by the previous bucket bit address
-    int bit_address = rightmostnbits(depth, first_address);
-    int suffix = (1 << depth) | bit_address;
-    
-    // prefix: all bitstrings of length equal to the difference between the new
-    // bucket depth and the table depth
-    // use a for loop to enumerate all possible prefixes less than maxprefix:
-    int maxprefix = 1 << (table->depth - new_depth);
-    
-    int prefix;
-    for (prefix = 0; prefix < maxprefix; prefix++) {
-        
-        // construct address by joining this prefix and the suffix
-        int a = (prefix << new_depth) | suffix;
-        
-        // redirect this table entry to point at the new bucket
-        table->buckets[a] = newbucket;
+    int t;
+    for (t = 0; t < 2; t++) {
+        if (split_path_buckets_in(table, path, tables[t]) > 0) {
+            return;
+        }
     }
     
-    // FINALLY,
-    // filter the key from the old bucket into its rightful place in the new
-    // table (which may be the old bucket, or may be the new bucket)
-    
-    // remove and reinsert the key
-    int64 key = bucket->key;
-    bucket->full = false;
-    reinsert_key(table, key, h);
+    inline_directory_split(&inner->directory, hash);
 }
 
 // insert a key into the xuckoo hash table
 // function modified from provided function in xtndbl1.c
 static bool insert_key(int64 key, XuckooHashTable *table, InnerTable *tableA,
                        InnerTable *tableB, int (*hA)(int64),
-                       int (*hB)(int64), int *replacements) {
-    int address = rightmostnbits(tableA->depth, hA(key));
+                       int (*hB)(int64), Path *path) {
+    int hash = hA(key);
     int64 prekey;
     
-    if (!tableA->buckets[address]->full) {
-        // address not in use, so insert key
-        tableA->buckets[address]->key = key;
-        tableA->buckets[address]->full = true;
+    if (inline_directory_add(&tableA->directory, hash, key)) {
+        // address not in use, so key inserted
         tableA->nkeys++;
         return true;
     }
     
-    // address in use, so pop the preexisting key
-    prekey = tableA->buckets[address]->key;
-    // and insert the new key
-    tableA->buckets[address]->key = key;
-    
-    // split bucket if number of replacements is too high (there is a 'cycle')
-    if ((*replacements >= 1000)) {
-        split_bucket(tableA, address, hA);
+    // if the path has brought the key it started with back to the same table,
+    // it has gone around a cycle, back along itself, around a second cycle and
+    // back again, moving every key it passed back to where it started: these
+    // keys can never all fit, and the path would just repeat itself forever.
+    // so make space by splitting buckets along the path straight away, and
+    // start a new path from here (also do this if the path grows too long)
+    if ((key == path->key && tableA == path->table && path->replacements > 0)
+        || path->replacements >= MAX_REPLACEMENTS) {
+        TRACE_START(start);
+        int oldnbuckets = table->table1->directory.nbuckets +
+                          table->table2->directory.nbuckets;
+        int oldsize = tableA->directory.size;
+        table->ngrowths++;
+        split_path_buckets(table, path, tableA, hash);
+        
+        // trace the recovery (and the doubling of a directory, if it had to)
+        TRACE_STOP(&table->trace, TRACE_CYCLE, start, path->replacements,
+                   oldnbuckets, table->table1->directory.nbuckets +
+                                table->table2->directory.nbuckets);
+        if (tableA->directory.size != oldsize) {
+            TRACE_STOP(&table->trace, TRACE_DOUBLE, start, 0, oldsize,
+                       tableA->directory.size);
+        }
+        path->key = key;
+        path->table = tableA;
+        path->replacements = 0;
+        return insert_key(key, table, tableA, tableB, hA, hB, path);
     }
     
-    (*replacements)++;
+    // address in use, so pop the preexisting key and insert the new key
+    record_step(table, path, tableA, hash);
+    prekey = inline_directory_swap(&tableA->directory, hash, key);
+    
+    path->replacements++;
+    path->ndisplaced++;
+    table->ndisplacements++;
     // insert preexisting key using recursive call
-    return insert_key(prekey, table, tableB, tableA, hB, hA, replacements);
+    return insert_key(prekey, table, tableB, tableA, hB, hA, path);
 }
 
 
@@ -235,15 +220,35 @@ static bool insert_key(int64 key, XuckooHashTable *table, InnerTable *tableA,
 XuckooHashTable *new_xuckoo_hash_table() {
     XuckooHashTable *table = malloc(sizeof *table);
     assert(table);
-    
-    table->table1 = malloc(sizeof *table->table1);
-    table->table2 = malloc(sizeof *table->table2);
+    initialise_memory_usage(&table->memory);
+    // the latencies, evictions and trace are instrumentation, not the table
+    long instrumentation = sizeof table->latency + sizeof table->evictions +
+        sizeof table->trace;
+    memory_count(&table->memory, MEMORY_TABLE,
+        sizeof *table - instrumentation);
+    memory_count(&table->memory, MEMORY_INSTRUMENTATION, instrumentation);
+    
+    table->table1 = memory_malloc(&table->memory, MEMORY_TABLE,
+                                  sizeof *table->table1);
+    assert(table->table1);
+    table->table2 = memory_malloc(&table->memory, MEMORY_TABLE,
+                                  sizeof *table->table2);
+    assert(table->table2);
     
     // set up the internals of the table struct with arrays of size 'size'
-    initialise_table(table->table1);
-    initialise_table(table->table2);
+    initialise_table(table->table1, h1, &table->memory);
+    initialise_table(table->table2, h2, &table->memory);
     
-    table->time = 0;
+    table->stepssize = 1;
+    table->steps = memory_malloc(&table->memory, MEMORY_SCRATCH,
+                                 sizeof *table->steps);
+    assert(table->steps);
+    
+    table->ndisplacements = 0;
+    initialise_histogram(&table->evictions);
+    table->ngrowths = 0;
+    initialise_trace(&table->trace);
+    initialise_latency(&table->latency);
     
     return table;
 }
@@ -255,6 +260,8 @@ void free_xuckoo_hash_table(XuckooHashTable *table) {
     
     free_inner_table(table->table1);
     free_inner_table(table->table2);
+    memory_free(&table->memory, MEMORY_SCRATCH, table->steps,
+                (sizeof *table->steps) * table->stepssize);
     
     // free the table struct itself
     free(table);
@@ -267,21 +274,16 @@ void free_xuckoo_hash_table(XuckooHashTable *table) {
 bool xuckoo_hash_table_insert(XuckooHashTable *table, int64 key) {
     assert(table);
     
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
     
     InnerTable *table1 = table->table1;
     InnerTable *table2 = table->table2;
     
-    // calculate the addresses for the key
-    int addressA = rightmostnbits(table1->depth, h1(key));
-    int addressB = rightmostnbits(table2->depth, h2(key));
-    
     // is this key already there?
-    if ((table1->buckets[addressA]->full &&
-         table1->buckets[addressA]->key == key) ||
-        (table2->buckets[addressB]->full &&
-         table2->buckets[addressB]->key == key)) {
-        table->time += clock() - start_time; // add time elapsed
+    if (inline_directory_find_either(&table1->directory, h1(key),
+                                     &table2->directory, h2(key), key)) {
+        // add time elapsed
+        LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
         // the key is in table - no need to insert
         return false;
     }
@@ -303,13 +305,14 @@ bool xuckoo_hash_table_insert(XuckooHashTable *table, int64 key) {
         hB = h1;
     }
     
-    int replacements = 0;
+    Path path = {key, tableA, 0, 0};
     
     // key is not in table - so insert it
     // (attempt to insert into tableA, the table with fewer keys, first)
-    bool inserted = insert_key(key, table, tableA, tableB, hA, hB,
-                               &replacements);
-    table->time += clock() - start_time; // add time elapsed
+    bool inserted = insert_key(key, table, tableA, tableB, hA, hB, &path);
+    histogram_add(&table->evictions, path.ndisplaced);
+    // add time elapsed
+    LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
     
     return inserted;
 }
@@ -320,30 +323,58 @@ bool xuckoo_hash_table_insert(XuckooHashTable *table, int64 key) {
 // function modified from provided function in xtndbl1.c
 bool xuckoo_hash_table_lookup(XuckooHashTable *table, int64 key) {
     assert(table);
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
     
     InnerTable *table1 = table->table1;
     InnerTable *table2 = table->table2;
     
-    // calculate the addresses for the key
-    int addressA = rightmostnbits(table1->depth, h1(key));
-    int addressB = rightmostnbits(table2->depth, h2(key));
-    
-    // look for the key in that bucket (unless it's empty)
-    bool found = false;
-    if ((table1->buckets[addressA]->full &&
-         table1->buckets[addressA]->key == key) ||
-        (table2->buckets[addressB]->full &&
-         table2->buckets[addressB]->key == key)) {
-        found = true;
-    }
+    // look for the key in its bucket in each table (at the same time)
+    bool found = inline_directory_find_either(&table1->directory, h1(key),
+                                              &table2->directory, h2(key), key);
     
-    // add time elapsed to total CPU time before returning result
-    table->time += clock() - start_time;
+    // count the time elapsed before returning result
+    LATENCY_STOP(&table->latency, LATENCY_LOOKUP, start_time);
     return found;
 }
 
 
+// lookup whether each of the 'nkeys' keys in 'keys' is inside 'table', setting
+// the corresponding element of 'found' to true if it is, false if not
+void xuckoo_hash_table_lookup_many(XuckooHashTable *table, const int64 *keys,
+                                   int nkeys, bool *found) {
+    assert(table);
+    LATENCY_START(start_time); // start timing
+    
+    InnerTable *table1 = table->table1;
+    InnerTable *table2 = table->table2;
+    
+    int hash1[LOOKUP_BATCH], hash2[LOOKUP_BATCH];
+    int first, i;
+    for (first = 0; first < nkeys; first += LOOKUP_BATCH) {
+        int n = nkeys - first < LOOKUP_BATCH ? nkeys - first : LOOKUP_BATCH;
+        
+        // start fetching every entry in the batch, so that their cache misses
+        // all overlap...
+        for (i = 0; i < n; i++) {
+            hash1[i] = h1(keys[first + i]);
+            hash2[i] = h2(keys[first + i]);
+            inline_directory_prefetch(&table1->directory, hash1[i]);
+            inline_directory_prefetch(&table2->directory, hash2[i]);
+        }
+        
+        // ...then look for each key, by which time its entries have arrived
+        for (i = 0; i < n; i++) {
+            found[first + i] = inline_directory_find_either(
+                &table1->directory, hash1[i], &table2->directory, hash2[i],
+                keys[first + i]);
+        }
+    }
+    
+    // count the time elapsed (shared equally between the keys)
+    LATENCY_STOP_MANY(&table->latency, LATENCY_LOOKUP, start_time, nkeys);
+}
+
+
 // print the contents of 'table' to stdout
 void xuckoo_hash_table_print(XuckooHashTable *table) {
 	assert(table != NULL);
@@ -362,15 +393,18 @@ void xuckoo_hash_table_print(XuckooHashTable *table) {
 		
 		// print table and buckets
 		int i;
-		for (i = 0; i < innertables[t]->size; i++) {
+		int size = 1 << innertables[t]->directory.depth;
+		for (i = 0; i < size; i++) {
 			// table entry
-			printf("%9d | %-9d ", i, innertables[t]->buckets[i]->id);
+			SharedBucket bucket =
+				inline_directory_bucket(&innertables[t]->directory, i);
+			printf("%9d | %-9d ", i, bucket.id);
 
 			// if this is the first address at which a bucket occurs, print it
-			if (innertables[t]->buckets[i]->id == i) {
-				printf("%9d ", innertables[t]->buckets[i]->id);
-				if (innertables[t]->buckets[i]->full) {
-					printf("[%llu]", innertables[t]->buckets[i]->key);
+			if (bucket.id == i) {
+				printf("%9d ", bucket.id);
+				if (bucket.full) {
+					printf("[%llu]", bucket.key);
 				} else {
 					printf("[ ]");
 				}
@@ -395,27 +429,70 @@ void xuckoo_hash_table_stats(XuckooHashTable *table) {
     printf("--- table stats ---\n");
     
     // print some stats about state of the entire table
-    printf("       total table size: %d\n", table1->size + table2->size);
+    printf("       total table size: %d\n", table1->directory.size + table2->directory.size);
     printf("   total number of keys: %d\n", table1->nkeys + table2->nkeys);
     printf("total number of buckets: %d\n",
-           table1->nbuckets + table2->nbuckets);
+           table1->directory.nbuckets + table2->directory.nbuckets);
     
     // information about table 1
     printf("Inner Table 1\n");
-    printf("             table size: %d\n", table1->size);
+    printf("             table size: %d\n", table1->directory.size);
     printf("         number of keys: %d\n", table1->nkeys);
-    printf("      number of buckets: %d\n", table1->nbuckets);
+    printf("      number of buckets: %d\n", table1->directory.nbuckets);
+    printf("         shared buckets: %d\n", table1->directory.nshared);
     
     // information about table 2
     printf("Inner Table 2\n");
-    printf("             table size: %d\n", table2->size);
+    printf("             table size: %d\n", table2->directory.size);
     printf("         number of keys: %d\n", table2->nkeys);
-    printf("      number of buckets: %d\n", table2->nbuckets);
-    
-    // also calculate CPU usage in seconds and print this
-    float seconds = table->time * 1.0 / CLOCKS_PER_SEC;
-    printf("         CPU time spent: %.6f sec\n", seconds);
+    printf("      number of buckets: %d\n", table2->directory.nbuckets);
+    printf("         shared buckets: %d\n", table2->directory.nshared);
+    
+    // also print how long operations have taken, and how much memory the
+    // table is using
+    latency_print(&table->latency, 23);
+    histogram_print(&table->evictions, "eviction chains", 23);
+    printf("%23s: %ld\n", "cycle growths", table->ngrowths);
+    TableStats stats;
+    initialise_table_stats(&stats);
+    xuckoo_hash_table_get_stats(table, &stats);
+    print_table_memory(&stats, 23);
     
     printf("--- end stats ---\n");
 
 }
+
+
+// fill in 'stats' with statistics about 'table'
+void xuckoo_hash_table_get_stats(XuckooHashTable *table, TableStats *stats) {
+    assert(table);
+    
+    InnerTable *innertables[2] = {table->table1, table->table2};
+    stats->bucketsize = 1;
+    int t;
+    for (t = 0; t < 2; t++) {
+        InlineDirectory *directory = &innertables[t]->directory;
+        stats->nkeys += innertables[t]->nkeys;
+        stats->nbuckets += directory->nbuckets;
+        stats->size += directory->size;
+        stats->wasted += inline_directory_wasted(directory,
+            innertables[t]->nkeys);
+        stats->slack += inline_directory_slack(directory);
+    }
+    table_stats_memory(stats, &table->memory);
+    stats->load_factor = stats->nkeys * 1.0 / stats->nbuckets;
+    stats->displacements = table->ndisplacements;
+    stats->growths = table->ngrowths;
+    stats->histograms[HISTOGRAM_EVICTIONS] = table->evictions;
+    stats->time = latency_summarise(&table->latency, stats->latency);
+    stats->last_resize = trace_last_duration(&table->trace);
+}
+
+
+// print the cycle events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xuckoo_hash_table_trace(XuckooHashTable *table, int track) {
+    assert(table);
+    
+    trace_print_chrome(&table->trace, "xuckoo", track);
+}
@@ -13,6 +13,7 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../tablestats.h"
 
 typedef struct xuckoo_table XuckooHashTable;
 
@@ -30,10 +31,23 @@ bool xuckoo_hash_table_insert(XuckooHashTable *table, int64 key);
 // returns true if found, false if not
 bool xuckoo_hash_table_lookup(XuckooHashTable *table, int64 key);
 
+// lookup whether each of the 'nkeys' keys in 'keys' is inside 'table', setting
+// the corresponding element of 'found' to true if it is, false if not
+// (this overlaps the cache misses of many lookups at once)
+void xuckoo_hash_table_lookup_many(XuckooHashTable *table, const int64 *keys,
+                                   int nkeys, bool *found);
+
 // print the contents of 'table' to stdout
 void xuckoo_hash_table_print(XuckooHashTable *table);
 
 // print some statistics about 'table' to stdout
 void xuckoo_hash_table_stats(XuckooHashTable *table);
 
+// fill in 'stats' with statistics about 'table'
+void xuckoo_hash_table_get_stats(XuckooHashTable *table, TableStats *stats);
+
+// print the cycle events traced on 'table' into the Chrome trace being
+// printed, on track 'track' (see trace_print_chrome())
+void xuckoo_hash_table_trace(XuckooHashTable *table, int track);
+
 #endif
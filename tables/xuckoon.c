@@ -11,75 +11,169 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xuckoon.h"
-
-// macro to calculate the rightmost n bits of a number x
-#define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
+#include "../latency.h"
+#include "../memusage.h"
+#include "../histogram.h"
+#include "../trace.h"
+#include "keysearch.h"
+#include "directory.h"
+#include "../prng.h"
+
+// how to choose which key to evict from a full bucket
+// (compile with -DEVICTION_POLICY=p to change this):
+#define EVICT_RANDOM      0 // a random key
+#define EVICT_ROUND_ROBIN 1 // each position in the bucket in turn
+#define EVICT_ALTERNATE   2 // a key whose bucket in the other table has space
+                            // (or a random key, if there is no such key)
+#ifndef EVICTION_POLICY
+#define EVICTION_POLICY EVICT_RANDOM
+#endif
+
+// seed for each table's random number generator, so that runs are repeatable
+// (compile with -DXUCKOON_SEED=s to change this)
+#ifndef XUCKOON_SEED
+#define XUCKOON_SEED 20007
+#endif
+
+// the most keys one insertion may displace before buckets are split anyway, as
+// a safety net in case a cycle somehow goes undetected
+// (compile with -DMAX_REPLACEMENTS=n to change this)
+#ifndef MAX_REPLACEMENTS
+#define MAX_REPLACEMENTS 1000
+#endif
+
+// how many keys a batch of lookups works on at once: all of their entries, and
+// then all of their buckets, are prefetched before any of them are looked at
+// (compile with -DLOOKUP_BATCH=n to change this)
+#ifndef LOOKUP_BATCH
+#define LOOKUP_BATCH 16
+#endif
 
 // a bucket stores a single key (full=true) or is empty (full=false)
 // it also knows how many bits are shared between possible keys, and the first 
 // table address that references it
+// (the keys themselves are kept in the inner table's pool of keys, at the same
+// index as the bucket)
 typedef struct xtndbln_bucket {
 	int id;         // a unique id for this bucket, equal to the first address
                     // in the table which points to it
 	int depth;      // how many hash value bits are being used by this bucket
     int nkeys;      // number of keys currently contained in this bucket
-    int64 *keys;	// the keys stored in this bucket
+    int path;       // the last insertion path to displace a key from here
 } Bucket;
 
-// an inner table is an extendible hash table with an array of slots pointing 
-// to buckets holding up to 1 key, along with some information about the number 
-// of hash value bits to use for addressing
+// an inner table is an extendible hash table with a directory of slots holding
+// the indices of buckets (in a pool) holding up to bucketsize keys
 typedef struct inner_table {
-	Bucket **buckets;	// array of pointers to buckets
-	int size;			// how many entries in the table of pointers (2^depth)
-	int depth;			// how many bits of the hash value to use (log2(size))
-    int nbuckets;       // how many distinct buckets does the table point to
-	int nkeys;			// how many keys are being stored in the table
+	Directory directory;	// table of indices of buckets in the pool
+	Bucket *pool;			// array of all buckets, in order of creation
+	int64 *keys;			// keystride keys for each bucket in the pool
+	int poolsize;			// how many buckets the pool has space for
+	int bucketsize;			// maximum number of keys per bucket
+	int keystride;			// space for keys per bucket (bucketsize, padded to
+							// a whole number of vectors for keysearch)
+    int nbuckets;           // how many distinct buckets does the table point to
+                            // (this is also how many buckets are in the pool)
+	int nkeys;				// how many keys are being stored in the table
+	MemoryUsage *memory;	// where the inner table's memory is counted
+	Trace *trace;			// where the inner table's splits are traced
 } InnerTable;
 
+// a step along an insertion path: a bucket the path displaced a key from
+typedef struct step {
+    InnerTable *table;  // the inner table the bucket is in
+    BucketIndex index;  // the index of the bucket in that table's pool
+} Step;
+
 // a xuckoo hash table is just two inner tables for storing inserted keys
 struct xuckoon_table {
 	InnerTable *table1;
 	InnerTable *table2;
     int bucketsize;		// maximum number of keys per bucket
-    int time;           // how much CPU time has been used to insert/lookup keys
+    Prng rng;           // this table's own random number generator
+    int nextvictim;     // position to evict from next (EVICT_ROUND_ROBIN)
+    int npaths;         // how many insertions have had to displace keys
+    Step *steps;        // the steps along the current insertion path
+    int stepssize;      // how many steps there is space for
+    long ndisplacements; // how many keys insertions have displaced
+    Latency latency;    // how long inserts/lookups have taken
+    MemoryUsage memory; // how many bytes the table has allocated
+    Histogram evictions; // how many keys each insertion has displaced
+    long ngrowths;      // how many times a path has had to split buckets
+    Trace trace;        // when buckets have split, and how long it took
 };
 
+// macro to get a pointer to the keys of the bucket at index 'index' in the pool
+// (only valid until the next new bucket is added, since the pool may move)
+#define bucketkeys(table, index) (&(table)->keys[(size_t)(index) * \
+                                                 (table)->keystride])
+
+// the path of keys displaced while inserting a single key
+typedef struct path {
+    int id;             // which path this is (buckets it passes are marked)
+    int replacements;   // how many keys have been displaced along the path
+                        // (this is also how many steps the path has taken)
+    int ndisplaced;     // how many keys the insertion has displaced in all
+                        // (including along paths abandoned to split buckets)
+} Path;
+
 /* * * *
  * helper functions
  */
 
-// create a new bucket first referenced from 'first_address', based on 'depth'
-// bits of its keys' hash values
+// add a new bucket to the pool, first referenced from 'first_address', based
+// on 'depth' bits of its keys' hash values, and return its index
 // function modified from provided function in xtndbl1.c
-static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
-    Bucket *bucket = malloc(sizeof *bucket);
-    assert(bucket);
+static BucketIndex new_bucket(InnerTable *table, int first_address, int depth) {
+    
+    // make more space in the pools if they are full (doubling, so that adding
+    // buckets costs constant time on average)
+    if (table->nbuckets == table->poolsize) {
+        size_t oldbuckets = (sizeof *table->pool) * table->poolsize;
+        size_t oldkeys = (sizeof *table->keys) * table->poolsize *
+            table->keystride;
+        table->poolsize *= 2;
+        table->pool = memory_realloc(table->memory, MEMORY_BUCKETS,
+                                     table->pool, oldbuckets, oldbuckets * 2);
+        assert(table->pool);
+        table->keys = memory_realloc(table->memory, MEMORY_KEYS,
+                                     table->keys, oldkeys, oldkeys * 2);
+        assert(table->keys);
+    }
     
+    BucketIndex index = table->nbuckets++;
+    Bucket *bucket = &table->pool[index];
     bucket->id = first_address;
     bucket->depth = depth;
     bucket->nkeys = 0;
+    bucket->path = 0;
     
-    bucket->keys = malloc((sizeof bucket->keys) * bucketsize);
-    
-    return bucket;
+    return index;
 }
 
 // set up the internals of a linear hash table struct with new
-// arrays of size 'size'
+// arrays of size 'size', counting their memory in 'memory' and tracing its
+// splits in 'trace'
 // function modified from provided function in linear.c
-static void initialise_table(InnerTable *table, int bucketsize) {
+static void initialise_table(InnerTable *table, int bucketsize,
+                             MemoryUsage *memory, Trace *trace) {
     
-    table->size = 1;
-    table->buckets = malloc(sizeof *table->buckets);
-    assert(table->buckets);
-    table->buckets[0] = new_bucket(0, 0, bucketsize);
-    table->depth = 0;
+    table->memory = memory;
+    table->trace = trace;
+    table->bucketsize = bucketsize;
+    table->nbuckets = 0;
+    table->poolsize = 1;
+    table->pool = memory_malloc(memory, MEMORY_BUCKETS, sizeof *table->pool);
+    assert(table->pool);
+    table->keystride = keysearch_padded(bucketsize);
+    table->keys = memory_malloc(memory, MEMORY_KEYS,
+                                (sizeof *table->keys) * table->keystride);
+    assert(table->keys);
+    
+    initialise_directory(&table->directory, new_bucket(table, 0, 0), memory);
     
-    table->nbuckets = 1;
     table->nkeys = 0;
 }
 
@@ -88,60 +182,41 @@ static void initialise_table(InnerTable *table, int bucketsize) {
 static void free_inner_table(InnerTable *table) {
     assert(table);
     
-    // loop backwards through the array of pointers, freeing buckets only as we
-    // reach their first reference
-    // (if we loop through forwards, we wouldn't know which reference was last)
-    int i;
-    for (i = table->size-1; i >= 0; i--) {
-        if (table->buckets[i]->id == i) {
-            // free the array of keys in the bucket
-            free(table->buckets[i]->keys);
-            // free the bucket itself
-            free(table->buckets[i]);
-        }
-    }
-    
-    // free the array of bucket pointers
-    free(table->buckets);
+    // free the pools of buckets and keys (all at once) and the directory
+    memory_free(table->memory, MEMORY_BUCKETS, table->pool,
+                (sizeof *table->pool) * table->poolsize);
+    memory_free(table->memory, MEMORY_KEYS, table->keys,
+                (sizeof *table->keys) * table->poolsize * table->keystride);
+    free_directory(&table->directory);
     
     // free the inner table struct itself
-    free(table);
+    memory_free(table->memory, MEMORY_TABLE, table, sizeof *table);
 }
 
-// checks if key is in an inner table, returns true if it is in the table,
-// false if it is not
-static bool find_key(InnerTable *table, int address, int64 key) {
-    if (table->buckets[address]->nkeys) {
-        int i;
-        for (i = 0; i < table->buckets[address]->nkeys; i++) {
-            if (table->buckets[address]->keys[i] == key) {
-                // key is already in table
-                return true;
-            }
-        }
-    }
-    // key is not in table
-    return false;
+// start fetching the bucket at index 'index' of the pool (and its keys) into
+// the cache, so that a later find doesn't have to wait for it
+static void prefetch_bucket(InnerTable *table, BucketIndex index) {
+    __builtin_prefetch(&table->pool[index]);
+    __builtin_prefetch(bucketkeys(table, index));
 }
 
-// double the table of bucket pointers, duplicating the bucket pointers in the
-// first half into the new second half of the table
-// function modified from provided function in xtndbl1.c
-static void double_table(InnerTable *table) {
-    int size = table->size * 2;
-    assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
+// checks if key is in either inner table of 'table', with both of its
+// candidate buckets fetched at once (and both searched, comparing several of
+// each bucket's keys at once, rather than waiting to see if the first has it)
+// returns true if it is in the table, false if it is not
+static bool find_key_either(XuckooNHashTable *table, int64 key) {
+    InnerTable *table1 = table->table1;
+    InnerTable *table2 = table->table2;
     
-    // get a new array of twice as many bucket pointers, and copy pointers down
-    table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size);
-    assert(table->buckets);
-    int i;
-    for (i = 0; i < table->size; i++) {
-        table->buckets[table->size + i] = table->buckets[i];
-    }
+    BucketIndex index1 = directory_lookup(&table1->directory, h1(key));
+    BucketIndex index2 = directory_lookup(&table2->directory, h2(key));
+    prefetch_bucket(table1, index1);
+    prefetch_bucket(table2, index2);
     
-    // finally, increase the table size and the depth we are using to hash keys
-    table->size = size;
-    table->depth++;
+    return keysearch(bucketkeys(table1, index1), table1->pool[index1].nkeys,
+                     key) |
+           keysearch(bucketkeys(table2, index2), table2->pool[index2].nkeys,
+                     key);
 }
 
 // reinsert a key into the hash table after splitting a bucket --- we can assume
@@ -150,62 +225,37 @@ static void double_table(InnerTable *table) {
 // use 'xtndbl1_hash_table_insert()' instead for inserting new keys
 // function modified from provided function in xtndbl1.c
 static void reinsert_key(InnerTable *table, int64 key, int (*h)(int64)) {
-    int address = rightmostnbits(table->depth, h(key));
-    table->buckets[address]->keys[table->buckets[address]->nkeys] = key;
-    table->buckets[address]->nkeys++;
+    BucketIndex index = directory_lookup(&table->directory, h(key));
+    bucketkeys(table, index)[table->pool[index].nkeys] = key;
+    table->pool[index].nkeys++;
 }
 
-// split the bucket in 'table' at address 'address', growing table if necessary
+// split the bucket in 'table' at index 'index' of the pool, growing the
+// directory if necessary
 // function modified from provided function in xtndbl1.c
-static void split_bucket(InnerTable *table, int address, int bucketsize,
+static void split_bucket(InnerTable *table, BucketIndex index,
                          int (*h)(int64)) {
+    TRACE_START(start);
+    int oldsize = table->directory.size;
     
     // FIRST,
-    // do we need to grow the table?
-    if (table->buckets[address]->depth == table->depth) {
-        // yep, this bucket is down to its last pointer
-        double_table(table);
-    }
-    // either way, now it's time to split this bucket
-    
-    
-    // SECOND,
     // create a new bucket and update both buckets' depth
-    Bucket *bucket = table->buckets[address];
-    int depth = bucket->depth;
-    int first_address = bucket->id;
+    // (hold on to the old bucket by index: adding a bucket may move the pool)
+    int depth = table->pool[index].depth;
+    int first_address = table->pool[index].id;
     
     int new_depth = depth + 1;
-    bucket->depth = new_depth;
+    table->pool[index].depth = new_depth;
     
     // new bucket's first address will be a 1 bit plus the old first address
     int new_first_address = 1 << depth | first_address;
-    Bucket *newbucket = new_bucket(new_first_address, new_depth, bucketsize);
-    table->nbuckets++;
-    
-    // THIRD,
-    // redirect every second address pointing to this bucket to the new bucket
-    // construct addresses by joining a bit 'prefix' and a bit 'suffix'
-    // (defined below)
-    
-    // suffix: a 1 bit followed by the previous bucket bit address
-    int bit_address = rightmostnbits(depth, first_address);
-    int suffix = (1 << depth) | bit_address;
+    BucketIndex newindex = new_bucket(table, new_first_address, new_depth);
     
-    // prefix: all bitstrings of length equal to the difference between the new
-    // bucket depth and the table depth
-    // use a for loop to enumerate all possible prefixes less than maxprefix:
-    int maxprefix = 1 << (table->depth - new_depth);
-    
-    int prefix;
-    for (prefix = 0; prefix < maxprefix; prefix++) {
-        
-        // construct address by joining this prefix and the suffix
-        int a = (prefix << new_depth) | suffix;
-        
-        // redirect this table entry to point at the new bucket
-        table->buckets[a] = newbucket;
-    }
+    // SECOND,
+    // redirect every second directory entry pointing to this bucket to the new
+    // bucket (the directory grows first if this bucket is down to its last
+    // entry)
+    directory_split(&table->directory, first_address, depth, newindex);
     
     // FINALLY,
     // filter the keys from the old bucket into their rightful places in the
@@ -214,47 +264,186 @@ static void split_bucket(InnerTable *table, int address, int bucketsize,
     // remove and reinsert the keys
     int i;
     int64 key;
-    int nkeys = bucket->nkeys;
-    bucket->nkeys = 0;
+    int nkeys = table->pool[index].nkeys;
+    table->pool[index].nkeys = 0;
     for (i = 0; i < nkeys; i++) {
-        key = bucket->keys[i];
+        key = bucketkeys(table, index)[i];
         reinsert_key(table, key, h);
     }
+    
+    // trace the split (and the doubling of the directory, if it had to)
+    TRACE_STOP(table->trace, TRACE_SPLIT, start, nkeys, table->nbuckets - 1,
+               table->nbuckets);
+    if (table->directory.size != oldsize) {
+        TRACE_STOP(table->trace, TRACE_DOUBLE, start, 0, oldsize,
+                   table->directory.size);
+    }
+}
+
+// add 'key' to the bucket at index 'index' in 'table' if the bucket has space
+// returns true if it was added, false if the bucket is full
+static bool add_key_if_space(InnerTable *table, BucketIndex index, int64 key) {
+    Bucket *bucket = &table->pool[index];
+    if (bucket->nkeys == table->bucketsize) {
+        return false;
+    }
+    bucketkeys(table, index)[bucket->nkeys] = key;
+    bucket->nkeys++;
+    table->nkeys++;
+    return true;
+}
+
+// choose which key to evict from the (full) bucket at index 'index' in
+// 'tableA', according to EVICTION_POLICY, and return its position in the bucket
+static int choose_victim(XuckooNHashTable *table, InnerTable *tableA,
+                         BucketIndex index, InnerTable *tableB,
+                         int (*hB)(int64)) {
+#if EVICTION_POLICY == EVICT_ROUND_ROBIN
+    // take each position in turn (across all buckets)
+    table->nextvictim = (table->nextvictim + 1) % table->bucketsize;
+    return table->nextvictim;
+#else
+#if EVICTION_POLICY == EVICT_ALTERNATE
+    // look for a key that can move straight into its bucket in the other table
+    int64 *keys = bucketkeys(tableA, index);
+    int i;
+    for (i = 0; i < tableA->pool[index].nkeys; i++) {
+        BucketIndex other = directory_lookup(&tableB->directory, hB(keys[i]));
+        if (tableB->pool[other].nkeys < table->bucketsize) {
+            return i;
+        }
+    }
+#endif
+    // take a random key
+    return prng_below(&table->rng, tableA->pool[index].nkeys);
+#endif
+}
+
+// remember that 'path' is displacing a key from the bucket at index 'index' in
+// 'inner', as its next step
+static void record_step(XuckooNHashTable *table, Path *path, InnerTable *inner,
+                        BucketIndex index) {
+    if (path->replacements == table->stepssize) {
+        size_t oldsize = (sizeof *table->steps) * table->stepssize;
+        table->stepssize *= 2;
+        table->steps = memory_realloc(&table->memory, MEMORY_SCRATCH,
+                                      table->steps, oldsize, oldsize * 2);
+        assert(table->steps);
+    }
+    table->steps[path->replacements].table = inner;
+    table->steps[path->replacements].index = index;
+}
+
+// split every (full) bucket of 'inner' along 'path' that can split without
+// doubling the directory of 'inner', and return how many were split
+static int split_path_buckets_in(XuckooNHashTable *table, Path *path,
+                                 InnerTable *inner) {
+    int (*h)(int64) = inner == table->table1 ? h1 : h2;
+    int i, nsplit = 0;
+    for (i = 0; i < path->replacements; i++) {
+        Step *step = &table->steps[i];
+        // (a step in the other inner table may index past this one's pool)
+        if (step->table != inner) {
+            continue;
+        }
+        Bucket *bucket = &inner->pool[step->index];
+        if (bucket->nkeys == inner->bucketsize &&
+            !directory_split_grows(&inner->directory, bucket->id,
+                                   bucket->depth)) {
+            split_bucket(inner, step->index, h);
+            nsplit++;
+        }
+    }
+    return nsplit;
+}
+
+// split buckets along 'path' to make space for its keys: the buckets that can
+// split without doubling a directory, from the less-loaded inner table if it
+// has any, or else from the other. if every bucket on the path would double its
+// directory, split just the bucket at index 'index' in 'inner' (where the path
+// is now)
+static void split_path_buckets(XuckooNHashTable *table, Path *path,
+                               InnerTable *inner, BucketIndex index) {
+    InnerTable *table1 = table->table1;
+    InnerTable *table2 = table->table2;
+    
+    // try the less-loaded table first
+    InnerTable *tables[2] = {table1, table2};
+    if (table1->nkeys * 1.0 / table1->nbuckets >
+        table2->nkeys * 1.0 / table2->nbuckets) {
+        tables[0] = table2;
+        tables[1] = table1;
+    }
+    int t;
+    for (t = 0; t < 2; t++) {
+        if (split_path_buckets_in(table, path, tables[t]) > 0) {
+            return;
+        }
+    }
+    
+    split_bucket(inner, index, inner == table1 ? h1 : h2);
 }
 
 // insert a key into the xuckoo hash table
 // function modified from provided function in xtndbl1.c
 static bool insert_key(int64 key, XuckooNHashTable *table, InnerTable *tableA,
                        InnerTable *tableB, int (*hA)(int64),
-                       int (*hB)(int64), int *replacements) {
-    int address = rightmostnbits(tableA->depth, hA(key));
+                       int (*hB)(int64), Path *path) {
+    BucketIndex index = directory_lookup(&tableA->directory, hA(key));
     int64 prekey;
     
-    if (tableA->buckets[address]->nkeys != table->bucketsize) {
-        // bucket not full, so insert key
-        tableA->buckets[address]->keys[tableA->buckets[address]->nkeys] = key;
-        tableA->buckets[address]->nkeys++;
-        tableA->nkeys++;
+    if (add_key_if_space(tableA, index, key)) {
+        // bucket not full, so key inserted
         return true;
     }
     
-    // bucket full, so pop a random preexisting key
-    int random_index = rand() % tableA->buckets[address]->nkeys;
-    prekey = tableA->buckets[address]->keys[random_index];
-    // and insert the new key
-    tableA->buckets[address]->keys[random_index] = key;
-    
-    // split bucket if number of replacements is too high (there is a 'cycle')
-    if ((*replacements >= 1000)) {
-        split_bucket(tableA, address, table->bucketsize, hA);
+    // if the path has come back to a bucket it has already displaced a key
+    // from, it has closed a cycle: rather than go around it (perhaps forever),
+    // make space by splitting buckets along the path straight away, and start
+    // a new path from here (also do this if the path grows too long anyway)
+    if (tableA->pool[index].path == path->id
+        || path->replacements >= MAX_REPLACEMENTS) {
+        TRACE_START(start);
+        int oldnbuckets = table->table1->nbuckets + table->table2->nbuckets;
+        table->ngrowths++;
+        split_path_buckets(table, path, tableA, index);
+        TRACE_STOP(&table->trace, TRACE_CYCLE, start, path->replacements,
+                   oldnbuckets, table->table1->nbuckets +
+                                table->table2->nbuckets);
+        path->id = ++table->npaths;
+        path->replacements = 0;
+        return insert_key(key, table, tableA, tableB, hA, hB, path);
     }
+    tableA->pool[index].path = path->id;
+    record_step(table, path, tableA, index);
+    
+    // bucket full, so pop a preexisting key
+    int64 *keys = bucketkeys(tableA, index);
+    int victim = choose_victim(table, tableA, index, tableB, hB);
+    prekey = keys[victim];
+    // and insert the new key
+    keys[victim] = key;
     
-    (*replacements)++;
+    path->replacements++;
+    path->ndisplaced++;
+    table->ndisplacements++;
     // insert preexisting key using recursive call
-    return insert_key(prekey, table, tableB, tableA, hB, hA, replacements);
+    return insert_key(prekey, table, tableB, tableA, hB, hA, path);
 }
 
 
+// count how many keys each bucket of each inner table holds in 'occupancy'
+static void count_occupancy(XuckooNHashTable *table, Histogram *occupancy) {
+    initialise_histogram(occupancy);
+    InnerTable *innertables[2] = {table->table1, table->table2};
+    int t, i;
+    for (t = 0; t < 2; t++) {
+        for (i = 0; i < innertables[t]->nbuckets; i++) {
+            histogram_add(occupancy, innertables[t]->pool[i].nkeys);
+        }
+    }
+}
+
 /* * * *
  * all functions
  */
@@ -264,16 +453,38 @@ static bool insert_key(int64 key, XuckooNHashTable *table, InnerTable *tableA,
 XuckooNHashTable *new_xuckoon_hash_table(int bucketsize) {
     XuckooNHashTable *table = malloc(sizeof *table);
     assert(table);
-    
-    table->table1 = malloc(sizeof *table->table1);
-    table->table2 = malloc(sizeof *table->table2);
+    initialise_memory_usage(&table->memory);
+    // the latencies, evictions and trace are instrumentation, not the table
+    long instrumentation = sizeof table->latency + sizeof table->evictions +
+        sizeof table->trace;
+    memory_count(&table->memory, MEMORY_TABLE,
+        sizeof *table - instrumentation);
+    memory_count(&table->memory, MEMORY_INSTRUMENTATION, instrumentation);
+    
+    table->table1 = memory_malloc(&table->memory, MEMORY_TABLE,
+                                  sizeof *table->table1);
+    assert(table->table1);
+    table->table2 = memory_malloc(&table->memory, MEMORY_TABLE,
+                                  sizeof *table->table2);
+    assert(table->table2);
     
     // set up the internals of the table struct with arrays of size 'size'
-    initialise_table(table->table1, bucketsize);
-    initialise_table(table->table2, bucketsize);
+    initialise_trace(&table->trace);
+    initialise_table(table->table1, bucketsize, &table->memory, &table->trace);
+    initialise_table(table->table2, bucketsize, &table->memory, &table->trace);
     
     table->bucketsize = bucketsize;
-    table->time = 0;
+    prng_seed(&table->rng, XUCKOON_SEED);
+    table->nextvictim = 0;
+    table->npaths = 0;
+    table->stepssize = 1;
+    table->steps = memory_malloc(&table->memory, MEMORY_SCRATCH,
+                                 sizeof *table->steps);
+    assert(table->steps);
+    table->ndisplacements = 0;
+    initialise_histogram(&table->evictions);
+    table->ngrowths = 0;
+    initialise_latency(&table->latency);
     
     return table;
 }
@@ -285,6 +496,8 @@ void free_xuckoon_hash_table(XuckooNHashTable *table) {
     
     free_inner_table(table->table1);
     free_inner_table(table->table2);
+    memory_free(&table->memory, MEMORY_SCRATCH, table->steps,
+                (sizeof *table->steps) * table->stepssize);
     
     // free the table struct itself
     free(table);
@@ -297,19 +510,15 @@ void free_xuckoon_hash_table(XuckooNHashTable *table) {
 bool xuckoon_hash_table_insert(XuckooNHashTable *table, int64 key) {
     assert(table);
     
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
     
     InnerTable *table1 = table->table1;
     InnerTable *table2 = table->table2;
     
-    // calculate the addresses for the key
-    int addressA = rightmostnbits(table1->depth, h1(key));
-    int addressB = rightmostnbits(table2->depth, h2(key));
-    
     // is this key already there?
-    if ((find_key(table1, addressA, key) ||
-        find_key(table2, addressB, key))) {
-        table->time += clock() - start_time; // add time elapsed
+    if (find_key_either(table, key)) {
+        // add time elapsed
+        LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
         return false;
     }
     
@@ -330,14 +539,26 @@ bool xuckoon_hash_table_insert(XuckooNHashTable *table, int64 key) {
         hB = h1;
     }
     
-    int replacements = 0;
-    srand(time(NULL));
-    
     // key is not in table - so insert it
-    // (attempt to insert into tableA, the table with fewer keys, first)
-    bool inserted = insert_key(key, table, tableA, tableB, hA, hB, &replacements);
+    // (into tableA, the table with fewer keys, if its bucket has space, or else
+    // into tableB if its bucket has space, before evicting anything)
+    if (add_key_if_space(tableA, directory_lookup(&tableA->directory, hA(key)),
+                         key) ||
+        add_key_if_space(tableB, directory_lookup(&tableB->directory, hB(key)),
+                         key)) {
+        histogram_add(&table->evictions, 0);
+        // add time elapsed
+        LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
+        return true;
+    }
     
-    table->time += clock() - start_time; // add time elapsed
+    // both buckets are full, so start evicting keys from tableA
+    Path path = {++table->npaths, 0, 0};
+    bool inserted = insert_key(key, table, tableA, tableB, hA, hB, &path);
+    histogram_add(&table->evictions, path.ndisplaced);
+    
+    // add time elapsed
+    LATENCY_STOP(&table->latency, LATENCY_INSERT, start_time);
     return inserted;
 }
 
@@ -347,22 +568,62 @@ bool xuckoon_hash_table_insert(XuckooNHashTable *table, int64 key) {
 // function modified from provided function in xtndbl1.c
 bool xuckoon_hash_table_lookup(XuckooNHashTable *table, int64 key) {
     assert(table);
-    int start_time = clock(); // start timing
+    LATENCY_START(start_time); // start timing
+    
+    // look for the key in its bucket in each table (at the same time)
+    bool found = find_key_either(table, key);
+    
+    // count the time elapsed before returning result
+    LATENCY_STOP(&table->latency, LATENCY_LOOKUP, start_time);
+    return found;
+}
+
+
+// lookup whether each of the 'nkeys' keys in 'keys' is inside 'table', setting
+// the corresponding element of 'found' to true if it is, false if not
+void xuckoon_hash_table_lookup_many(XuckooNHashTable *table,
+                                    const int64 *keys, int nkeys, bool *found) {
+    assert(table);
+    LATENCY_START(start_time); // start timing
     
     InnerTable *table1 = table->table1;
     InnerTable *table2 = table->table2;
     
-    // calculate the addresses for the key
-    int addressA = rightmostnbits(table1->depth, h1(key));
-    int addressB = rightmostnbits(table2->depth, h2(key));
-    
-    // look for the key in that bucket (unless it's empty)
-    bool found = (find_key(table1, addressA, key) ||
-                  find_key(table2, addressB, key));
+    int hash1[LOOKUP_BATCH], hash2[LOOKUP_BATCH];
+    BucketIndex index1[LOOKUP_BATCH], index2[LOOKUP_BATCH];
+    int first, i;
+    for (first = 0; first < nkeys; first += LOOKUP_BATCH) {
+        int n = nkeys - first < LOOKUP_BATCH ? nkeys - first : LOOKUP_BATCH;
+        
+        // start fetching every directory entry in the batch...
+        for (i = 0; i < n; i++) {
+            hash1[i] = h1(keys[first + i]);
+            hash2[i] = h2(keys[first + i]);
+            directory_prefetch(&table1->directory, hash1[i]);
+            directory_prefetch(&table2->directory, hash2[i]);
+        }
+        
+        // ...then every bucket they lead to...
+        for (i = 0; i < n; i++) {
+            index1[i] = directory_lookup(&table1->directory, hash1[i]);
+            index2[i] = directory_lookup(&table2->directory, hash2[i]);
+            prefetch_bucket(table1, index1[i]);
+            prefetch_bucket(table2, index2[i]);
+        }
+        
+        // ...and only then search the buckets, by which time they've arrived
+        for (i = 0; i < n; i++) {
+            int64 key = keys[first + i];
+            found[first + i] =
+                keysearch(bucketkeys(table1, index1[i]),
+                          table1->pool[index1[i]].nkeys, key) |
+                keysearch(bucketkeys(table2, index2[i]),
+                          table2->pool[index2[i]].nkeys, key);
+        }
+    }
     
-    // add time elapsed to total CPU time before returning result
-    table->time += clock() - start_time;
-    return found;
+    // count the time elapsed (shared equally between the keys)
+    LATENCY_STOP_MANY(&table->latency, LATENCY_LOOKUP, start_time, nkeys);
 }
 
 
@@ -384,19 +645,22 @@ void xuckoon_hash_table_print(XuckooNHashTable *table) {
 		
 		// print table and buckets
 		int i;
-		for (i = 0; i < innertables[t]->size; i++) {
+		int size = 1 << innertables[t]->directory.depth;
+		for (i = 0; i < size; i++) {
 			// table entry
-			printf("%9d | %-9d ", i, innertables[t]->buckets[i]->id);
+			BucketIndex index = directory_lookup(&innertables[t]->directory, i);
+			Bucket *bucket = &innertables[t]->pool[index];
+			printf("%9d | %-9d ", i, bucket->id);
 
 			// if this is the first address at which a bucket occurs, print it
-			if (innertables[t]->buckets[i]->id == i) {
-				printf("%9d ", innertables[t]->buckets[i]->id);
+			if (bucket->id == i) {
+				printf("%9d ", bucket->id);
                 
                 // print the bucket's contents
                 printf("[");
                 for(int j = 0; j < table->bucketsize; j++) {
-                    if (j < innertables[t]->buckets[i]->nkeys) {
-                        printf(" %llu", innertables[t]->buckets[i]->keys[j]);
+                    if (j < bucket->nkeys) {
+                        printf(" %llu", bucketkeys(innertables[t], index)[j]);
                     } else {
                         printf(" -");
                     }
@@ -423,27 +687,74 @@ void xuckoon_hash_table_stats(XuckooNHashTable *table) {
     printf("--- table stats ---\n");
     
     // print some stats about state of the entire table
-    printf("       total table size: %d\n", table1->size + table2->size);
+    printf("       total table size: %d\n", table1->directory.size + table2->directory.size);
     printf("   total number of keys: %d\n", table1->nkeys + table2->nkeys);
     printf("total number of buckets: %d\n", table1->nbuckets + table2->nbuckets);
     printf("            bucket size: %d\n", table->bucketsize);
     
     // information about table 1
     printf("Inner Table 1\n");
-    printf("             table size: %d\n", table1->size);
+    printf("             table size: %d\n", table1->directory.size);
     printf("         number of keys: %d\n", table1->nkeys);
     printf("      number of buckets: %d\n", table1->nbuckets);
     
     // information about table 2
     printf("Inner Table 2\n");
-    printf("             table size: %d\n", table2->size);
+    printf("             table size: %d\n", table2->directory.size);
     printf("         number of keys: %d\n", table2->nkeys);
     printf("      number of buckets: %d\n", table2->nbuckets);
     
-    // also calculate CPU usage in seconds and print this
-    float seconds = table->time * 1.0 / CLOCKS_PER_SEC;
-    printf("         CPU time spent: %.6f sec\n", seconds);
+    // also print how long operations have taken, and how much memory the
+    // table is using
+    latency_print(&table->latency, 23);
+    histogram_print(&table->evictions, "eviction chains", 23);
+    printf("%23s: %ld\n", "cycle growths", table->ngrowths);
+    Histogram occupancy;
+    count_occupancy(table, &occupancy);
+    histogram_print(&occupancy, "bucket occupancy", 23);
+    TableStats stats;
+    initialise_table_stats(&stats);
+    xuckoon_hash_table_get_stats(table, &stats);
+    print_table_memory(&stats, 23);
     
     printf("--- end stats ---\n");
 
 }
+
+
+// fill in 'stats' with statistics about 'table'
+void xuckoon_hash_table_get_stats(XuckooNHashTable *table, TableStats *stats) {
+    assert(table);
+    
+    InnerTable *innertables[2] = {table->table1, table->table2};
+    stats->bucketsize = table->bucketsize;
+    int t;
+    for (t = 0; t < 2; t++) {
+        InnerTable *inner = innertables[t];
+        stats->nkeys += inner->nkeys;
+        stats->nbuckets += inner->nbuckets;
+        stats->size += inner->directory.size;
+        stats->wasted += ((long)inner->nbuckets * inner->keystride -
+                          inner->nkeys) * sizeof *inner->keys;
+        stats->slack += (long)(inner->poolsize - inner->nbuckets) *
+            (sizeof *inner->pool + inner->keystride * sizeof *inner->keys);
+    }
+    table_stats_memory(stats, &table->memory);
+    count_occupancy(table, &stats->histograms[HISTOGRAM_OCCUPANCY]);
+    stats->load_factor = stats->nkeys * 1.0 /
+        (stats->nbuckets * table->bucketsize);
+    stats->displacements = table->ndisplacements;
+    stats->growths = table->ngrowths;
+    stats->histograms[HISTOGRAM_EVICTIONS] = table->evictions;
+    stats->time = latency_summarise(&table->latency, stats->latency);
+    stats->last_resize = trace_last_duration(&table->trace);
+}
+
+
+// print the split and cycle events traced on 'table' into the Chrome trace
+// being printed, on track 'track' (see trace_print_chrome())
+void xuckoon_hash_table_trace(XuckooNHashTable *table, int track) {
+    assert(table);
+    
+    trace_print_chrome(&table->trace, "xuckoon", track);
+}
@@ -13,6 +13,7 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "../tablestats.h"
 
 typedef struct xuckoon_table XuckooNHashTable;
 
@@ -30,10 +31,23 @@ bool xuckoon_hash_table_insert(XuckooNHashTable *table, int64 key);
 // returns true if found, false if not
 bool xuckoon_hash_table_lookup(XuckooNHashTable *table, int64 key);
 
+// lookup whether each of the 'nkeys' keys in 'keys' is inside 'table', setting
+// the corresponding element of 'found' to true if it is, false if not
+// (this overlaps the cache misses of many lookups at once)
+void xuckoon_hash_table_lookup_many(XuckooNHashTable *table,
+                                    const int64 *keys, int nkeys, bool *found);
+
 // print the contents of 'table' to stdout
 void xuckoon_hash_table_print(XuckooNHashTable *table);
 
 // print some statistics about 'table' to stdout
 void xuckoon_hash_table_stats(XuckooNHashTable *table);
 
+// fill in 'stats' with statistics about 'table'
+void xuckoon_hash_table_get_stats(XuckooNHashTable *table, TableStats *stats);
+
+// print the split and cycle events traced on 'table' into the Chrome trace
+// being printed, on track 'track' (see trace_print_chrome())
+void xuckoon_hash_table_trace(XuckooNHashTable *table, int track);
+
 #endif
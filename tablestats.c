@@ -0,0 +1,221 @@
+/* * * * * * * * *
+ * Module providing one structure for the statistics of every type of hash
+ * table, so that they can be compared (and printed in machine-readable JSON or
+ * CSV form) without caring which type of table they came from
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tablestats.h"
+
+// the names of each distribution, for printing
+const char *table_histogram_names[NTABLEHISTOGRAMS] = {
+	"probes_hit", "probes_miss", "evictions", "occupancy"
+};
+
+// set up 'stats' with everything zero, ready for a table to fill in
+void initialise_table_stats(TableStats *stats) {
+	memset(stats, 0, sizeof *stats);
+	stats->type = "";
+	stats->shards = 1;
+}
+
+// fill in the memory statistics of 'stats' from the counts in 'memory' (after
+// the table has filled in 'nkeys', 'wasted' and 'slack')
+void table_stats_memory(TableStats *stats, const MemoryUsage *memory) {
+	stats->memory = *memory;
+	stats->bytes = memory_total(memory);
+	stats->bytes_per_key = stats->nkeys ? stats->bytes * 1.0 / stats->nkeys : 0;
+}
+
+// add the statistics of 'shard', one shard of a sharded table, to 'stats', the
+// statistics of the whole table (which start out as initialised above)
+void merge_table_stats(TableStats *stats, const TableStats *shard) {
+	stats->type = shard->type;
+	stats->bucketsize = shard->bucketsize;
+
+	// the load factor of all the buckets together (before they're added up)
+	long nbuckets = stats->nbuckets + shard->nbuckets;
+	if (nbuckets) {
+		stats->load_factor = (stats->load_factor * stats->nbuckets +
+			shard->load_factor * shard->nbuckets) / nbuckets;
+	}
+	stats->nbuckets = nbuckets;
+
+	stats->nkeys += shard->nkeys;
+	stats->size += shard->size;
+	stats->noverflow += shard->noverflow;
+	stats->wasted += shard->wasted;
+	stats->slack += shard->slack;
+	stats->probes += shard->probes;
+	stats->collisions += shard->collisions;
+	stats->displacements += shard->displacements;
+	stats->growths += shard->growths;
+	stats->time += shard->time;
+	stats->lock_waits += shard->lock_waits;
+	if (shard->last_resize > stats->last_resize) {
+		stats->last_resize = shard->last_resize;
+	}
+
+	MemoryUsage memory = stats->memory;
+	int kind;
+	for (kind = 0; kind < NMEMORYKINDS; kind++) {
+		memory.bytes[kind] += shard->memory.bytes[kind];
+	}
+	table_stats_memory(stats, &memory);
+
+	// the shards' latencies were summarised separately, so the best that can
+	// be said of the whole table is that it was no slower than its slowest
+	int op;
+	for (op = 0; op < NLATENCYOPS; op++) {
+		LatencySummary *latency = &stats->latency[op];
+		const LatencySummary *other = &shard->latency[op];
+		latency->count += other->count;
+		latency->p50 = latency->p50 > other->p50 ? latency->p50 : other->p50;
+		latency->p99 = latency->p99 > other->p99 ? latency->p99 : other->p99;
+		latency->p999 = latency->p999 > other->p999 ? latency->p999 :
+			other->p999;
+		latency->max = latency->max > other->max ? latency->max : other->max;
+	}
+
+	int h;
+	for (h = 0; h < NTABLEHISTOGRAMS; h++) {
+		histogram_merge(&stats->histograms[h], &shard->histograms[h]);
+	}
+}
+
+// print the memory statistics in 'stats' (total bytes, bytes per key and
+// directory overhead, wasted space and slack), with labels right-aligned to
+// 'width' characters
+void print_table_memory(const TableStats *stats, int width) {
+	printf("%*s: %ld bytes (%.2f bytes/key)\n", width, "memory used",
+		stats->bytes, stats->bytes_per_key);
+
+	// where those bytes have gone
+	printf("%*s:", width, "memory by use");
+	int kind;
+	for (kind = 0; kind < NMEMORYKINDS; kind++) {
+		printf(" %s %ld%s", memory_kindnames[kind], stats->memory.bytes[kind],
+			kind + 1 < NMEMORYKINDS ? "," : "\n");
+	}
+
+	// how much of them isn't storing keys
+	double percent = stats->bytes ? 100.0 / stats->bytes : 0;
+	long directory = stats->memory.bytes[MEMORY_DIRECTORY];
+	printf("%*s: %ld bytes (%.1f%%)\n", width, "directory bytes", directory,
+		directory * percent);
+	printf("%*s: %ld bytes (%.1f%%)\n", width, "wasted capacity",
+		stats->wasted, stats->wasted * percent);
+	printf("%*s: %ld bytes (%.1f%%)\n", width, "slack", stats->slack,
+		stats->slack * percent);
+}
+
+// print 'stats' to stdout as a single-line JSON object
+void print_table_stats_json(const TableStats *stats) {
+	printf("{\"type\": \"%s\", \"keys\": %ld, \"buckets\": %ld, "
+		"\"bucket_size\": %d, \"size\": %ld, \"overflow_pages\": %ld, "
+		"\"load_factor\": %.6f, \"bytes\": %ld, \"bytes_per_key\": %.2f, "
+		"\"wasted_bytes\": %ld, \"slack_bytes\": %ld, \"probes\": %ld, "
+		"\"collisions\": %ld, \"displacements\": %ld, \"growths\": %ld, "
+		"\"time\": %.6f, \"last_resize\": %.6f, \"shards\": %d, "
+		"\"lock_waits\": %ld", stats->type, stats->nkeys, stats->nbuckets,
+		stats->bucketsize, stats->size, stats->noverflow, stats->load_factor,
+		stats->bytes, stats->bytes_per_key, stats->wasted, stats->slack,
+		stats->probes, stats->collisions, stats->displacements, stats->growths,
+		stats->time, stats->last_resize, stats->shards, stats->lock_waits);
+
+	// one object of bytes for each kind of memory
+	printf(", \"memory\": {");
+	int kind;
+	for (kind = 0; kind < NMEMORYKINDS; kind++) {
+		printf("%s\"%s\": %ld", kind ? ", " : "", memory_kindnames[kind],
+			stats->memory.bytes[kind]);
+	}
+	printf("}");
+
+	// one object of latencies (in nanoseconds) for each type of operation
+	int op;
+	for (op = 0; op < NLATENCYOPS; op++) {
+		const LatencySummary *latency = &stats->latency[op];
+		printf(", \"%s\": {\"count\": %ld, \"p50_ns\": %.0f, \"p99_ns\": %.0f, "
+			"\"p999_ns\": %.0f, \"max_ns\": %.0f}", latency_opnames[op],
+			latency->count, latency->p50, latency->p99, latency->p999,
+			latency->max);
+	}
+
+	// and one object for each distribution, with the count in each non-empty
+	// bucket as a [smallest value, count] pair
+	int h;
+	for (h = 0; h < NTABLEHISTOGRAMS; h++) {
+		const Histogram *histogram = &stats->histograms[h];
+		printf(", \"%s\": {\"count\": %ld, \"mean\": %.3f, \"p50\": %ld, "
+			"\"p99\": %ld, \"p999\": %ld, \"max\": %ld, \"buckets\": [",
+			table_histogram_names[h], histogram->count,
+			histogram_mean(histogram), histogram_percentile(histogram, 0.5),
+			histogram_percentile(histogram, 0.99),
+			histogram_percentile(histogram, 0.999), histogram->max);
+		int i;
+		bool first = true;
+		for (i = 0; i < HISTOGRAM_NBUCKETS; i++) {
+			if (histogram->counts[i]) {
+				printf("%s[%ld, %ld]", first ? "" : ", ",
+					histogram_bucket_min(i), histogram->counts[i]);
+				first = false;
+			}
+		}
+		printf("]}");
+	}
+	printf("}\n");
+}
+
+// print 'stats' to stdout as a line of comma-separated values, preceded by a
+// line of column names if 'header' is true
+void print_table_stats_csv(const TableStats *stats, bool header) {
+	int op, kind, h;
+	if (header) {
+		printf("type,keys,buckets,bucket_size,size,overflow_pages,load_factor,"
+			"bytes,bytes_per_key,wasted_bytes,slack_bytes,probes,collisions,"
+			"displacements,growths,time,last_resize,shards,lock_waits");
+		for (kind = 0; kind < NMEMORYKINDS; kind++) {
+			printf(",%s_bytes", memory_kindnames[kind]);
+		}
+		for (op = 0; op < NLATENCYOPS; op++) {
+			const char *name = latency_opnames[op];
+			printf(",%s_count,%s_p50_ns,%s_p99_ns,%s_p999_ns,%s_max_ns",
+				name, name, name, name, name);
+		}
+		for (h = 0; h < NTABLEHISTOGRAMS; h++) {
+			const char *name = table_histogram_names[h];
+			printf(",%s_count,%s_mean,%s_p50,%s_p99,%s_p999,%s_max",
+				name, name, name, name, name, name);
+		}
+		printf("\n");
+	}
+
+	printf("%s,%ld,%ld,%d,%ld,%ld,%.6f,%ld,%.2f,%ld,%ld,%ld,%ld,%ld,%ld,%.6f,"
+		"%.6f,%d,%ld", stats->type, stats->nkeys, stats->nbuckets,
+		stats->bucketsize, stats->size, stats->noverflow, stats->load_factor,
+		stats->bytes, stats->bytes_per_key, stats->wasted, stats->slack,
+		stats->probes, stats->collisions, stats->displacements, stats->growths,
+		stats->time, stats->last_resize, stats->shards, stats->lock_waits);
+	for (kind = 0; kind < NMEMORYKINDS; kind++) {
+		printf(",%ld", stats->memory.bytes[kind]);
+	}
+	for (op = 0; op < NLATENCYOPS; op++) {
+		const LatencySummary *latency = &stats->latency[op];
+		printf(",%ld,%.0f,%.0f,%.0f,%.0f", latency->count, latency->p50,
+			latency->p99, latency->p999, latency->max);
+	}
+	for (h = 0; h < NTABLEHISTOGRAMS; h++) {
+		const Histogram *histogram = &stats->histograms[h];
+		printf(",%ld,%.3f,%ld,%ld,%ld,%ld", histogram->count,
+			histogram_mean(histogram), histogram_percentile(histogram, 0.5),
+			histogram_percentile(histogram, 0.99),
+			histogram_percentile(histogram, 0.999), histogram->max);
+	}
+	printf("\n");
+}
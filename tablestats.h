@@ -0,0 +1,90 @@
+/* * * * * * * * *
+ * Module providing one structure for the statistics of every type of hash
+ * table, so that they can be compared (and printed in machine-readable JSON or
+ * CSV form) without caring which type of table they came from
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef TABLESTATS_H
+#define TABLESTATS_H
+
+#include <stdbool.h>
+#include "latency.h"
+#include "memusage.h"
+#include "histogram.h"
+
+// the distributions a table may report (each table leaves those that don't
+// apply to it empty)
+typedef enum table_histogram {
+	HISTOGRAM_PROBES_HIT,	// extra slots probed by lookups that found their key
+	HISTOGRAM_PROBES_MISS,	// extra slots probed by lookups that didn't
+	HISTOGRAM_EVICTIONS,	// keys displaced by each cuckoo insertion
+	HISTOGRAM_OCCUPANCY,	// keys in each bucket (with its overflow pages)
+	NTABLEHISTOGRAMS
+} TableHistogram;
+
+// the names of each distribution ("probes_hit", ...), for printing
+extern const char *table_histogram_names[NTABLEHISTOGRAMS];
+
+// statistics about the state of a hash table, and the operations on it so far
+// (a table leaves anything that doesn't apply to it as zero)
+typedef struct table_stats {
+	const char *type;	// which type of table this is (e.g. "xuckoon")
+	long nkeys;			// how many keys are stored in the table
+	long nbuckets;		// how many slots or buckets hold those keys
+	int bucketsize;		// how many keys each slot or bucket can hold
+	long size;			// how many directory entries there are (or slots, for
+						// a table with no directory)
+	long noverflow;		// how many overflow pages are chained to buckets
+	double load_factor;	// the fraction of the slots' or buckets' space in use
+	long bytes;			// how many bytes of memory the table has allocated
+	MemoryUsage memory;	// those bytes, broken down by what they're used for
+	double bytes_per_key;	// bytes allocated for each key stored
+	long wasted;		// bytes of space for keys not holding a key
+	long slack;			// bytes allocated ahead of need (for buckets or
+						// overflow pages not yet, or no longer, in use)
+	long probes;		// how many extra slots linear probing has checked
+	long collisions;	// how many keys' first slots were already in use
+	long displacements;	// how many keys cuckoo insertions have displaced
+	long growths;		// how many times cuckoo insertions went around a cycle
+						// (or too far) and had to grow the table
+	double time;		// how many seconds inserts and lookups have taken
+	double last_resize;	// how many seconds the most recent resize took (0 if
+						// there hasn't been one, or resizes aren't traced)
+	int shards;			// how many independent tables the keys are split
+						// between (1 unless the table is sharded)
+	long lock_waits;	// how many operations had to wait for another thread
+						// to release their shard's lock
+	LatencySummary latency[NLATENCYOPS]; // latencies of each type of operation
+	Histogram histograms[NTABLEHISTOGRAMS]; // the distributions above
+} TableStats;
+
+// set up 'stats' with everything zero, ready for a table to fill in
+void initialise_table_stats(TableStats *stats);
+
+// fill in the memory statistics of 'stats' from the counts in 'memory' (after
+// the table has filled in 'nkeys', 'wasted' and 'slack')
+void table_stats_memory(TableStats *stats, const MemoryUsage *memory);
+
+// add the statistics of 'shard', one shard of a sharded table, to 'stats', the
+// statistics of the whole table (which start out as initialised above): counts,
+// times and memory are added up, and the load factor averaged over the buckets.
+// the latency percentiles are the worst of any shard's, an upper bound on the
+// whole table's, and the last resize the longest of the shards' last resizes
+void merge_table_stats(TableStats *stats, const TableStats *shard);
+
+// print the memory statistics in 'stats' (total bytes, bytes per key and
+// directory overhead, wasted space and slack), with labels right-aligned to
+// 'width' characters
+void print_table_memory(const TableStats *stats, int width);
+
+// print 'stats' to stdout as a single-line JSON object
+void print_table_stats_json(const TableStats *stats);
+
+// print 'stats' to stdout as a line of comma-separated values, preceded by a
+// line of column names if 'header' is true
+void print_table_stats_csv(const TableStats *stats, bool header);
+
+#endif
@@ -0,0 +1,123 @@
+/* * * * * * * * *
+ * Module for tracing the events in a hash table's life that can pause it for a
+ * while: growing the whole table, splitting a bucket, doubling a directory, or
+ * recovering from a cuckoo cycle. the most recent events are kept in a ring
+ * buffer, which can be printed in Chrome's trace event format (for viewing in
+ * chrome://tracing or Perfetto) to see when the pauses happened. tracing can be
+ * switched off at compile time, in which case it costs nothing at all
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+// the names of each type of event, for printing
+const char *trace_kindnames[NTRACEKINDS] = {"grow", "split", "double", "cycle"};
+
+// how many events the traces printed into the current Chrome trace have traced
+// in all, and how many of those they've dropped
+static long printed_events = 0;
+static long printed_dropped = 0;
+
+#if TRACE_NEVENTS > 0
+
+// the time the first table started tracing: events are printed relative to it,
+// so that the traces of different tables (in one run) line up
+static uint64_t epoch = 0;
+
+// set up 'trace' with no events traced yet
+void initialise_trace(Trace *trace) {
+	trace->nevents = 0;
+	if (epoch == 0) {
+		epoch = latency_monotonic();
+	}
+}
+
+// record an event of type 'kind' that started at 'start' and has just
+// finished, having moved 'moved' keys and changed a size from 'before' to
+// 'after'
+void trace_record(Trace *trace, TraceKind kind, uint64_t start, long moved,
+		long before, long after) {
+	TraceEvent *event = &trace->events[trace->nevents % TRACE_NEVENTS];
+	event->kind = kind;
+	event->start = start;
+	event->duration = latency_monotonic() - start;
+	event->moved = moved;
+	event->before = before;
+	event->after = after;
+	trace->nevents++;
+}
+
+// how many seconds the most recent event traced took (0 if there hasn't been
+// one)
+double trace_last_duration(const Trace *trace) {
+	if (trace->nevents == 0) {
+		return 0;
+	}
+	return trace->events[(trace->nevents - 1) % TRACE_NEVENTS].duration / 1e9;
+}
+
+// print the events kept in 'trace' into the Chrome trace being printed, on
+// track (Chrome's 'tid') number 'track', named 'name'
+void trace_print_chrome(const Trace *trace, const char *name, int track) {
+	// the oldest event still kept, if the ring buffer has wrapped around
+	long first = 0;
+	if (trace->nevents > TRACE_NEVENTS) {
+		first = trace->nevents - TRACE_NEVENTS;
+	}
+	printed_events += trace->nevents;
+	printed_dropped += first;
+
+	// 'complete' events, with times in microseconds
+	printf(",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+		"\"tid\": %d, \"args\": {\"name\": \"%s\"}}", track, name);
+	long i;
+	for (i = first; i < trace->nevents; i++) {
+		const TraceEvent *event = &trace->events[i % TRACE_NEVENTS];
+		printf(",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+			"\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d, "
+			"\"args\": {\"moved\": %ld, \"before\": %ld, \"after\": %ld}}",
+			trace_kindnames[event->kind], name,
+			(event->start - epoch) / 1000.0, event->duration / 1000.0, track,
+			event->moved, event->before, event->after);
+	}
+}
+
+#else
+
+// set up 'trace' with no events traced yet
+void initialise_trace(Trace *trace) {
+	trace->unused = 0;
+}
+
+// with tracing switched off, there are no events to time or print (but the
+// Chrome trace they would have been printed in is still printed, empty)
+double trace_last_duration(const Trace *trace) {
+	return 0;
+}
+void trace_print_chrome(const Trace *trace, const char *name, int track) {
+}
+
+#endif
+
+// start printing a Chrome trace JSON object to stdout, to hold the events of
+// one or more traces (each printed with trace_print_chrome())
+void trace_print_chrome_begin(void) {
+	printed_events = 0;
+	printed_dropped = 0;
+	printf("{\"traceEvents\": [\n");
+	printf("{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+		"\"args\": {\"name\": \"hash table\"}}");
+}
+
+// finish printing the Chrome trace JSON object, with how many events were
+// traced and dropped altogether
+void trace_print_chrome_end(void) {
+	printf("\n], \"displayTimeUnit\": \"ns\", \"otherData\": "
+		"{\"events\": %ld, \"dropped\": %ld}}\n", printed_events,
+		printed_dropped);
+}
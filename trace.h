@@ -0,0 +1,113 @@
+/* * * * * * * * *
+ * Module for tracing the events in a hash table's life that can pause it for a
+ * while: growing the whole table, splitting a bucket, doubling a directory, or
+ * recovering from a cuckoo cycle. the most recent events are kept in a ring
+ * buffer, which can be printed in Chrome's trace event format (for viewing in
+ * chrome://tracing or Perfetto) to see when the pauses happened. tracing can be
+ * switched off at compile time, in which case it costs nothing at all
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by Raisa Litchfield
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "latency.h"
+#include "perfcount.h"
+
+// how many of the most recent events each table keeps (0 switches tracing off)
+// (compile with -DTRACE_NEVENTS=n to change this)
+#ifndef TRACE_NEVENTS
+#define TRACE_NEVENTS 1024
+#endif
+
+// the types of event that are traced
+typedef enum trace_kind {
+	TRACE_GROW,		// the whole table grew (and its keys were reinserted)
+	TRACE_SPLIT,	// a bucket was split into two
+	TRACE_DOUBLE,	// a directory (or sub-directory) doubled, while splitting
+	TRACE_CYCLE,	// a cuckoo insertion path went around a cycle (or too far)
+					// and the table made space to recover
+	NTRACEKINDS
+} TraceKind;
+
+// the names of each type of event ("grow", "split", ...), for printing
+extern const char *trace_kindnames[NTRACEKINDS];
+
+#if TRACE_NEVENTS > 0
+
+// one traced event
+typedef struct trace_event {
+	TraceKind kind;		// what happened
+	uint64_t start;		// when it started (in nanoseconds, on the same monotonic
+						// clock as latency_monotonic())
+	uint64_t duration;	// how long it took (in nanoseconds)
+	long moved;			// how many keys it moved
+	long before;		// the size of what grew or split before the event
+	long after;			// ... and after it (in slots, buckets or entries)
+} TraceEvent;
+
+// a ring buffer of the most recent events traced on one table
+typedef struct trace {
+	TraceEvent events[TRACE_NEVENTS];
+	long nevents;	// how many events have been traced in all (only the last
+					// TRACE_NEVENTS of which are still kept)
+} Trace;
+
+// record an event of type 'kind' that started at 'start' and has just
+// finished, having moved 'moved' keys and changed a size from 'before' to
+// 'after'
+void trace_record(Trace *trace, TraceKind kind, uint64_t start, long moved,
+	long before, long after);
+
+// start timing an event, remembering the time in a new variable 'start' (and
+// also counting hardware events for it as a resize, if they're being counted)
+#define TRACE_START(start) \
+	uint64_t start = latency_monotonic(); \
+	PerfSample start##_perf; \
+	perf_resize_begin(&start##_perf)
+
+// finish an event of type 'kind' that started at 'start', recording it in
+// 'trace'
+#define TRACE_STOP(trace, kind, start, moved, before, after) \
+	(trace_record(trace, kind, start, moved, before, after), \
+	perf_resize_end(&start##_perf))
+
+#else
+
+// with tracing switched off, there's nothing to keep and nothing to do (the
+// sizes are only mentioned so that the variables holding them are still used)
+typedef struct trace {
+	char unused;
+} Trace;
+
+#define TRACE_START(start)
+#define TRACE_STOP(trace, kind, start, moved, before, after) \
+	((void)(moved), (void)(before), (void)(after))
+
+#endif
+
+// set up 'trace' with no events traced yet
+void initialise_trace(Trace *trace);
+
+// how many seconds the most recent event traced took (0 if there hasn't been
+// one). events are recorded as they finish, so the most recent one includes any
+// others that happened during it, such as a directory doubling while a bucket
+// splits
+double trace_last_duration(const Trace *trace);
+
+// start printing a Chrome trace JSON object to stdout, to hold the events of
+// one or more traces (each printed with trace_print_chrome())
+void trace_print_chrome_begin(void);
+
+// print the events kept in 'trace' into the Chrome trace being printed, on
+// track (Chrome's 'tid') number 'track', named 'name'
+void trace_print_chrome(const Trace *trace, const char *name, int track);
+
+// finish printing the Chrome trace JSON object, with how many events were
+// traced and dropped altogether
+void trace_print_chrome_end(void);
+
+#endif